@@ -9,6 +9,7 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/socket.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <semaphore.h>
@@ -17,15 +18,19 @@
 #include <dirent.h>
 #include <time.h>
 #include <signal.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // Configurações do sistema
-#define NUM_WORKERS         2
-#define NUM_THREADS         3
+#define NUM_WORKERS         2       // Padrão (-w muda)
+#define MAX_WORKERS         16      // Capacidade das estruturas compartilhadas
+#define NUM_THREADS         4       // Uma thread de filtro por FILTER_*
 #define MAX_FILENAME        256
-#define MAX_PATH            512
-#define MAX_IMAGES          100
+#define MAX_TASK_PATH       PATH_MAX
 #define MAX_MSG_SIZE        512
 #define MAX_QUEUE_MSGS      10
+#define CACHE_LINE_SIZE     64
 
 // Nomes dos recursos IPC
 #define QUEUE_NAME          "/img_queue"
@@ -36,58 +41,297 @@
 #define INPUT_DIR           "images"
 #define OUTPUT_DIR          "output"
 
+// Socket da API de submissão de tarefas (modo serviço)
+#define DEFAULT_SOCKET_PATH "/tmp/image_processor.sock"
+#define MAX_PASSED_FDS      16      // Descritores por mensagem (SCM_RIGHTS)
+
 // Tipos de filtro
 #define FILTER_GRAYSCALE    0
 #define FILTER_BLUR         1
 #define FILTER_RESIZE       2
+#define FILTER_CROP         3
+// Padrão das tarefas; o crop só roda quando pedido (-f, filters=)
+#define FILTER_ALL_MASK     ((1 << FILTER_GRAYSCALE) | (1 << FILTER_BLUR) | (1 << FILTER_RESIZE))
 
 // Códigos de mensagem
 #define MSG_TASK            1
 #define MSG_TERMINATE       2
 
+// Histograma de latência log-linear (estilo HDR): 16 faixas por
+// potência de 2, erro relativo máximo ~6%, de 1 µs a mais de um dia
+#define HIST_SUB_BITS       4
+#define HIST_SUB_BUCKETS    (1 << HIST_SUB_BITS)
+#define HIST_MAX_SHIFT      32
+#define HIST_BUCKETS        ((HIST_MAX_SHIFT + 2) * HIST_SUB_BUCKETS)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+    uint64_t buckets[HIST_BUCKETS];
+} __attribute__((aligned(CACHE_LINE_SIZE))) latency_hist_t;
+
+// Latências de um worker por etapa. Cada histograma tem um único
+// escritor (a thread do worker ou a thread do filtro)
+typedef struct {
+    latency_hist_t decode;
+    latency_hist_t filter[NUM_THREADS];     // Aplicação do filtro
+    latency_hist_t encode[NUM_THREADS];     // Codificação JPG/PNG em memória
+    latency_hist_t write[NUM_THREADS];      // Gravação no arquivo (ou memfd)
+    latency_hist_t total;                   // Imagem inteira
+} worker_latency_t;
+
+// Contadores de hardware (perf_event_open) acumulados por filtro
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_NUM_COUNTERS
+};
+
+// Um único escritor: a thread do filtro no worker
+typedef struct {
+    uint64_t samples;               // Execuções medidas
+    uint64_t pixels;                // Pixels de entrada dessas execuções
+    uint64_t values[PERF_NUM_COUNTERS];
+    unsigned int missing;           // Bits (1 << PERF_*) dos contadores indisponíveis
+} __attribute__((aligned(CACHE_LINE_SIZE))) perf_totals_t;
+
+// Verificação (-V): saída dos kernels selecionados contra a do outro
+// conjunto, por filtro. Um único escritor: a thread do filtro no worker
+typedef struct {
+    uint64_t frames;                // Imagens comparadas
+    uint64_t failed;                // Imagens acima da tolerância
+    uint64_t values;                // Amostras comparadas (pixels × canais)
+    uint64_t sum_abs;               // Soma de |diferença|
+    uint64_t sum_sq;                // Soma de diferença²
+    int max_abs;
+} __attribute__((aligned(CACHE_LINE_SIZE))) verify_totals_t;
+
+// Codificação por perfil (formato e parâmetros usados), por filtro. Um
+// único escritor: a thread do filtro no worker. A entrada é ocupada pela
+// primeira saída com a chave (publicada por último) e nunca é liberada
+#define ENCODE_STAT_SLOTS   8
+
+typedef struct {
+    uint32_t key;                   // encode_stat_key(); 0 = livre
+    uint64_t outputs;
+    uint64_t pixels;
+    uint64_t bytes;                 // Tamanho codificado
+    uint64_t ns;                    // Tempo de codificação
+} encode_totals_t;
+
+typedef struct {
+    encode_totals_t slots[ENCODE_STAT_SLOTS];
+} __attribute__((aligned(CACHE_LINE_SIZE))) encode_stats_t;
+
+// Log estruturado dos workers: registros binários de tamanho fixo num
+// anel SPSC por worker (escritor: thread principal do worker; leitor:
+// coordenador, que formata o texto)
+#define LOG_RING_SIZE       1024    // Registros por worker (potência de 2)
+#define LOG_NAME_MAX        96
+
+typedef struct {
+    uint64_t ts_ns;                 // CLOCK_MONOTONIC
+    int event;                      // log_event_t (event_log.h)
+    int task_id;
+    int64_t args[2];
+    char name[LOG_NAME_MAX];        // Arquivo (final do caminho, se longo)
+} log_record_t;
+
+typedef struct {
+    uint64_t head __attribute__((aligned(CACHE_LINE_SIZE)));   // Escrito pelo worker
+    uint64_t dropped;               // Registros perdidos com o anel cheio
+    uint64_t tail __attribute__((aligned(CACHE_LINE_SIZE)));   // Escrito pelo coordenador
+    log_record_t records[LOG_RING_SIZE];
+} __attribute__((aligned(CACHE_LINE_SIZE))) log_ring_t;
+
+typedef struct {
+    unsigned int seq __attribute__((aligned(CACHE_LINE_SIZE)));  // Futex do leitor
+    int reader_waiting;             // 1 enquanto o coordenador dorme no futex
+    log_ring_t rings[MAX_WORKERS];
+} log_channel_t;
+
+// Contadores de um worker. Cada bloco tem um único escritor (o próprio
+// worker) e ocupa linhas de cache exclusivas: atualizações não disputam
+// trava nem invalidam a linha de outro worker. Leitura sem trava.
+typedef struct {
+    uint64_t processed;
+    uint64_t failed;
+    uint64_t busy_us;               // Soma dos tempos de processamento
+    uint64_t decoded_bytes;         // Pixels decodificados (largura × altura × canais)
+    uint64_t scaled_decodes;        // JPEGs decodificados já reduzidos (IDCT 1/2)
+    uint64_t region_decodes;        // JPEGs decodificados só na região do crop
+    int active;                     // 1 enquanto consome a fila
+    int done;                       // 1 após receber o término
+    uint64_t ready_ns;              // Instante (CLOCK_MONOTONIC) em que ficou pronto
+    uint64_t mem_reserved;          // Reserva da tarefa atual (estimativa, bytes)
+    uint64_t mem_reserved_peak;     // Maior reserva de uma tarefa
+    uint64_t mem_deferred;          // Tarefas que esperaram pelo orçamento
+    uint64_t mem_wait_us;           // Tempo somado dessas esperas
+    uint64_t rss_bytes;             // RSS do processo após a última tarefa
+    uint64_t rss_peak_bytes;        // Pico de RSS do processo (ru_maxrss)
+    unsigned int file_seq;          // Seqlock de current_file (ímpar = escrevendo)
+    char current_file[MAX_FILENAME];
+} __attribute__((aligned(CACHE_LINE_SIZE))) worker_stats_t;
+
 // Estrutura para estatísticas na memória compartilhada
 typedef struct {
-    pthread_mutex_t mutex;
-    pthread_mutexattr_t mutex_attr;
-    pthread_cond_t cond_finished;
-    pthread_condattr_t cond_attr;
-    int total_images;
+    // Escritos apenas pelo coordenador
+    int total_images;               // Tarefas enviadas à fila
+    int next_task_id;               // Ids das tarefas (varredura e API de tarefas)
+    int num_workers;                // Workers deste lote (-w; <= MAX_WORKERS)
+    double total_processing_time;   // Tempo de parede do lote (preenchido no fim)
+    uint64_t spawn_ns;              // Início da criação dos workers (CLOCK_MONOTONIC)
+    uint64_t mem_budget;            // Orçamento de memória dos workers (-M); 0 = sem limite
+    // Memória reservada por todos os workers (CAS). Quem não cabe no
+    // orçamento dorme no futex mem_seq, incrementado a cada liberação
+    uint64_t mem_reserved __attribute__((aligned(CACHE_LINE_SIZE)));
+    uint64_t mem_reserved_peak;
+    unsigned int mem_seq;
+    // Workers prontos para consumir a fila (futex; incrementado por eles)
+    unsigned int workers_ready __attribute__((aligned(CACHE_LINE_SIZE)));
+    worker_stats_t workers[MAX_WORKERS];
+    worker_latency_t latency[MAX_WORKERS];  // Somados pelo coordenador no final
+    perf_totals_t perf[MAX_WORKERS][NUM_THREADS];   // Só com -p
+    verify_totals_t verify[MAX_WORKERS][NUM_THREADS];   // Só com -V
+    encode_stats_t encode[MAX_WORKERS][NUM_THREADS];
+    log_channel_t log;
+} shared_stats_t;
+
+// Soma dos contadores de todos os workers (cópia local do coordenador)
+typedef struct {
     int processed_images;
     int failed_images;
-    double total_processing_time;
     int workers_active;
     int workers_done;
-    char current_files[NUM_WORKERS][MAX_FILENAME];
-} shared_stats_t;
+    uint64_t scaled_decodes;
+    uint64_t region_decodes;
+    double busy_time;
+} stats_totals_t;
+
+// Região do filtro crop: retângulo em pixels (x < 0 ou y < 0 = centrado
+// naquele eixo) ou percent% de cada dimensão, centrado. Tudo zero = -C
+typedef struct {
+    int x, y;
+    int width, height;
+    int percent;
+} crop_spec_t;
+
+// Perfil de codificação de uma saída. Campos de 1 byte: a tarefa leva um
+// por filtro, e jpeg_quality 0 nela = perfil do processo (-Q)
+typedef struct {
+    signed char jpeg_quality;       // 1..100
+    signed char jpeg_subsample;     // 1 = croma 4:2:0, 0 = 4:4:4
+    signed char png_level;          // Esforço do zlib (1..9)
+    signed char png_filter;         // Filtro de linha PNG: 0..4 fixo, -1 = o melhor por linha
+    signed char png_fast;           // 1 = filtros vetoriais e deflate rápido (deflate.c)
+    signed char format;             // Formato das saídas + 1 (output_format_t); 0 = o da tarefa
+} encode_profile_t;
+
+// Saída do stb_image_write: JPEG 90 (4:2:0) e PNG com os padrões dele
+#define ENCODE_PROFILE_DEFAULT  { .jpeg_quality = 90, .jpeg_subsample = 1, \
+                                  .png_level = 8, .png_filter = -1, .png_fast = 0, \
+                                  .format = 0 }
 
 // Estrutura de mensagem para fila
+// (enviada com tamanho variável: só os caminhos efetivamente usados)
 typedef struct {
     long msg_type;
-    char filename[MAX_FILENAME];
     int task_id;
+    int job_id;                 // > 0: tarefa da API (gera evento de conclusão)
+    int filter_mask;            // Filtros a aplicar (bits 1 << FILTER_*)
+    int src_fd;                 // Imagem em memória: fd no coordenador (-1 = arquivo)
+    int flags;                  // TASK_OUT_MEMORY
+    char out_ext[8];            // Extensão das saídas ("jpg", "png", "qoi", "ppm", "pam";
+                                // o formato do perfil do filtro tem precedência)
+    crop_spec_t crop;           // Região do crop (zerada = padrão do processo)
+    encode_profile_t profiles[NUM_THREADS]; // Perfil por filtro (zerado = padrão)
+    uint64_t enqueue_ns;        // Entrada na fila (monotonic_ns), para o trace
+    // Entrada (relativa a INPUT_DIR ou absoluta), '\0', prefixo de saída
+    // (vazio = OUTPUT_DIR espelhando a entrada), '\0'
+    char filename[MAX_TASK_PATH];
 } task_message_t;
 
+// Saídas codificadas em memfds devolvidos com o evento de conclusão
+// (nada é gravado em disco)
+#define TASK_OUT_MEMORY     0x1
+
+// Evento de conclusão de uma tarefa da API (worker -> coordenador)
+typedef struct {
+    int job_id;
+    int worker_id;
+    int status;                 // 0 = sucesso
+    int output_mask;            // Filtros cuja saída foi gerada
+    double elapsed;
+} job_done_t;
+
+struct trace_buffer;            // trace.h
+struct perf_group;              // perf_counters.h
+struct pack_writer;             // pack.h
+
 // Argumentos para threads de filtro
 typedef struct {
     unsigned char *image_data;
     int width;
     int height;
     int channels;
-    char input_file[MAX_FILENAME];
-    char output_file[MAX_PATH];
+    const char *input_file;
+    char *output_file;
+    int output_fd;              // memfd de saída (-1 = gravar output_file)
+    struct pack_writer *pack;   // Pacote do worker (-P): a saída entra nele em vez de output_file
+    worker_latency_t *latency;  // Histogramas do worker (memória compartilhada)
+    struct trace_buffer *trace; // Eventos da thread (NULL = trace desligado)
+    struct perf_group *perf;    // Contadores da thread (NULL = desligado)
+    perf_totals_t *perf_totals;
+    verify_totals_t *verify;    // Comparação com o outro conjunto (NULL = desligada)
+    encode_stats_t *encode_stats;   // Codificação por perfil
+    encode_profile_t profile;   // Perfil das saídas deste filtro
+    int verify_tolerance;       // Maior |diferença| aceita
+    int decoded_output;         // image_data já é a saída do filtro (decodificação reduzida
+                                // ou recortada): só codifica e grava
+    int crop_x, crop_y;         // Região do crop (largura 0 = fora da imagem)
+    int crop_width, crop_height;
+    int task_id;
     int filter_type;
     int thread_id;
     int worker_id;
     int success;
+    unsigned char *scratch;     // Buffer de saída reutilizado entre imagens
+    size_t scratch_size;
+    unsigned char *verify_scratch;  // Saída do outro conjunto de kernels (-V)
+    size_t verify_scratch_size;
+    unsigned char *encoded;     // Imagem codificada, também reutilizada
+    size_t encoded_len;
+    size_t encoded_cap;
 } thread_args_t;
 
+// Pool de threads de filtro do worker: criado uma vez e reutilizado
+// a cada imagem (evita pthread_create/malloc por tarefa)
+typedef struct {
+    pthread_t threads[NUM_THREADS];
+    thread_args_t args[NUM_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    unsigned long generation;   // Incrementado a cada nova imagem
+    int pending;                // Threads ainda trabalhando na imagem atual
+    int shutdown;
+} filter_pool_t;
+
 // Contexto do worker
 typedef struct {
     int worker_id;
     mqd_t msg_queue;
     shared_stats_t *stats;
     sem_t *io_sem;
-    int pipe_fd;
+    int done_fd;                // Socket de eventos de conclusão
+    int progress_fd;            // eventfd de progresso do coordenador
+    filter_pool_t *pool;
+    struct trace_buffer *trace; // Eventos da thread principal (NULL = desligado)
+    uint64_t mem_reserved;      // Reserva da tarefa atual (liberada em finish_task)
+    struct pack_writer *pack;   // Pacote de saídas (-P), ou NULL
 } worker_context_t;
 
 // Macros de log
@@ -101,6 +345,23 @@ static inline double get_time_diff(struct timespec start, struct timespec end) {
     return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
 }
 
+// Relógio monotônico em ns: comparável entre processos
+static inline uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Imprime o rótulo alinhado à coluna: printf conta bytes, não
+// caracteres, e os rótulos têm acentos (UTF-8)
+static inline void print_label(const char *label, int width) {
+    int visible = 0;
+    for (const char *p = label; *p; p++) {
+        if (((unsigned char)*p & 0xC0) != 0x80) visible++;
+    }
+    printf("  %s%*s", label, visible < width ? width - visible : 0, "");
+}
+
 static inline void get_basename(const char *path, char *basename) {
     const char *last_slash = strrchr(path, '/');
     if (last_slash) {
@@ -112,7 +373,9 @@ static inline void get_basename(const char *path, char *basename) {
 
 static inline void remove_extension(char *filename) {
     char *dot = strrchr(filename, '.');
-    if (dot) *dot = '\0';
+    char *slash = strrchr(filename, '/');
+    // Só considera o ponto se estiver no último componente do caminho
+    if (dot && (!slash || dot > slash)) *dot = '\0';
 }
 
 #endif // COMMON_H
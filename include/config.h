@@ -0,0 +1,54 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "common.h"
+
+// Padrões das opções de linha de comando
+#define DEFAULT_WALKERS     4
+#define MAX_WALKERS         64
+#define DEFAULT_METRICS_MS  1000
+#define DEFAULT_VERIFY_TOL  1       // Arredondamento do grayscale em ponto fixo
+#define DEFAULT_CROP_PERCENT 50     // Crop padrão: metade central de cada dimensão
+
+// Configuração da execução (preenchida pelo coordenador antes do fork,
+// herdada pelos workers)
+typedef struct {
+    int recursive;              // Percorre subdiretórios de INPUT_DIR
+    int num_walkers;            // Threads de varredura no modo recursivo
+    const char *list_file;      // Lista de arquivos ("-" = stdin), ou NULL
+    int list_delim;             // '\n' ou '\0'
+    int daemon;                 // Modo serviço (inotify, workers permanentes)
+    const char *socket_path;    // API de tarefas (implica modo serviço), ou NULL
+    const char *trace_file;     // Linha do tempo em JSON (Chrome trace), ou NULL
+    int trace_events;           // Eventos por thread no trace (-N)
+    int perf;                   // Contadores de hardware por filtro
+    int verbosity;              // Logs dos workers: 0 (-q), 1, 2 (-v)
+    const char *metrics_file;   // Métricas Prometheus (textfile), ou NULL
+    int metrics_interval_ms;    // Intervalo entre regravações do arquivo
+    int num_workers;            // Processos worker (1..MAX_WORKERS)
+    int filter_mask;            // Filtros das tarefas do lote (1 << FILTER_*)
+    int kernel_set;             // kernel_set_t usado nas saídas
+    int verify;                 // Compara kernels rápidos e de referência
+    int verify_tolerance;       // Maior |diferença| aceita por amostra
+    uint64_t mem_budget;        // Orçamento de memória dos workers (bytes; 0 = sem limite)
+    int partial_decode;         // JPEG só com crop: decodifica só a região
+    int scaled_decode;          // JPEG só com resize: decodifica reduzido (1/2, -R)
+    crop_spec_t crop;           // Região do crop das tarefas sem crop= próprio
+    int encode_threads;         // Threads por saída JPEG (faixas com RST)
+    encode_profile_t profiles[NUM_THREADS]; // Perfil de codificação por filtro (-Q)
+    const char *pack_prefix;    // Saídas em PREFIXO-<worker>.pack (-P), ou NULL
+} app_config_t;
+
+extern app_config_t g_config;
+
+// Lê argv; retorna 0 se ok, 1 se pediu ajuda, -1 em erro
+int parse_args(int argc, char **argv, app_config_t *cfg);
+void print_usage(const char *prog);
+
+// Perfil de codificação do filtro na tarefa (zerado na tarefa = o do processo)
+encode_profile_t task_profile(const task_message_t *task, int filter);
+// Extensão das saídas do filtro: a do formato do perfil, se houver, ou
+// out_ext da tarefa
+const char* task_output_ext(const task_message_t *task, int filter);
+
+#endif // CONFIG_H
@@ -0,0 +1,44 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "common.h"
+#include "ingest.h"
+#include <stdint.h>
+
+// Máscara de eventos observados em INPUT_DIR: arquivo fechado após
+// escrita ou movido para dentro do diretório
+#define DAEMON_WATCH_MASK   (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+// Identificação das fontes de evento no epoll (data.u64 = tipo << 32 | id)
+#define EV_TAG(type, id)    (((uint64_t)(type) << 32) | (uint32_t)(id))
+#define EV_TYPE(u64)        ((int)((u64) >> 32))
+#define EV_ID(u64)          ((int)((u64) & 0xffffffffu))
+
+enum {
+    EV_SIGNAL = 1,
+    EV_INOTIFY,
+    EV_LISTEN,                  // Socket de escuta da API
+    EV_CLIENT,                  // Cliente da API (id = slot)
+    EV_DONE,                    // Eventos de conclusão dos workers
+    EV_PROGRESS                 // Imagem concluída por um worker (eventfd)
+};
+
+// Bloqueia SIGINT/SIGTERM na thread atual (e nas que ela criar), para
+// que sejam recebidos pelo laço de eventos via signalfd
+int daemon_block_signals(void);
+
+// Cria o inotify, o signalfd e o epoll. Chamado antes da varredura
+// inicial para não perder arquivos que chegam durante ela.
+int daemon_init(void);
+
+// Modo serviço: despacha cada nova imagem de INPUT_DIR imediatamente,
+// até receber SIGINT/SIGTERM. Retorna 0 em parada normal ou -1 em erro.
+int daemon_run(ingest_cb_t dispatch, void *user);
+
+// Descritor do epoll, para registrar outras fontes (API de tarefas)
+int daemon_epoll_fd(void);
+
+// Fecha os descritores do laço de eventos
+void daemon_shutdown(void);
+
+#endif // DAEMON_H
@@ -0,0 +1,21 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include "common.h"
+
+// Compressor deflate (RFC 1951) com moldura zlib (RFC 1950) feito para
+// velocidade nos resíduos dos filtros PNG: LZ77 guloso sobre uma tabela
+// hash de 4 bytes e blocos Huffman dinâmicos (bloco armazenado quando a
+// compressão não compensa). Nível 1 só procura repetições do byte
+// anterior (RLE); 2..9 também seguem a cadeia de candidatos, cada vez
+// mais fundo.
+// Retorna o fluxo (liberar com free) e o tamanho em *out_len, ou NULL
+// sem memória
+unsigned char* deflate_zlib(const unsigned char *data, size_t len, int level, size_t *out_len);
+
+// Somas de verificação incrementais, com os valores iniciais do zlib
+// (adler32: 1, crc32: 0)
+uint32_t adler32_update(uint32_t adler, const unsigned char *data, size_t len);
+uint32_t crc32_update(uint32_t crc, const unsigned char *data, size_t len);
+
+#endif // DEFLATE_H
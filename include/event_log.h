@@ -0,0 +1,39 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "common.h"
+
+// Eventos dos workers. O texto (e o nível mínimo de verbosidade para
+// exibi-lo) fica só no coordenador
+typedef enum {
+    LOG_EV_STARTED,             // args[0] = PID
+    LOG_EV_TASK_START,          // args = largura, altura
+    LOG_EV_FILTER,              // args = filtro, sucesso
+    LOG_EV_TASK_DONE,           // args = duração (µs), sucesso
+    LOG_EV_LOAD_FAILED,
+    LOG_EV_MEM_DEFERRED,        // args = bytes reservados, espera (µs)
+    LOG_EV_TERMINATE,
+    LOG_EV_FINISHED,
+    LOG_EV_COUNT
+} log_event_t;
+
+// Níveis de verbosidade (-q = 0, padrão = 1, -v = 2)
+#define LOG_LEVEL_QUIET     0
+#define LOG_LEVEL_DEFAULT   1
+#define LOG_LEVEL_VERBOSE   2
+
+// Worker: grava um registro no próprio anel. Nunca bloqueia: com o anel
+// cheio o registro é descartado e contado. Só acorda o coordenador
+// (syscall) quando ele está dormindo
+void log_emit(log_channel_t *ch, int worker_id, int event, int task_id,
+              const char *name, int64_t arg0, int64_t arg1);
+
+// Coordenador: formata e imprime os registros pendentes de todos os
+// anéis até o nível de verbosidade. Retorna quantos foram consumidos
+int log_drain(log_channel_t *ch, int verbosity);
+
+// Coordenador: dorme até haver registros novos, log_wake ou timeout
+void log_wait(log_channel_t *ch, int timeout_ms);
+void log_wake(log_channel_t *ch);
+
+#endif // EVENT_LOG_H
@@ -7,19 +7,69 @@
 void* thread_grayscale(void *args);
 void* thread_blur(void *args);
 void* thread_resize(void *args);
+void* thread_crop(void *args);
+
+// Conjuntos de kernels: referência (escalar original, a saída de ouro)
+// e rápido (mesma semântica, reescrito para desempenho; pode diferir por
+// arredondamento). apply_* usam o conjunto selecionado
+typedef enum {
+    KERNELS_REFERENCE,
+    KERNELS_FAST,
+    NUM_KERNEL_SETS
+} kernel_set_t;
+
+typedef struct {
+    const char *name;
+    void (*grayscale)(unsigned char *image, int width, int height, int channels);
+    void (*blur)(unsigned char *src, unsigned char *dst, int width, int height, int channels);
+    void (*resize_into)(unsigned char *src, int src_w, int src_h, int channels,
+                        unsigned char *dst, int dst_w, int dst_h);
+} filter_kernels_t;
+
+const filter_kernels_t* get_filter_kernels(kernel_set_t set);
+void select_filter_kernels(kernel_set_t set);
+// "ref" ou "fast" -> kernel_set_t; -1 se desconhecido
+int parse_kernel_set(const char *name);
+// Threads por codificação JPEG das saídas (faixas com RST; 1 = sem faixas)
+void set_encode_threads(int threads);
 
 // Funções auxiliares dos filtros
 void apply_grayscale(unsigned char *image, int width, int height, int channels);
 void apply_blur(unsigned char *src, unsigned char *dst, int width, int height, int channels);
 void apply_resize(unsigned char *src, int src_w, int src_h, int channels,
                   unsigned char **dst, int *dst_w, int *dst_h);
+void resize_dimensions(int src_w, int src_h, int *dst_w, int *dst_h);
+void apply_resize_into(unsigned char *src, int src_w, int src_h, int channels,
+                       unsigned char *dst, int dst_w, int dst_h);
+void apply_crop(const unsigned char *src, int src_w, int channels,
+                int x, int y, int width, int height, unsigned char *dst);
+
+// "50%", "640x480" (centrado) ou "640x480+10+20" -> crop_spec_t; 0 se ok
+int parse_crop_spec(const char *text, crop_spec_t *spec);
+// Região do crop numa imagem, limitada às bordas; -1 se ficar vazia
+int crop_region(const crop_spec_t *spec, int img_w, int img_h,
+                int *x, int *y, int *width, int *height);
 
 // Carregamento e salvamento de imagens
 unsigned char* load_image(const char *filename, int *width, int *height, int *channels);
+unsigned char* load_image_from_memory(const unsigned char *buffer, size_t len,
+                                      int *width, int *height, int *channels);
+// Dimensões e canais lidos só do cabeçalho (sem decodificar); 0 se ok
+int image_info(const char *filename, int *width, int *height, int *channels);
+int image_info_from_memory(const unsigned char *buffer, size_t len,
+                           int *width, int *height, int *channels);
 int save_image(const char *filename, unsigned char *data, int width, int height, int channels);
 void free_image(unsigned char *data);
 
 // Nome do filtro
 const char* get_filter_name(int filter_type);
 
+// "grayscale,blur" -> máscara de filtros; -1 se algum nome for desconhecido
+int parse_filter_list(const char *list);
+
+// "[FILTRO=]PERFIL[,...]" (PERFIL como em parse_encode_profile): aplica
+// cada perfil ao filtro indicado, ou a todos; profiles só muda se tudo
+// for válido. Retorna 0 se ok
+int parse_encode_profiles(const char *text, encode_profile_t profiles[NUM_THREADS]);
+
 #endif // FILTERS_H
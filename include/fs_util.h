@@ -0,0 +1,10 @@
+#ifndef FS_UTIL_H
+#define FS_UTIL_H
+
+#include "common.h"
+
+// Cria os diretórios intermediários de um caminho (mkdir -p do diretório
+// pai). Retorna 0 ou -1 com errno do mkdir que falhou
+int make_parent_dirs(const char *path);
+
+#endif // FS_UTIL_H
@@ -0,0 +1,23 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "common.h"
+
+// Registra uma amostra (µs). Seguro com um escritor e leitores concorrentes
+void hist_record(latency_hist_t *h, uint64_t usec);
+
+// Registra o intervalo entre dois instantes (CLOCK_MONOTONIC)
+void hist_record_interval(latency_hist_t *h, const struct timespec *start,
+                          const struct timespec *end);
+
+// Soma src em dst (dst é privado do chamador)
+void hist_merge(latency_hist_t *dst, const latency_hist_t *src);
+
+// Valor (µs) abaixo do qual estão pct% das amostras (limite superior da faixa)
+uint64_t hist_percentile(const latency_hist_t *h, double pct);
+
+// Amostras em faixas inteiramente <= usec (base dos buckets cumulativos
+// do Prometheus; a faixa que contém usec fica para o limite seguinte)
+uint64_t hist_count_at_most(const latency_hist_t *h, uint64_t usec);
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,78 @@
+#ifndef IMAGE_ENCODE_H
+#define IMAGE_ENCODE_H
+
+#include "common.h"
+
+#define MAX_ENCODE_THREADS  16
+
+// Destino da saída codificada (mesma assinatura de stbi_write_func)
+typedef void encode_write_func(void *context, void *data, int size);
+
+// Maior cabeçalho de raw_header
+#define RAW_HEADER_MAX      96
+
+typedef enum {
+    OUTPUT_JPEG,
+    OUTPUT_PNG,
+    OUTPUT_QOI,                 // Sem perdas, uma passada (qoi.c)
+    OUTPUT_PPM,                 // Pixels crus: P5 (cinza) ou P6 (RGB)
+    OUTPUT_PAM,                 // Pixels crus: P7 com qualquer número de canais
+    NUM_OUTPUT_FORMATS
+} output_format_t;
+
+// Formato pela extensão do nome de saída (".png", ".qoi", ".ppm"/".pgm",
+// ".pam"; o resto é JPEG)
+output_format_t output_format_for(const char *filename);
+// Extensão sem o ponto ("jpg", "png", "qoi", "ppm", "pam")
+const char* output_format_ext(output_format_t format);
+// Nome (a própria extensão) -> formato, ou -1 se desconhecido
+int parse_output_format(const char *name);
+
+// JPEG baseline com a qualidade e o croma (4:2:0 ou 4:4:4) do perfil.
+// Com threads > 1 a imagem é dividida em faixas horizontais (linhas de
+// MCU inteiras), cada uma codificada numa thread, e os fluxos entrópicos
+// são emendados com intervalo de restart (DRI) igual a uma faixa e um
+// marcador RSTn entre faixas. Os pixels decodificados são os mesmos da
+// codificação numa thread; faixas baixas demais ficam numa thread só.
+// Retorna 0 se ok
+int encode_jpeg(encode_write_func *func, void *context, int width, int height, int channels,
+                const unsigned char *data, const encode_profile_t *profile, int threads);
+
+// PNG com o nível do zlib e o filtro de linha do perfil (os globais do
+// stb_image_write valem para o processo todo, não por saída). Com
+// png_fast, os filtros de linha são vetoriais e a compressão usa
+// deflate_zlib (nível 1 = RLE); os filtros escolhidos são os mesmos
+int encode_png(encode_write_func *func, void *context, int width, int height, int channels,
+               const unsigned char *data, const encode_profile_t *profile);
+
+// QOI pelo codificador de qoi.c (cinza vira RGB, cinza + alfa vira RGBA).
+// Retorna 0 se ok
+int encode_qoi(encode_write_func *func, void *context, int width, int height, int channels,
+               const unsigned char *data);
+
+// Cabeçalho PPM/PAM que precede os pixels exatamente como estão na
+// memória: P5 (1 canal) ou P6 (3 canais) no PPM; P7 com DEPTH e TUPLTYPE
+// no PAM. Retorna o tamanho (até RAW_HEADER_MAX), ou 0 se os pixels não
+// podem seguir sem conversão (PPM com alfa)
+int raw_header(output_format_t format, int width, int height, int channels,
+               char *buf, size_t len);
+
+// PPM/PAM completo; no PPM com alfa o alfa é descartado linha a linha.
+// Retorna 0 se ok
+int encode_raw(encode_write_func *func, void *context, output_format_t format,
+               int width, int height, int channels, const unsigned char *data);
+
+// Perfil: preset (default, thumb, archive) e/ou campos separados por '/':
+// qN (qualidade JPEG 1..100), 420 ou 444 (croma), zN (esforço do zlib
+// 1..9), none/sub/up/avg/paeth/adaptive (filtro PNG), fast ou stb
+// (codificador PNG), jpg/png/qoi/ppm/pam (formato das saídas, no lugar da
+// extensão pedida na tarefa). Os campos partem do default, ex.:
+// "archive/q92", "q70/z1/sub", "fast/z2", "qoi". Retorna 0 se ok
+int parse_encode_profile(const char *text, encode_profile_t *profile);
+
+// Chave das estatísticas por perfil: o formato e só os campos que ele usa
+uint32_t encode_stat_key(output_format_t format, const encode_profile_t *profile);
+// "jpg q90 4:2:0", "png z8 adaptive", "png fast z2 up", "qoi"
+void describe_encode_key(uint32_t key, char *buf, size_t len);
+
+#endif // IMAGE_ENCODE_H
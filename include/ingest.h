@@ -0,0 +1,45 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include "common.h"
+
+// Tamanho do buffer de cada chamada getdents64 (lote de entradas)
+#define INGEST_BATCH_SIZE   (1 << 20)
+
+// Arena de nomes: bloco contíguo onde os nomes de um lote ficam
+// empacotados (separados por '\0'), reutilizado a cada lote
+typedef struct {
+    char *data;
+    size_t size;
+    size_t used;
+} name_arena_t;
+
+// Callback chamado para cada imagem encontrada (nome relativo ao diretório)
+typedef int (*ingest_cb_t)(const char *name, void *user);
+
+// Arena de nomes
+int arena_init(name_arena_t *arena, size_t size);
+const char* arena_push(name_arena_t *arena, const char *name, size_t len);
+void arena_reset(name_arena_t *arena);
+void arena_free(name_arena_t *arena);
+
+// Filtro por extensão
+int is_image_file(const char *name);
+
+// Rejeita caminhos com componentes ".." (a saída espelha a entrada)
+int is_safe_relative_path(const char *path);
+
+// Varre o diretório em lotes e despacha cada imagem pelo callback
+// enquanto a varredura continua. Retorna o número de imagens ou -1.
+long ingest_directory_stream(const char *dir_path, ingest_cb_t cb, void *user);
+
+// Percorre a árvore sob dir_path com num_walkers threads (openat/fdopendir
+// por diretório). O callback recebe o caminho relativo e deve ser
+// thread-safe. Retorna o número de imagens ou -1.
+long ingest_tree_parallel(const char *dir_path, int num_walkers, ingest_cb_t cb, void *user);
+
+// Lê uma lista de arquivos ("-" = stdin) separada por delim ('\n' ou '\0').
+// Retorna o número de imagens ou -1.
+long ingest_file_list(const char *list_path, int delim, ingest_cb_t cb, void *user);
+
+#endif // INGEST_H
@@ -6,7 +6,10 @@
 // Fila de mensagens
 mqd_t create_message_queue(const char *name);
 mqd_t open_message_queue(const char *name);
-int send_task(mqd_t mq, const char *filename, int task_id);
+int send_task(mqd_t mq, const char *filename, int task_id, int filter_mask);
+int send_task_message(mqd_t mq, task_message_t *msg);
+void init_task_message(task_message_t *msg, int task_id);
+const char* task_output_prefix(const task_message_t *msg);
 int send_terminate(mqd_t mq);
 int receive_task(mqd_t mq, task_message_t *msg);
 void close_message_queue(mqd_t mq);
@@ -18,8 +21,33 @@ shared_stats_t* open_shared_memory(const char *name, int *shm_fd);
 void close_shared_memory(shared_stats_t *stats, int shm_fd);
 void unlink_shared_memory(const char *name);
 
-// Pipes
-int create_pipe(int pipefd[2]);
+// Estatísticas sem trava: blocos por worker com um único escritor
+int stats_next_task_id(shared_stats_t *stats);
+void stats_count_task(shared_stats_t *stats);     // Tarefa aceita pela fila
+void stats_collect(const shared_stats_t *stats, stats_totals_t *totals);
+// Histogramas de latência somados em todos os workers (leituras relaxadas)
+void stats_merge_latency(const shared_stats_t *stats, worker_latency_t *merged);
+// Codificação somada por perfil (chave) em todos os workers e filtros;
+// retorna quantas entradas de out foram preenchidas (no máximo max)
+int stats_collect_encode(const shared_stats_t *stats, encode_totals_t *out, int max);
+void stats_set_current_file(worker_stats_t *ws, const char *name);
+void stats_get_current_file(const worker_stats_t *ws, char *out);   // out: MAX_FILENAME
+
+// Progresso (eventfd): uma notificação por imagem concluída
+int create_progress_channel(void);
+void notify_progress(int fd);
+
+// Canal de eventos de conclusão (socketpair SOCK_SEQPACKET)
+int create_done_channel(int sv[2]);
+// Com TASK_OUT_MEMORY, os memfds de saída seguem anexados ao evento
+int send_job_done(int fd, const job_done_t *done, const int *fds, int nfds);
+
+// Envio/recepção com descritores anexados (SCM_RIGHTS, até MAX_PASSED_FDS).
+// recv_with_fds devolve os descritores com FD_CLOEXEC em fds[0..*nfds)
+ssize_t send_with_fds(int sock, const void *buf, size_t len,
+                      const int *fds, int nfds, int flags);
+ssize_t recv_with_fds(int sock, void *buf, size_t len,
+                      int *fds, int *nfds, int flags);
 
 // Limpeza geral
 void cleanup_ipc_coordinator(mqd_t mq, shared_stats_t *stats, int shm_fd);
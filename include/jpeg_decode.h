@@ -0,0 +1,29 @@
+#ifndef JPEG_DECODE_H
+#define JPEG_DECODE_H
+
+#include "common.h"
+
+// Decodificação JPEG reduzida na IDCT: com scale 2, 4 ou 8 cada bloco 8×8
+// vira 4×4, 2×2 ou 1×1 direto dos coeficientes de baixa frequência, e a
+// reamostragem de croma e a conversão de cor já rodam no tamanho final.
+// Saída em src / scale (para baixo, mínimo 1), como resize_dimensions,
+// com 1 ou 3 canais como load_image; liberar com free_image.
+// Retorna NULL se a entrada não for JPEG, se o espaço de cor não tiver
+// suporte (CMYK/YCCK) ou em erro: quem chama cai na decodificação completa
+unsigned char* jpeg_load_scaled(const char *filename, int scale,
+                                int *width, int *height, int *channels);
+unsigned char* jpeg_load_scaled_from_memory(const unsigned char *buffer, size_t len, int scale,
+                                            int *width, int *height, int *channels);
+
+// Decodificação só da região [x, x + width) × [y, y + height), que deve
+// caber na imagem. A saída é idêntica ao recorte da imagem cheia. Nas
+// varreduras baseline a decodificação para na última linha de MCUs usada
+// e salta os intervalos de restart que não tocam a região; a IDCT, a
+// reamostragem e a cor rodam só nos blocos e colunas da região. Mesmos
+// canais e casos de NULL que jpeg_load_scaled
+unsigned char* jpeg_load_region(const char *filename, int x, int y, int width, int height,
+                                int *channels);
+unsigned char* jpeg_load_region_from_memory(const unsigned char *buffer, size_t len,
+                                            int x, int y, int width, int height, int *channels);
+
+#endif // JPEG_DECODE_H
@@ -0,0 +1,24 @@
+#ifndef MEM_BUDGET_H
+#define MEM_BUDGET_H
+
+#include "common.h"
+
+// Memória estimada para uma tarefa, a partir das dimensões do cabeçalho:
+// o maior entre a decodificação e a fase de filtros em paralelo
+uint64_t mem_estimate(int width, int height, int channels, int filter_mask, int verify,
+                      int encode_threads);
+
+// Reserva bytes no orçamento compartilhado (-M). Se não couber, a tarefa
+// espera (fica adiada) até outro worker liberar memória; uma tarefa maior
+// que o orçamento inteiro só entra sozinha. Sem orçamento, só contabiliza.
+// Retorna o tempo de espera em ns (0 = admitida na hora)
+uint64_t mem_reserve(shared_stats_t *stats, int worker_id, uint64_t bytes);
+void mem_release(shared_stats_t *stats, int worker_id, uint64_t bytes);
+
+// RSS atual e de pico do processo chamador, no bloco do worker
+void mem_sample_rss(worker_stats_t *ws);
+
+// "512M", "2G", "1048576" -> bytes; 0 se inválido
+uint64_t parse_mem_size(const char *text);
+
+#endif // MEM_BUDGET_H
@@ -0,0 +1,15 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "common.h"
+
+// Exportador de métricas no formato texto do Prometheus. Uma thread do
+// coordenador regrava o arquivo a cada intervalo (textfile collector do
+// node_exporter): escreve ARQ.tmp e renomeia, então quem lê nunca vê um
+// arquivo pela metade. Só lê a memória compartilhada, sem travas
+int metrics_start(const char *path, int interval_ms, shared_stats_t *stats, mqd_t mq);
+
+// Grava o retrato final e encerra a thread
+void metrics_stop(void);
+
+#endif // METRICS_H
@@ -0,0 +1,48 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include "common.h"
+#include <sys/uio.h>
+
+// Pacote de saídas: todas as saídas de um worker concatenadas num arquivo
+// só, com um índice no fim (em vez de um arquivo por saída). Formato,
+// inteiros little-endian:
+//   "IMGPACK1"                              cabeçalho (8 bytes)
+//   dados das saídas, um após o outro
+//   índice: por saída, deslocamento (u64), tamanho (u64), CRC-32 (u32),
+//           tamanho do nome (u16) e o nome (sem '\0')
+//   trailer: deslocamento do índice (u64), entradas (u32), CRC-32 do
+//            índice (u32), "IMGPKEND"   (24 bytes)
+// Sem o trailer (worker interrompido) o pacote é rejeitado na leitura
+#define PACK_HEADER_SIZE    8
+#define PACK_TRAILER_SIZE   24
+#define PACK_MAX_NAME       4096
+#define PACK_BUFFER_SIZE    (4u << 20)  // Dados acumulados antes de cada write
+
+typedef struct pack_writer pack_writer_t;
+
+typedef struct {
+    const char *name;
+    uint64_t offset;
+    uint64_t length;
+    uint32_t crc;
+} pack_entry_t;
+
+// Cria (ou trunca) o pacote em path. Retorna NULL em erro (errno)
+pack_writer_t* pack_create(const char *path);
+
+// Acrescenta uma saída (os blocos de iov, em ordem) com o nome dado.
+// Seguro entre threads: o CRC é calculado fora da trava e os dados vão
+// para um buffer grande, gravado em writes sequenciais. Retorna 0 se ok
+int pack_append(pack_writer_t *pack, const char *name, const struct iovec *iov, int iovcnt);
+
+// Grava o que falta, o índice e o trailer, fecha e libera. Retorna 0 se
+// ok; *entries recebe o número de saídas (pode ser NULL)
+int pack_close(pack_writer_t *pack, uint32_t *entries);
+
+// Lê e valida o índice do pacote aberto em fd com size bytes. Retorna as
+// entradas, em ordem de gravação (um bloco só, nomes inclusos; liberar
+// com free), e o número em *count; NULL se não for um pacote completo
+pack_entry_t* pack_read_index(int fd, uint64_t size, uint32_t *count);
+
+#endif // PACK_H
@@ -0,0 +1,40 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include "common.h"
+
+// Grupo de contadores de uma thread: ciclos (líder), instruções, falhas
+// de LLC e de previsão de desvio, lidos juntos e só em modo usuário
+typedef struct perf_group {
+    int fds[PERF_NUM_COUNTERS];     // -1 = contador indisponível
+    uint64_t ids[PERF_NUM_COUNTERS];
+} perf_group_t;
+
+// Leitura do grupo num instante
+typedef struct {
+    uint64_t time_enabled;
+    uint64_t time_running;
+    uint64_t values[PERF_NUM_COUNTERS];
+} perf_sample_t;
+
+// Verifica se o kernel permite contar ciclos (coordenador, antes do fork).
+// Retorna 0 ou o errno da falha
+int perf_probe(void);
+
+// Abre o grupo para a thread chamadora. Sem o líder (ciclos) falha
+// com -1; os demais contadores são opcionais
+int perf_group_open(perf_group_t *g);
+void perf_group_close(perf_group_t *g);
+
+int perf_group_read(const perf_group_t *g, perf_sample_t *sample);
+
+// Soma a diferença entre duas leituras, corrigindo a multiplexação
+// (contador ativo só parte do tempo)
+void perf_accumulate(perf_totals_t *totals, const perf_group_t *g,
+                     const perf_sample_t *before, const perf_sample_t *after,
+                     uint64_t pixels);
+
+// Texto curto para o motivo de indisponibilidade
+const char* perf_strerror(int err);
+
+#endif // PERF_COUNTERS_H
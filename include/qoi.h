@@ -0,0 +1,24 @@
+#ifndef QOI_H
+#define QOI_H
+
+#include "common.h"
+
+// Cabeçalho QOI: "qoif", largura e altura (big-endian), canais, espaço de cor
+#define QOI_HEADER_SIZE     14
+
+// Codifica em QOI (formato sem perdas de uma passada, sem entropia:
+// índice de cores recentes, diferenças pequenas e repetições). Entradas de
+// 1 ou 2 canais viram RGB/RGBA com R = G = B. Retorna o arquivo completo
+// (liberar com free) e o tamanho em *out_len, ou NULL sem memória
+unsigned char* qoi_encode(const unsigned char *data, int width, int height, int channels,
+                          size_t *out_len);
+
+// Dimensões e canais (3 ou 4) do cabeçalho. Retorna 0 se for QOI válido
+int qoi_info(const unsigned char *buffer, size_t len, int *width, int *height, int *channels);
+
+// Decodifica com os canais do arquivo (3 ou 4). Retorna os pixels
+// (liberar com free) ou NULL se o fluxo for inválido ou truncado
+unsigned char* qoi_decode(const unsigned char *buffer, size_t len,
+                          int *width, int *height, int *channels);
+
+#endif // QOI_H
@@ -0,0 +1,50 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "common.h"
+#include <sys/epoll.h>
+
+// Limites da API de submissão
+#define MAX_CLIENTS         1024
+#define JOB_TABLE_SIZE      4096            // Tarefas em andamento simultâneas
+#define MAX_REQUEST_LINE    (16 * 1024)
+#define MAX_INLINE_BYTES    (256u << 20)    // Imagem enviada no próprio pedido
+#define CLIENT_MAX_FDS      64              // Descritores recebidos ainda não usados
+
+// Protocolo (texto, uma linha por pedido; valores com %XX para espaços):
+//   PING                                  -> PONG
+//   SUBMIT path=P [opções]                -> ACCEPTED <id> [tag]
+//   SUBMIT data=N name=NOME [opções]\n<N bytes da imagem codificada>
+//   SUBMIT fd name=NOME [opções]          (memfd anexado à linha, SCM_RIGHTS)
+//   P é relativo a images/ e DIR a output/ (sem "/" inicial nem "..")
+//   opções: filters=grayscale,blur,resize,crop  out=DIR|-  fmt=jpg|png|qoi|ppm|pam  tag=T
+//           crop=50%|LxA|LxA+X+Y (região do crop; padrão: -C do servidor)
+//           profile=[FILTRO=]PERFIL,... (codificação; padrão: -Q do servidor;
+//           um formato no perfil, ex.: resize=qoi, vale no lugar de fmt=)
+// Eventos assíncronos (pedidos podem ser enviados em pipeline):
+//   DONE <id> ok|fail <ms> <saída>...
+//   ERROR <motivo>
+// Com out=- nada é gravado em disco: cada saída aparece como
+// fd:<filtro>.<fmt> e o memfd correspondente (selado contra escrita)
+// segue anexado à linha do DONE, na mesma ordem
+
+// Cria o socket de escuta e registra-o no epoll, com o canal de conclusão
+// e o eventfd de progresso dos workers (cada imagem concluída libera a fila)
+int server_init(int ep_fd, const char *socket_path, shared_stats_t *stats, int done_fd,
+                int progress_fd);
+
+// Trata um evento do epoll cujo data.u64 pertence ao servidor
+void server_handle_event(const struct epoll_event *ev);
+
+// Reenvia tarefas que aguardam espaço na fila (as que não couberem
+// esperam o próximo aviso de progresso dos workers)
+void server_flush_pending(void);
+
+// Para de aceitar conexões e envia à fila as tarefas ainda pendentes
+// (chamado antes das mensagens de término dos workers)
+void server_drain(void);
+
+// Fecha clientes e libera as imagens em memória (após os workers terminarem)
+void server_shutdown(void);
+
+#endif // SERVER_H
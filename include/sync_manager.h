@@ -11,18 +11,10 @@ void unlink_semaphore(const char *name);
 void sem_acquire(sem_t *sem);
 void sem_release(sem_t *sem);
 
-// Mutex (inicialização para memória compartilhada)
-int init_shared_mutex(pthread_mutex_t *mutex, pthread_mutexattr_t *attr);
-void destroy_mutex(pthread_mutex_t *mutex, pthread_mutexattr_t *attr);
-void mutex_lock(pthread_mutex_t *mutex);
-void mutex_unlock(pthread_mutex_t *mutex);
-
-// Variáveis de condição (para memória compartilhada)
-int init_shared_cond(pthread_cond_t *cond, pthread_condattr_t *attr);
-void destroy_cond(pthread_cond_t *cond, pthread_condattr_t *attr);
-void cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
-void cond_signal(pthread_cond_t *cond);
-void cond_broadcast(pthread_cond_t *cond);
+// Futex em memória compartilhada. futex_wait retorna 0 ao acordar, se o
+// valor já mudou ou no timeout (timeout_ms < 0 = sem limite)
+int futex_wait(unsigned int *addr, unsigned int expected, int timeout_ms);
+void futex_wake_all(unsigned int *addr);
 
 // Limpeza
 void cleanup_sync(sem_t *sem);
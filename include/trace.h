@@ -0,0 +1,94 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+
+// Linha do tempo no formato Chrome trace (chrome://tracing, Perfetto)
+#define TRACE_DEFAULT_EVENTS (1 << 14)          // Por thread (-N); excedentes são descartados
+#define TRACE_MAX_EVENTS    (1 << 24)
+#define TRACE_SLOTS         (NUM_THREADS + 1)   // Thread principal do worker + filtros
+
+typedef enum {
+    TRACE_DISPATCH,             // Coordenador: envio à fila (inclui espera com fila cheia)
+    TRACE_QUEUE_WAIT,           // Da entrada na fila até o worker receber a tarefa
+    TRACE_IO_WAIT,              // Espera pelo semáforo de I/O
+    TRACE_MEM_WAIT,             // Tarefa adiada pelo orçamento de memória (-M)
+    TRACE_DECODE,
+    TRACE_IMAGE,                // Imagem inteira no worker
+    TRACE_FILTER,               // arg = filtro
+    TRACE_ENCODE,               // arg = filtro
+    TRACE_WRITE,                // arg = filtro
+    TRACE_NUM_EVENTS
+} trace_event_id_t;
+
+typedef struct {
+    uint64_t start_ns;          // CLOCK_MONOTONIC
+    uint64_t end_ns;
+    int32_t task_id;
+    uint16_t id;                // trace_event_id_t
+    uint16_t arg;
+} trace_event_t;
+
+// Buffer de uma thread: um único escritor, sem trava
+typedef struct trace_buffer {
+    uint32_t count;
+    uint32_t dropped;
+    uint32_t capacity;
+    trace_event_t events[];
+} __attribute__((aligned(CACHE_LINE_SIZE))) trace_buffer_t;
+
+// Cabeçalho da região; os buffers vêm em seguida, a cada buffer_size bytes
+// (coordenador primeiro, depois TRACE_SLOTS por worker)
+typedef struct {
+    uint64_t origin_ns;         // Instante zero da linha do tempo
+    size_t buffer_size;
+    size_t map_size;
+    int num_workers;
+} trace_shm_t;
+
+// Região compartilhada, herdada pelos workers no fork (NULL = desligado)
+extern trace_shm_t *g_trace;
+
+// Cria a região com events_per_thread eventos por buffer (coordenador,
+// antes do fork)
+int trace_init(int events_per_thread, int num_workers);
+
+// Buffer do coordenador. Só a thread que despacha escreve nele: as da
+// varredura sob dispatch_lock, o laço do modo serviço depois delas
+trace_buffer_t* trace_coordinator_buffer(void);
+
+// Buffer de uma thread do worker (slot 0 = principal, 1 + filtro);
+// NULL com o rastreamento desligado
+trace_buffer_t* trace_worker_buffer(int worker_id, int slot);
+
+// Grava o JSON com os eventos de todos os buffers (após os workers
+// terminarem). *dropped recebe os eventos descartados por buffer cheio
+int trace_write_json(const char *path, const pid_t *worker_pids, uint32_t *dropped);
+
+void trace_shutdown(void);
+
+static inline uint64_t timespec_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * 1000000000ull + ts->tv_nsec;
+}
+
+// Registra um intervalo. Desligado (buf NULL), custa só um teste
+static inline void trace_record(trace_buffer_t *buf, int id, int arg, int task_id,
+                                uint64_t start_ns, uint64_t end_ns) {
+    if (!buf) return;
+    
+    uint32_t n = buf->count;
+    if (n >= buf->capacity) {
+        buf->dropped++;
+        return;
+    }
+    buf->events[n] = (trace_event_t){
+        .start_ns = start_ns,
+        .end_ns = end_ns,
+        .task_id = task_id,
+        .id = (uint16_t)id,
+        .arg = (uint16_t)arg
+    };
+    __atomic_store_n(&buf->count, n + 1, __ATOMIC_RELEASE);
+}
+
+#endif // TRACE_H
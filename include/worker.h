@@ -4,15 +4,12 @@
 #include "common.h"
 
 // Função principal do worker (chamada após fork)
-void worker_main(int worker_id, int pipe_fd);
+void worker_main(int worker_id, int done_fd, int progress_fd);
 
 // Processa uma imagem (cria threads, aplica filtros)
-int process_image(worker_context_t *ctx, const char *filename);
+int process_image(worker_context_t *ctx, const task_message_t *task);
 
-// Atualiza estatísticas na memória compartilhada
-void update_stats(shared_stats_t *stats, int success, double elapsed_time);
-
-// Envia log via pipe
-void send_log(int pipe_fd, int worker_id, const char *message);
+// Atualiza os contadores do worker na memória compartilhada (sem trava)
+void update_stats(worker_stats_t *ws, int success, double elapsed_time);
 
 #endif // WORKER_H
@@ -0,0 +1,207 @@
+#!/bin/bash
+
+# scaling.sh - Teste de escala ponta a ponta (coordenador + workers)
+#
+# Gera um corpus sintético com o image_bench e roda o pipeline completo
+# para cada combinação de workers × filtros × resolução × transporte.
+# Registra tempo de parede, CPU, RSS de pico e o tempo por estágio (do
+# arquivo de métricas), grava CSV e JSON e resume a eficiência de escala.
+# Tudo local: diretório temporário, socket Unix e memfd.
+#
+# Variáveis (padrões entre parênteses):
+#   WORKERS    Contagens de workers ("1 2 4")
+#   FILTERS    Conjuntos de filtros; "all" = todos ("grayscale all")
+#   SIZES      Resoluções do corpus ("640x480 1920x1080")
+#   TRANSPORTS file (lote em images/) e/ou memfd (socket + image_client -m)
+#              ("file memfd")
+#   COUNT      Imagens por corpus (32)
+#   OUT        Prefixo dos resultados (scaling -> scaling.csv, scaling.json)
+
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[0;33m'
+NC='\033[0m'
+
+WORKERS=${WORKERS:-"1 2 4"}
+FILTERS=${FILTERS:-"grayscale all"}
+SIZES=${SIZES:-"640x480 1920x1080"}
+TRANSPORTS=${TRANSPORTS:-"file memfd"}
+COUNT=${COUNT:-32}
+OUT=${OUT:-scaling}
+
+ROOT=$(cd "$(dirname "$0")" && pwd)
+PROCESSOR="$ROOT/image_processor"
+CLIENT="$ROOT/image_client"
+BENCH="$ROOT/image_bench"
+
+# Os nomes de fila/memória/semáforo são fixos: uma instância por vez
+if pgrep -x image_processor > /dev/null; then
+    echo -e "${RED}[ERRO] Há um image_processor em execução; encerre-o antes${NC}"
+    exit 1
+fi
+
+if [[ ! -x $PROCESSOR || ! -x $CLIENT || ! -x $BENCH ]]; then
+    echo -e "${YELLOW}[INFO] Compilando...${NC}"
+    make -C "$ROOT" image_processor image_client image_bench > /dev/null || exit 1
+fi
+
+WORK=$(mktemp -d /tmp/image_scaling.XXXXXX)
+trap 'rm -rf "$WORK"' EXIT
+
+now_ns() {
+    date +%s%N
+}
+
+# Campo numérico de uma linha das estatísticas finais ("  Rótulo:   valor")
+stat_field() {
+    awk -v label="$2" -v n="$3" 'index($0, label) { gsub(/[^0-9. ]/, " "); split($0, v, " "); print v[n]; exit }' "$1"
+}
+
+# Soma de sum/count de um estágio em todas as séries (todos os filtros)
+stage_ms() {
+    awk -v stage="$2" -v images="$3" '
+        index($0, "stage_latency_seconds_sum{stage=\"" stage "\"") { sum += $NF }
+        END { printf "%.3f", (images > 0 ? sum * 1000 / images : 0) }' "$1"
+}
+
+# Sobe o serviço com socket e espera o socket aparecer
+start_server() {
+    local dir=$1 workers=$2
+    (cd "$dir" && exec "$PROCESSOR" -s "$dir/api.sock" -w "$workers" -q -e "$dir/metrics.prom" \
+        > "$dir/run.log" 2>&1) &
+    SERVER_PID=$!
+    for _ in $(seq 100); do
+        [[ -S $dir/api.sock ]] && return 0
+        sleep 0.05
+    done
+    kill "$SERVER_PID" 2>/dev/null
+    return 1
+}
+
+# ============================================================
+# CORPUS
+# ============================================================
+
+echo -e "${YELLOW}[INFO] Gerando corpus ($COUNT imagens por resolução)...${NC}"
+for size in $SIZES; do
+    "$BENCH" -g "$WORK/corpus_$size" -N "$COUNT" -s "$size" > /dev/null || exit 1
+done
+
+# ============================================================
+# GRADE
+# ============================================================
+
+CSV="$OUT.csv"
+echo "transport,filters,size,workers,images,failed,wall_s,images_per_s,mb_per_s,cpu_workers_s,cpu_coordinator_s,cores_busy,rss_worker_kb,rss_coordinator_kb,decode_ms,filter_ms,encode_ms,write_ms,total_ms" > "$CSV"
+
+for transport in $TRANSPORTS; do
+    for filters in $FILTERS; do
+        list=$filters
+        [[ $filters == all ]] && list="grayscale,blur,resize"
+        for size in $SIZES; do
+            corpus="$WORK/corpus_$size"
+            bytes=$(cat "$corpus"/*.jpg | wc -c)
+            for workers in $WORKERS; do
+                run="$WORK/run"
+                rm -rf "$run"
+                mkdir -p "$run/images" "$run/output"
+
+                case $transport in
+                    file)
+                        cp "$corpus"/*.jpg "$run/images/"
+                        start=$(now_ns)
+                        (cd "$run" && "$PROCESSOR" -w "$workers" -f "$list" -q -e "$run/metrics.prom" \
+                            > "$run/run.log" 2>&1)
+                        end=$(now_ns)
+                        ;;
+                    memfd)
+                        if ! start_server "$run" "$workers"; then
+                            echo -e "${RED}[ERRO] Socket não apareceu (workers=$workers)${NC}"
+                            exit 1
+                        fi
+                        start=$(now_ns)
+                        "$CLIENT" -s "$run/api.sock" -m -f "$list" "$corpus"/*.jpg > "$run/client.log" 2>&1
+                        end=$(now_ns)
+                        kill -TERM "$SERVER_PID"
+                        wait "$SERVER_PID"
+                        ;;
+                    *)
+                        echo -e "${RED}[ERRO] Transporte desconhecido: $transport${NC}"
+                        exit 1
+                        ;;
+                esac
+
+                log="$run/run.log"
+                prom="$run/metrics.prom"
+                images=$(stat_field "$log" "Processadas:" 1)
+                failed=$(stat_field "$log" "Falhas:" 1)
+                cpu_w=$(stat_field "$log" "CPU dos workers:" 1)
+                cpu_c=$(stat_field "$log" "CPU do coordenador:" 1)
+                rss_w=$(stat_field "$log" "RSS máximo:" 1)
+                rss_c=$(stat_field "$log" "RSS máximo:" 2)
+
+                awk -v t="$transport" -v f="$filters" -v s="$size" -v w="$workers" \
+                    -v n="${images:-0}" -v fail="${failed:-0}" -v ns="$((end - start))" -v bytes="$bytes" \
+                    -v cw="${cpu_w:-0}" -v cc="${cpu_c:-0}" -v rw="${rss_w:-0}" -v rc="${rss_c:-0}" \
+                    -v dec="$(stage_ms "$prom" decode "${images:-0}")" \
+                    -v fil="$(stage_ms "$prom" filter "${images:-0}")" \
+                    -v enc="$(stage_ms "$prom" encode "${images:-0}")" \
+                    -v wri="$(stage_ms "$prom" write "${images:-0}")" \
+                    -v tot="$(stage_ms "$prom" total "${images:-0}")" 'BEGIN {
+                        wall = ns / 1e9
+                        printf "%s,%s,%s,%d,%d,%d,%.3f,%.2f,%.2f,%.2f,%.2f,%.2f,%d,%d,%s,%s,%s,%s,%s\n",
+                               t, f, s, w, n, fail, wall, n / wall, bytes / wall / 1048576,
+                               cw, cc, (cw + cc) / wall, rw, rc, dec, fil, enc, wri, tot
+                    }' >> "$CSV"
+
+                tail -n 1 "$CSV" | awk -F, '{ printf "  %-6s %-10s %-10s %2s workers: %8s img/s  %7s MB/s  (%s falhas)\n",
+                                                   $1, $2, $3, $4, $8, $9, $6 }'
+            done
+        done
+    done
+done
+
+# ============================================================
+# RESULTADOS
+# ============================================================
+
+# JSON: uma lista de objetos com as colunas do CSV
+awk -F, '
+    NR == 1 { for (i = 1; i <= NF; i++) key[i] = $i; n = NF; print "["; next }
+    {
+        printf "%s  {", (NR > 2 ? ",\n" : "")
+        for (i = 1; i <= n; i++) {
+            v = $i
+            if (v !~ /^-?[0-9.]+$/) v = "\"" v "\""
+            printf "%s\"%s\": %s", (i > 1 ? ", " : ""), key[i], v
+        }
+        printf "}"
+    }
+    END { print "\n]" }' "$CSV" > "$OUT.json"
+
+# Eficiência: vazão relativa à menor contagem de workers do mesmo caso,
+# dividida pelo fator de workers (1.00 = escala linear)
+echo ""
+echo "════════════════════════════════════════════════════════════"
+echo "                  EFICIÊNCIA DE ESCALA"
+echo "════════════════════════════════════════════════════════════"
+awk -F, '
+    NR == 1 { next }
+    {
+        k = $1 " " $2 " " $3
+        if (!(k in base_w) || $4 < base_w[k]) { base_w[k] = $4; base_ips[k] = $8 }
+        row[NR] = $0
+    }
+    END {
+        printf "  %-6s %-10s %-10s %7s %9s %8s %10s\n", "transp", "filtros", "resolução", "workers",
+               "img/s", "speedup", "eficiência"
+        for (r = 2; r <= NR; r++) {
+            split(row[r], c, ",")
+            k = c[1] " " c[2] " " c[3]
+            speedup = base_ips[k] > 0 ? c[8] / base_ips[k] : 0
+            printf "  %-6s %-10s %-10s %7d %9.2f %7.2fx %9.0f%%\n", c[1], c[2], c[3], c[4], c[8],
+                   speedup, speedup / (c[4] / base_w[k]) * 100
+        }
+    }' "$CSV"
+echo "════════════════════════════════════════════════════════════"
+echo -e "${GREEN}✓ Resultados em $CSV e $OUT.json${NC}"
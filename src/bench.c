@@ -0,0 +1,493 @@
+// image_bench - Microbenchmark dos kernels de filtro
+//
+// Gera imagens sintéticas determinísticas e mede apply_grayscale,
+// apply_blur e apply_resize_into isoladamente: aquecimento, várias
+// iterações por caso, ns/pixel e GB/s com dispersão, e JSON opcional.
+// Os casos png e png-fast medem a codificação PNG pelo stb_image_write e
+// pelo caminho rápido (filtros vetoriais + deflate.c), e o caso qoi a
+// codificação QOI, todos com a taxa de compressão.
+// Com -g, grava um corpus de JPEGs sintéticos para o teste de escala
+// ponta a ponta (scaling.sh) em vez de medir.
+
+#include "common.h"
+#include "filters.h"
+#include "image_encode.h"
+#include <getopt.h>
+#include <math.h>
+#include <sys/utsname.h>
+
+#define BENCH_MAX_SIZES     16
+#define BENCH_MAX_ITERS     10000
+
+typedef enum {
+    KERNEL_GRAYSCALE,
+    KERNEL_BLUR,
+    KERNEL_RESIZE,
+    KERNEL_PNG,                 // encode_png pelo stb_image_write
+    KERNEL_PNG_FAST,            // encode_png com png_fast
+    KERNEL_QOI,                 // encode_qoi
+    NUM_KERNELS
+} kernel_t;
+
+// Casos medidos sem -k: os filtros (a codificação PNG é bem mais lenta)
+#define FILTER_KERNELS_MASK ((1 << KERNEL_GRAYSCALE) | (1 << KERNEL_BLUR) | (1 << KERNEL_RESIZE))
+
+typedef struct {
+    int width;
+    int height;
+} bench_size_t;
+
+typedef struct {
+    bench_size_t sizes[BENCH_MAX_SIZES];
+    int num_sizes;
+    int channels[4];
+    int num_channels;
+    int kernels;                // Bits 1 << KERNEL_*
+    int warmup;                 // Iterações descartadas
+    int min_iters;
+    int budget_ms;              // Tempo alvo por caso (após o aquecimento)
+    int kernel_set;             // kernel_set_t medido (-K)
+    encode_profile_t profile;   // Nível e filtro dos casos png (-P)
+    const char *json_path;      // NULL = sem JSON ("-" = stdout)
+    const char *corpus_dir;     // -g: gera imagens em vez de medir
+    int corpus_count;
+} bench_config_t;
+
+// Resultado de um caso (kernel × resolução × canais)
+typedef struct {
+    kernel_t kernel;
+    int width, height, channels;
+    int iterations;
+    double ns_px_mean, ns_px_stddev, ns_px_min, ns_px_median;
+    double gbps_mean, gbps_stddev;
+    double out_ratio;           // Bytes codificados / bytes de entrada (0 = filtro)
+} bench_result_t;
+
+static void print_bench_usage(const char *prog) {
+    printf("Uso: %s [opções]\n", prog);
+    printf("  -s, --sizes LISTA     Resoluções, ex.: 640x480,1920x1080 (padrão: 320x240,1280x720,1920x1080)\n");
+    printf("  -c, --channels LISTA  Canais, ex.: 1,3,4 (padrão: 1,3,4)\n");
+    printf("  -k, --kernels LISTA   grayscale,blur,resize,png,png-fast,qoi (padrão: os três filtros)\n");
+    printf("  -K, --impl NOME       Kernels medidos: ref ou fast (padrão: ref)\n");
+    printf("  -P, --profile PERFIL  Perfil dos casos png, como no -Q (padrão: default)\n");
+    printf("  -w, --warmup N        Iterações de aquecimento, mínimo 1 (padrão: 2)\n");
+    printf("  -n, --min-iters N     Mínimo de iterações medidas (padrão: 5)\n");
+    printf("  -t, --time MS         Tempo alvo por caso (padrão: 300)\n");
+    printf("  -o, --json ARQ        Resultados em JSON (\"-\" = stdout)\n");
+    printf("  -g, --generate DIR    Grava um corpus de JPEGs sintéticos em DIR (usa -s; RGB salvo -c) e sai\n");
+    printf("  -N, --count N         Imagens do corpus, alternando as resoluções (padrão: 16)\n");
+    printf("  -h, --help            Mostra esta ajuda\n");
+}
+
+// ============================================================
+// IMAGENS SINTÉTICAS
+// ============================================================
+
+// xorshift64: mesma sequência em qualquer máquina
+static uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+// Gradiente com ruído: dados realistas o bastante para não favorecer
+// nenhum caminho (imagem constante ou totalmente aleatória)
+static unsigned char* make_image(int width, int height, int channels, uint64_t seed) {
+    unsigned char *img = (unsigned char*)malloc((size_t)width * height * channels);
+    if (!img) return NULL;
+    
+    uint64_t state = 0x9E3779B97F4A7C15ull ^ ((uint64_t)width << 32) ^ ((uint64_t)height << 8) ^
+                     channels ^ (seed * 0xBF58476D1CE4E5B9ull);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t idx = ((size_t)y * width + x) * channels;
+            for (int c = 0; c < channels; c++) {
+                int base = (x * 255 / width + y * 255 / height + c * 85) & 0xFF;
+                int noise = (int)(next_random(&state) & 0x1F) - 16;
+                int v = base + noise;
+                img[idx + c] = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+            }
+        }
+    }
+    return img;
+}
+
+// Corpus para o image_processor: bench_NNNN.jpg, resoluções de -s em
+// rodízio, canais do primeiro valor de -c (RGB sem -c)
+static int generate_corpus(const bench_config_t *cfg) {
+    if (mkdir(cfg->corpus_dir, 0755) == -1 && errno != EEXIST) {
+        LOG_ERROR("%s: %s", cfg->corpus_dir, strerror(errno));
+        return -1;
+    }
+    
+    int channels = cfg->channels[0];
+    for (int i = 0; i < cfg->corpus_count; i++) {
+        const bench_size_t *sz = &cfg->sizes[i % cfg->num_sizes];
+        unsigned char *img = make_image(sz->width, sz->height, channels, i + 1);
+        if (!img) {
+            LOG_ERROR("Sem memória para %dx%d", sz->width, sz->height);
+            return -1;
+        }
+        
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/bench_%04d.jpg", cfg->corpus_dir, i);
+        int rc = save_image(path, img, sz->width, sz->height, channels);
+        free(img);
+        if (rc != 0) return -1;
+    }
+    
+    printf("%d imagens em %s/\n", cfg->corpus_count, cfg->corpus_dir);
+    return 0;
+}
+
+// ============================================================
+// MEDIÇÃO
+// ============================================================
+
+static const char* kernel_name(kernel_t k) {
+    if (k == KERNEL_PNG) return "png";
+    if (k == KERNEL_PNG_FAST) return "png-fast";
+    if (k == KERNEL_QOI) return "qoi";
+    return get_filter_name(k == KERNEL_GRAYSCALE ? FILTER_GRAYSCALE :
+                           k == KERNEL_BLUR ? FILTER_BLUR : FILTER_RESIZE);
+}
+
+// Destino da codificação: só conta os bytes
+static void count_bytes(void *context, void *data, int size) {
+    (void)data;
+    *(size_t*)context += size;
+}
+
+// Uma execução do kernel; retorna a duração em ns (e, na codificação, o
+// tamanho codificado em *encoded)
+static uint64_t run_kernel(const bench_config_t *cfg, kernel_t k, unsigned char *src, unsigned char *dst,
+                           int width, int height, int channels, size_t *encoded) {
+    encode_profile_t profile = cfg->profile;
+    profile.png_fast = k == KERNEL_PNG_FAST;
+    *encoded = 0;
+    uint64_t start = monotonic_ns();
+    switch (k) {
+        case KERNEL_GRAYSCALE:
+            apply_grayscale(src, width, height, channels);
+            break;
+        case KERNEL_BLUR:
+            apply_blur(src, dst, width, height, channels);
+            break;
+        case KERNEL_RESIZE: {
+            int dst_w, dst_h;
+            resize_dimensions(width, height, &dst_w, &dst_h);
+            apply_resize_into(src, width, height, channels, dst, dst_w, dst_h);
+            break;
+        }
+        case KERNEL_PNG:
+        case KERNEL_PNG_FAST:
+            encode_png(count_bytes, encoded, width, height, channels, src, &profile);
+            break;
+        case KERNEL_QOI:
+            encode_qoi(count_bytes, encoded, width, height, channels, src);
+            break;
+        default:
+            break;
+    }
+    return monotonic_ns() - start;
+}
+
+// Bytes tocados por execução: entrada + saída (o grayscale é in-place;
+// na codificação, só a imagem de entrada)
+static double kernel_bytes(kernel_t k, int width, int height, int channels) {
+    double in = (double)width * height * channels;
+    if (k == KERNEL_PNG || k == KERNEL_PNG_FAST || k == KERNEL_QOI) return in;
+    if (k == KERNEL_RESIZE) {
+        int dst_w, dst_h;
+        resize_dimensions(width, height, &dst_w, &dst_h);
+        return in + (double)dst_w * dst_h * channels;
+    }
+    return in * 2;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int run_case(const bench_config_t *cfg, kernel_t k, int width, int height, int channels,
+                    bench_result_t *res) {
+    size_t size = (size_t)width * height * channels;
+    unsigned char *src = make_image(width, height, channels, 0);
+    unsigned char *dst = (unsigned char*)malloc(size);
+    static double ns[BENCH_MAX_ITERS];
+    if (!src || !dst) {
+        free(src);
+        free(dst);
+        LOG_ERROR("Falha ao alocar imagem %dx%dx%d", width, height, channels);
+        return -1;
+    }
+    
+    // Aquecimento: páginas de dst já mapeadas e caches/preditor estáveis.
+    // A última execução calibra o número de iterações
+    uint64_t warm_ns = 1;
+    size_t encoded = 0;
+    for (int i = 0; i < cfg->warmup; i++) {
+        warm_ns = run_kernel(cfg, k, src, dst, width, height, channels, &encoded);
+    }
+    
+    // Iterações suficientes para o tempo alvo, respeitando o mínimo
+    long target = (long)((double)cfg->budget_ms * 1e6 / (warm_ns ? warm_ns : 1));
+    int iters = target < cfg->min_iters ? cfg->min_iters :
+                target > BENCH_MAX_ITERS ? BENCH_MAX_ITERS : (int)target;
+    
+    double pixels = (double)width * height;
+    double bytes = kernel_bytes(k, width, height, channels);
+    double sum = 0, sum_gbps = 0;
+    for (int i = 0; i < iters; i++) {
+        ns[i] = (double)run_kernel(cfg, k, src, dst, width, height, channels, &encoded);
+        sum += ns[i];
+        sum_gbps += bytes / ns[i];      // bytes/ns = GB/s
+    }
+    
+    double mean = sum / iters, mean_gbps = sum_gbps / iters;
+    double var = 0, var_gbps = 0;
+    for (int i = 0; i < iters; i++) {
+        var += (ns[i] - mean) * (ns[i] - mean);
+        double g = bytes / ns[i];
+        var_gbps += (g - mean_gbps) * (g - mean_gbps);
+    }
+    var = iters > 1 ? var / (iters - 1) : 0;
+    var_gbps = iters > 1 ? var_gbps / (iters - 1) : 0;
+    qsort(ns, iters, sizeof(double), compare_double);
+    
+    *res = (bench_result_t){
+        .kernel = k, .width = width, .height = height, .channels = channels,
+        .iterations = iters,
+        .ns_px_mean = mean / pixels,
+        .ns_px_stddev = sqrt(var) / pixels,
+        .ns_px_min = ns[0] / pixels,
+        .ns_px_median = ns[iters / 2] / pixels,
+        .gbps_mean = mean_gbps,
+        .gbps_stddev = sqrt(var_gbps),
+        .out_ratio = encoded / ((double)width * height * channels)
+    };
+    
+    free(src);
+    free(dst);
+    return 0;
+}
+
+// ============================================================
+// SAÍDA
+// ============================================================
+
+// Conteúdo de uma string JSON: aspas, barra invertida e controles escapados
+static void json_escape(FILE *f, const char *s) {
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', f);
+            fputc(c, f);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+}
+
+static void write_json(FILE *f, const bench_config_t *cfg, const bench_result_t *res, int count) {
+    struct utsname uts;
+    if (uname(&uts) == -1) memset(&uts, 0, sizeof(uts));
+    
+    fprintf(f, "{\n  \"benchmark\": \"filters\",\n  \"timestamp\": %lld,\n",
+            (long long)time(NULL));
+    fputs("  \"host\": {\"machine\": \"", f);
+    json_escape(f, uts.machine);
+    fputs("\", \"kernel\": \"", f);
+    json_escape(f, uts.release);
+    fprintf(f, "\", \"cpus\": %ld},\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fputs("  \"compiler\": \"", f);
+    json_escape(f, __VERSION__);
+    fputs("\",\n  \"config\": {\"kernels\": \"", f);
+    json_escape(f, get_filter_kernels(cfg->kernel_set)->name);
+    fprintf(f, "\", \"warmup\": %d, \"min_iters\": %d, \"budget_ms\": %d},\n",
+            cfg->warmup, cfg->min_iters, cfg->budget_ms);
+    fprintf(f, "  \"results\": [");
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *r = &res[i];
+        fprintf(f, "%s\n    {\"kernel\": \"", i ? "," : "");
+        json_escape(f, kernel_name(r->kernel));
+        fprintf(f, "\", \"width\": %d, \"height\": %d, \"channels\": %d, "
+                "\"iterations\": %d,\n     \"ns_per_pixel\": {\"mean\": %.4f, \"stddev\": %.4f, "
+                "\"min\": %.4f, \"median\": %.4f},\n     \"gb_per_s\": {\"mean\": %.4f, \"stddev\": %.4f}",
+                r->width, r->height, r->channels, r->iterations,
+                r->ns_px_mean, r->ns_px_stddev, r->ns_px_min, r->ns_px_median,
+                r->gbps_mean, r->gbps_stddev);
+        if (r->out_ratio > 0) fprintf(f, ", \"output_ratio\": %.4f", r->out_ratio);
+        fputc('}', f);
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+// ============================================================
+// OPÇÕES
+// ============================================================
+
+static int parse_sizes(const char *list, bench_config_t *cfg) {
+    cfg->num_sizes = 0;
+    for (const char *p = list; *p; ) {
+        int w, h, n;
+        if (cfg->num_sizes == BENCH_MAX_SIZES || sscanf(p, "%dx%d%n", &w, &h, &n) != 2 ||
+            w < 2 || h < 2) {
+            return -1;
+        }
+        cfg->sizes[cfg->num_sizes++] = (bench_size_t){ w, h };
+        p += n;
+        if (*p == ',') p++;
+        else if (*p) return -1;
+    }
+    return cfg->num_sizes > 0 ? 0 : -1;
+}
+
+static int parse_channels(const char *list, bench_config_t *cfg) {
+    cfg->num_channels = 0;
+    for (const char *p = list; *p; p++) {
+        if (*p == ',') continue;
+        if ((*p != '1' && *p != '3' && *p != '4') || cfg->num_channels == 4) return -1;
+        cfg->channels[cfg->num_channels++] = *p - '0';
+    }
+    return cfg->num_channels > 0 ? 0 : -1;
+}
+
+static int parse_kernels(const char *list, bench_config_t *cfg) {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "%s", list);
+    cfg->kernels = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        int found = 0;
+        for (int k = 0; k < NUM_KERNELS; k++) {
+            if (strcmp(tok, kernel_name(k)) == 0) {
+                cfg->kernels |= 1 << k;
+                found = 1;
+            }
+        }
+        if (!found) return -1;
+    }
+    return cfg->kernels ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t cfg = {
+        .warmup = 2,
+        .min_iters = 5,
+        .budget_ms = 300,
+        .kernel_set = KERNELS_REFERENCE,
+        .kernels = FILTER_KERNELS_MASK,
+        .profile = ENCODE_PROFILE_DEFAULT,
+        .json_path = NULL,
+        .corpus_dir = NULL,
+        .corpus_count = 16
+    };
+    parse_sizes("320x240,1280x720,1920x1080", &cfg);
+    parse_channels("1,3,4", &cfg);
+    
+    static const struct option long_opts[] = {
+        {"sizes",     required_argument, NULL, 's'},
+        {"channels",  required_argument, NULL, 'c'},
+        {"kernels",   required_argument, NULL, 'k'},
+        {"impl",      required_argument, NULL, 'K'},
+        {"profile",   required_argument, NULL, 'P'},
+        {"warmup",    required_argument, NULL, 'w'},
+        {"min-iters", required_argument, NULL, 'n'},
+        {"time",      required_argument, NULL, 't'},
+        {"json",      required_argument, NULL, 'o'},
+        {"generate",  required_argument, NULL, 'g'},
+        {"count",     required_argument, NULL, 'N'},
+        {"help",      no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    int opt, channels_given = 0;
+    while ((opt = getopt_long(argc, argv, "s:c:k:K:P:w:n:t:o:g:N:h", long_opts, NULL)) != -1) {
+        int bad = 0;
+        switch (opt) {
+            case 's': bad = parse_sizes(optarg, &cfg); break;
+            case 'c': bad = parse_channels(optarg, &cfg); channels_given = 1; break;
+            case 'k': bad = parse_kernels(optarg, &cfg); break;
+            case 'K': cfg.kernel_set = parse_kernel_set(optarg); bad = cfg.kernel_set < 0; break;
+            case 'P': bad = parse_encode_profile(optarg, &cfg.profile); break;
+            case 'w': cfg.warmup = atoi(optarg); bad = cfg.warmup < 1; break;
+            case 'n': cfg.min_iters = atoi(optarg); bad = cfg.min_iters < 1 || cfg.min_iters > BENCH_MAX_ITERS; break;
+            case 't': cfg.budget_ms = atoi(optarg); bad = cfg.budget_ms < 0; break;
+            case 'o': cfg.json_path = optarg; break;
+            case 'g': cfg.corpus_dir = optarg; break;
+            case 'N': cfg.corpus_count = atoi(optarg); bad = cfg.corpus_count < 1; break;
+            case 'h': print_bench_usage(argv[0]); return 0;
+            default:  print_bench_usage(argv[0]); return 1;
+        }
+        if (bad) {
+            LOG_ERROR("Valor inválido para -%c: %s", opt, optarg);
+            return 1;
+        }
+    }
+    
+    if (cfg.corpus_dir) {
+        // Fotos RGB, salvo pedido explícito
+        if (!channels_given) parse_channels("3", &cfg);
+        return generate_corpus(&cfg) == 0 ? 0 : 1;
+    }
+    
+    select_filter_kernels(cfg.kernel_set);
+    int max_results = NUM_KERNELS * BENCH_MAX_SIZES * 4;
+    bench_result_t *results = (bench_result_t*)calloc(max_results, sizeof(bench_result_t));
+    if (!results) return 1;
+    int count = 0;
+    
+    // Com JSON em stdout, a tabela vai para stderr
+    FILE *table = (cfg.json_path && strcmp(cfg.json_path, "-") == 0) ? stderr : stdout;
+    // Larguras em bytes: "resolução", "±" e "mín" têm caracteres de 2 bytes
+    fprintf(table, "%-10s %12s %3s %6s %10s %10s %10s %8s %8s %7s\n", "kernel", "resolução",
+            "ch", "iters", "ns/px", "±", "mín", "GB/s", "±", "saída");
+    
+    for (int k = 0; k < NUM_KERNELS; k++) {
+        if (!(cfg.kernels & (1 << k))) continue;
+        for (int s = 0; s < cfg.num_sizes; s++) {
+            for (int c = 0; c < cfg.num_channels; c++) {
+                // Grayscale não altera imagens sem RGB
+                if (k == KERNEL_GRAYSCALE && cfg.channels[c] < 3) continue;
+                
+                bench_result_t *r = &results[count];
+                if (run_case(&cfg, k, cfg.sizes[s].width, cfg.sizes[s].height, cfg.channels[c], r) != 0) {
+                    continue;
+                }
+                count++;
+                
+                char res[32];
+                snprintf(res, sizeof(res), "%dx%d", r->width, r->height);
+                fprintf(table, "%-10s %10s %3d %6d %10.3f %9.3f %9.3f %8.3f %7.3f",
+                        kernel_name(k), res, r->channels, r->iterations, r->ns_px_mean,
+                        r->ns_px_stddev, r->ns_px_min, r->gbps_mean, r->gbps_stddev);
+                // Tamanho codificado / entrada (só nos casos png)
+                if (r->out_ratio > 0) fprintf(table, " %6.3f\n", r->out_ratio);
+                else fprintf(table, " %6s\n", "-");
+                fflush(table);
+            }
+        }
+    }
+    
+    int rc = 0;
+    if (cfg.json_path) {
+        FILE *f = strcmp(cfg.json_path, "-") == 0 ? stdout : fopen(cfg.json_path, "w");
+        if (!f) {
+            LOG_ERROR("%s: %s", cfg.json_path, strerror(errno));
+            rc = 1;
+        } else {
+            write_json(f, &cfg, results, count);
+            if (f != stdout && fclose(f) != 0) rc = 1;
+        }
+    }
+    
+    free(results);
+    return rc;
+}
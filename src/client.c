@@ -0,0 +1,327 @@
+// image_client - Cliente da API de tarefas do image_processor (modo serviço)
+//
+// Envia todos os pedidos em pipeline e imprime os eventos de conclusão.
+
+#include "common.h"
+#include "ipc_manager.h"
+#include <getopt.h>
+#include <sys/un.h>
+#include <sys/sendfile.h>
+
+static void print_client_usage(const char *prog) {
+    printf("Uso: %s [opções] IMAGEM...\n", prog);
+    printf("  IMAGEM é relativa a %s/ do servidor (com -i ou -m, um arquivo local)\n", INPUT_DIR);
+    printf("  -s, --socket CAMINHO  Socket da API (padrão: %s)\n", DEFAULT_SOCKET_PATH);
+    printf("  -f, --filters LISTA   Filtros, ex.: grayscale,blur (padrão: todos)\n");
+    printf("  -c, --crop GEOM       Região do filtro crop: 50%%, LxA ou LxA+X+Y\n");
+    printf("  -p, --profile PERFIL  Codificação, ex.: thumb ou resize=q70/444\n");
+    printf("  -o, --out DIR         Subdiretório de %s/ do servidor (com -m, diretório local)\n", OUTPUT_DIR);
+    printf("  -F, --format FMT      jpg, png, qoi, ppm ou pam (padrão: jpg)\n");
+    printf("  -i, --inline          Envia os bytes da imagem no pedido\n");
+    printf("  -m, --memory          Entrada e saídas por memfd (nada em disco no servidor);\n");
+    printf("                        com -o, as saídas recebidas são gravadas localmente\n");
+    printf("  -h, --help            Mostra esta ajuda\n");
+}
+
+// Escreve o valor trocando espaços e '%' por %XX
+static void append_encoded(char *dst, size_t cap, const char *value) {
+    size_t len = strlen(dst);
+    for (const char *p = value; *p && len + 4 < cap; p++) {
+        if (*p == ' ' || *p == '%' || (unsigned char)*p < 0x20) {
+            len += snprintf(dst + len, cap - len, "%%%02X", (unsigned char)*p);
+        } else {
+            dst[len++] = *p;
+            dst[len] = '\0';
+        }
+    }
+}
+
+static int write_all(int fd, const void *buf, size_t len) {
+    const char *p = (const char*)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Copia a imagem para um memfd, que segue anexado ao pedido
+static int file_to_memfd(const char *path) {
+    int in = open(path, O_RDONLY | O_CLOEXEC);
+    if (in == -1) return -1;
+    
+    struct stat st;
+    int fd = fstat(in, &st) == 0 ? memfd_create("img_input", MFD_CLOEXEC) : -1;
+    off_t left = fd != -1 ? st.st_size : 0;
+    while (left > 0) {
+        ssize_t n = sendfile(fd, in, NULL, left);
+        if (n <= 0) break;
+        left -= n;
+    }
+    close(in);
+    
+    if (fd != -1 && left > 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+// Nome da entrada sem diretório nem extensão (como o servidor nomeia as
+// saídas em disco: foto.jpg -> foto_resize.png)
+static char* input_stem(const char *path) {
+    const char *base = strrchr(path, '/');
+    char *stem = strdup(base ? base + 1 : path);
+    char *dot = stem ? strrchr(stem, '.') : NULL;
+    if (dot && dot != stem) *dot = '\0';
+    return stem;
+}
+
+// Grava localmente uma saída recebida como memfd
+static void save_received(int fd, const char *dir, const char *stem, const char *name) {
+    struct stat st;
+    if (fstat(fd, &st) == -1) return;
+    printf("  %s: %lld bytes\n", name, (long long)st.st_size);
+    if (!dir || !stem) return;
+    
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s_%s", dir, stem, name);
+    int out = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out == -1) {
+        LOG_ERROR("%s: %s", path, strerror(errno));
+        return;
+    }
+    off_t offset = 0;
+    while (offset < st.st_size) {
+        if (sendfile(out, fd, &offset, st.st_size - offset) <= 0) break;
+    }
+    close(out);
+}
+
+// Envia o conteúdo do arquivo logo após a linha do pedido
+static int send_file_bytes(int sock, const char *path, off_t size) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return -1;
+    
+    char buf[64 * 1024];
+    off_t left = size;
+    while (left > 0) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        if (write_all(sock, buf, n) != 0) break;
+        left -= n;
+    }
+    close(fd);
+    return left == 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *sock_path = DEFAULT_SOCKET_PATH;
+    const char *filters = NULL, *crop = NULL, *profile = NULL, *out_dir = NULL, *fmt = NULL;
+    int send_inline = 0, memory = 0;
+    
+    static const struct option long_opts[] = {
+        {"socket",  required_argument, NULL, 's'},
+        {"filters", required_argument, NULL, 'f'},
+        {"crop",    required_argument, NULL, 'c'},
+        {"profile", required_argument, NULL, 'p'},
+        {"out",     required_argument, NULL, 'o'},
+        {"format",  required_argument, NULL, 'F'},
+        {"inline",  no_argument,       NULL, 'i'},
+        {"memory",  no_argument,       NULL, 'm'},
+        {"help",    no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:f:c:p:o:F:imh", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 's': sock_path = optarg; break;
+            case 'f': filters = optarg; break;
+            case 'c': crop = optarg; break;
+            case 'p': profile = optarg; break;
+            case 'o': out_dir = optarg; break;
+            case 'F': fmt = optarg; break;
+            case 'i': send_inline = 1; break;
+            case 'm': memory = 1; break;
+            case 'h': print_client_usage(argv[0]); return 0;
+            default:  print_client_usage(argv[0]); return 1;
+        }
+    }
+    if (optind >= argc) {
+        print_client_usage(argv[0]);
+        return 1;
+    }
+    
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", sock_path);
+    if (sock == -1 || connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        LOG_ERROR("Falha ao conectar em %s: %s", sock_path, strerror(errno));
+        return 1;
+    }
+    
+    // Com -m, -o é um diretório local; nos outros modos vai no pedido,
+    // relativo ao diretório de saída do servidor
+    char *abs_out = memory && out_dir ? realpath(out_dir, NULL) : NULL;
+    if (memory && out_dir && !abs_out) {
+        LOG_ERROR("Diretório de saída inválido: %s", out_dir);
+        return 1;
+    }
+    
+    // Todos os pedidos vão em pipeline, sem esperar respostas. As
+    // respostas (ACCEPTED ou ERROR) chegam na ordem dos pedidos: o id de
+    // cada tarefa é associado ao nome da entrada pela posição
+    int submitted = 0;
+    char **stems = (char**)calloc(argc, sizeof(char*));
+    int *job_ids = (int*)calloc(argc, sizeof(int));
+    if (!stems || !job_ids) {
+        LOG_ERROR("Sem memória");
+        return 1;
+    }
+    for (int i = optind; i < argc; i++) {
+        char line[3 * PATH_MAX + 256] = "SUBMIT ";
+        int src_fd = -1;
+        
+        if (memory) {
+            src_fd = file_to_memfd(argv[i]);
+            if (src_fd == -1) {
+                LOG_ERROR("%s: %s", argv[i], strerror(errno));
+                continue;
+            }
+            const char *base = strrchr(argv[i], '/');
+            strcat(line, "fd name=");
+            append_encoded(line, sizeof(line), base ? base + 1 : argv[i]);
+        } else if (send_inline) {
+            struct stat st;
+            if (stat(argv[i], &st) == -1) {
+                LOG_ERROR("%s: %s", argv[i], strerror(errno));
+                continue;
+            }
+            const char *base = strrchr(argv[i], '/');
+            snprintf(line + strlen(line), sizeof(line) - strlen(line),
+                     "data=%lld name=", (long long)st.st_size);
+            append_encoded(line, sizeof(line), base ? base + 1 : argv[i]);
+        } else {
+            // Relativo ao diretório de entrada do servidor
+            strcat(line, "path=");
+            append_encoded(line, sizeof(line), argv[i]);
+        }
+        
+        if (filters) {
+            strcat(line, " filters=");
+            append_encoded(line, sizeof(line), filters);
+        }
+        if (crop) {
+            strcat(line, " crop=");
+            append_encoded(line, sizeof(line), crop);
+        }
+        if (profile) {
+            strcat(line, " profile=");
+            append_encoded(line, sizeof(line), profile);
+        }
+        if (memory) {
+            strcat(line, " out=-");
+        } else if (out_dir) {
+            strcat(line, " out=");
+            append_encoded(line, sizeof(line), out_dir);
+        }
+        if (fmt) {
+            strcat(line, " fmt=");
+            append_encoded(line, sizeof(line), fmt);
+        }
+        strcat(line, "\n");
+        
+        // O memfd vai junto do primeiro byte da linha; a cópia local
+        // pode ser fechada logo após o envio
+        size_t line_len = strlen(line);
+        ssize_t first = send_with_fds(sock, line, line_len, &src_fd, src_fd != -1 ? 1 : 0, 0);
+        if (src_fd != -1) close(src_fd);
+        if (first == -1 || write_all(sock, line + first, line_len - first) != 0) {
+            LOG_ERROR("Falha ao enviar pedido: %s", strerror(errno));
+            break;
+        }
+        if (send_inline) {
+            struct stat st;
+            stat(argv[i], &st);
+            if (send_file_bytes(sock, argv[i], st.st_size) != 0) {
+                LOG_ERROR("Falha ao enviar bytes de %s", argv[i]);
+                break;
+            }
+        }
+        stems[submitted++] = input_stem(argv[i]);
+    }
+    
+    // Lê respostas até receber um DONE (ou ERROR) para cada pedido.
+    // Descritores recebidos entram numa fila e são associados, em ordem,
+    // aos campos fd: dos DONE
+    static char buf[MAX_TASK_PATH * 4];
+    size_t len = 0;
+    int fd_queue[MAX_PASSED_FDS * 8];
+    int queued = 0;
+    int finished = 0, failed = 0, replies = 0;
+    
+    while (finished < submitted) {
+        int fds[MAX_PASSED_FDS], nfds;
+        ssize_t n = recv_with_fds(sock, buf + len, sizeof(buf) - len - 1, fds, &nfds, 0);
+        for (int i = 0; i < nfds; i++) {
+            if (queued < (int)(sizeof(fd_queue) / sizeof(fd_queue[0]))) fd_queue[queued++] = fds[i];
+            else close(fds[i]);
+        }
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) continue;
+            break;
+        }
+        len += n;
+        buf[len] = '\0';
+        
+        char *line = buf, *nl;
+        while ((nl = strchr(line, '\n')) != NULL && finished < submitted) {
+            *nl = '\0';
+            printf("%s\n", line);
+            
+            if (strncmp(line, "ACCEPTED ", 9) == 0 && replies < submitted) {
+                job_ids[replies++] = atoi(line + 9);
+            } else if (strncmp(line, "DONE ", 5) == 0) {
+                finished++;
+                if (strstr(line, " fail ")) failed++;
+                
+                int job_id = atoi(line + 5);
+                const char *stem = NULL;
+                for (int j = 0; j < replies && !stem; j++) {
+                    if (job_ids[j] == job_id) stem = stems[j];
+                }
+                char *save = NULL;
+                for (char *tok = strtok_r(line, " ", &save); tok; tok = strtok_r(NULL, " ", &save)) {
+                    if (strncmp(tok, "fd:", 3) != 0 || queued == 0) continue;
+                    int fd = fd_queue[0];
+                    memmove(&fd_queue[0], &fd_queue[1], (--queued) * sizeof(int));
+                    save_received(fd, abs_out, stem, tok + 3);
+                    close(fd);
+                }
+            } else if (strncmp(line, "ERROR", 5) == 0) {
+                // Pedido recusado: ocupa a posição dele na ordem das respostas
+                if (replies < submitted) job_ids[replies++] = 0;
+                finished++;
+                failed++;
+            }
+            line = nl + 1;
+        }
+        len -= line - buf;
+        memmove(buf, line, len);
+    }
+    
+    for (int i = 0; i < queued; i++) close(fd_queue[i]);
+    for (int i = 0; i < submitted; i++) free(stems[i]);
+    free(stems);
+    free(job_ids);
+    free(abs_out);
+    close(sock);
+    int requested = argc - optind;
+    return (failed || finished < requested) ? 1 : 0;
+}
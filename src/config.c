@@ -0,0 +1,268 @@
+#include "config.h"
+#include "filters.h"
+#include "mem_budget.h"
+#include "image_encode.h"
+#include "trace.h"
+#include <getopt.h>
+
+app_config_t g_config = {
+    .recursive = 0,
+    .num_walkers = DEFAULT_WALKERS,
+    .list_file = NULL,
+    .list_delim = '\n',
+    .daemon = 0,
+    .socket_path = NULL,
+    .trace_file = NULL,
+    .trace_events = TRACE_DEFAULT_EVENTS,
+    .perf = 0,
+    .verbosity = 1,
+    .metrics_file = NULL,
+    .metrics_interval_ms = DEFAULT_METRICS_MS,
+    .num_workers = NUM_WORKERS,
+    .filter_mask = FILTER_ALL_MASK,
+    .kernel_set = KERNELS_REFERENCE,
+    .verify = 0,
+    .verify_tolerance = DEFAULT_VERIFY_TOL,
+    .mem_budget = 0,
+    .partial_decode = 1,
+    .scaled_decode = 0,
+    .crop = { .percent = DEFAULT_CROP_PERCENT },
+    .encode_threads = 1,
+    .profiles = { [0 ... NUM_THREADS - 1] = ENCODE_PROFILE_DEFAULT },
+    .pack_prefix = NULL
+};
+
+void print_usage(const char *prog) {
+    printf("Uso: %s [opções]\n", prog);
+    printf("  -r, --recursive       Percorre subdiretórios de %s/\n", INPUT_DIR);
+    printf("  -j, --walkers N       Threads de varredura no modo recursivo (padrão: %d)\n", DEFAULT_WALKERS);
+    printf("  -l, --list ARQ        Lê a lista de imagens de ARQ (\"-\" = stdin)\n");
+    printf("  -0, --null            Lista separada por '\\0' em vez de '\\n'\n");
+    printf("  -d, --daemon          Modo serviço: observa %s/ e processa novas imagens\n", INPUT_DIR);
+    printf("  -s, --socket CAMINHO  API de tarefas via socket Unix (implica -d; ex.: %s)\n", DEFAULT_SOCKET_PATH);
+    printf("  -t, --trace ARQ       Grava a linha do tempo das tarefas em ARQ (chrome://tracing, Perfetto)\n");
+    printf("  -N, --trace-events N  Eventos guardados por thread no trace; os excedentes são\n");
+    printf("                        descartados e contados (padrão: %d)\n", TRACE_DEFAULT_EVENTS);
+    printf("  -p, --perf            Mede ciclos e falhas de cache por filtro (perf_event_open)\n");
+    printf("  -e, --metrics ARQ     Métricas no formato Prometheus em ARQ, regravado periodicamente\n");
+    printf("  -I, --metrics-interval MS  Intervalo entre regravações (padrão: %d)\n", DEFAULT_METRICS_MS);
+    printf("  -w, --workers N       Processos worker (padrão: %d, máximo: %d)\n", NUM_WORKERS, MAX_WORKERS);
+    printf("  -f, --filters LISTA   Filtros aplicados no lote, ex.: grayscale,resize (padrão: todos)\n");
+    printf("  -M, --mem-budget TAM  Memória somada dos workers, ex.: 512M, 2G (adia tarefas; padrão: sem limite)\n");
+    printf("  -K, --kernels NOME    Kernels dos filtros: ref ou fast (padrão: ref)\n");
+    printf("  -V, --verify          Compara kernels rápidos e de referência em cada imagem\n");
+    printf("  -T, --verify-tol N    Maior diferença aceita por amostra (padrão: %d)\n", DEFAULT_VERIFY_TOL);
+    printf("  -C, --crop GEOM       Região do filtro crop: P%%, LxA (centrado) ou LxA+X+Y (padrão: %d%%)\n",
+           DEFAULT_CROP_PERCENT);
+    printf("  -R, --scaled-decode   Só resize: decodifica o JPEG já pela metade (IDCT reduzida);\n");
+    printf("                        a saída usa a média da área, não o vizinho mais próximo\n");
+    printf("  -F, --full-decode     Sempre decodifica JPEG inteiro (sem -R nem decodificação\n");
+    printf("                        só da região no crop)\n");
+    printf("  -E, --encode-threads N  Threads por saída JPEG: faixas com marcadores RST (padrão: 1,\n");
+    printf("                        máximo: %d)\n", MAX_ENCODE_THREADS);
+    printf("  -Q, --profile PERFIL  Perfil de codificação: [FILTRO=]PERFIL[,...], PERFIL = default,\n");
+    printf("                        thumb, archive e/ou campos qN/420/444/zN/none|sub|up|avg|paeth|adaptive/\n");
+    printf("                        fast|stb (codificador PNG)/jpg|png|qoi|ppm|pam (formato da saída)\n");
+    printf("                        separados por '/' (ex.: resize=thumb,blur=qoi; repetível)\n");
+    printf("  -P, --pack PREFIXO    Grava as saídas do lote em PREFIXO-<worker>.pack, com índice\n");
+    printf("                        no fim, em vez de um arquivo por saída (ver image_unpack)\n");
+    printf("  -v, --verbose         Logs detalhados dos workers (início de tarefa, filtros)\n");
+    printf("  -q, --quiet           Só falhas nos logs dos workers\n");
+    printf("  -h, --help            Mostra esta ajuda\n");
+}
+
+int parse_args(int argc, char **argv, app_config_t *cfg) {
+    static const struct option long_opts[] = {
+        {"recursive", no_argument,       NULL, 'r'},
+        {"walkers",   required_argument, NULL, 'j'},
+        {"list",      required_argument, NULL, 'l'},
+        {"null",      no_argument,       NULL, '0'},
+        {"daemon",    no_argument,       NULL, 'd'},
+        {"socket",    required_argument, NULL, 's'},
+        {"trace",     required_argument, NULL, 't'},
+        {"trace-events", required_argument, NULL, 'N'},
+        {"perf",      no_argument,       NULL, 'p'},
+        {"metrics",   required_argument, NULL, 'e'},
+        {"metrics-interval", required_argument, NULL, 'I'},
+        {"workers",   required_argument, NULL, 'w'},
+        {"filters",   required_argument, NULL, 'f'},
+        {"mem-budget", required_argument, NULL, 'M'},
+        {"kernels",   required_argument, NULL, 'K'},
+        {"verify",    no_argument,       NULL, 'V'},
+        {"verify-tol", required_argument, NULL, 'T'},
+        {"crop",      required_argument, NULL, 'C'},
+        {"scaled-decode", no_argument,   NULL, 'R'},
+        {"full-decode", no_argument,     NULL, 'F'},
+        {"encode-threads", required_argument, NULL, 'E'},
+        {"profile",   required_argument, NULL, 'Q'},
+        {"pack",      required_argument, NULL, 'P'},
+        {"verbose",   no_argument,       NULL, 'v'},
+        {"quiet",     no_argument,       NULL, 'q'},
+        {"help",      no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "rj:l:0ds:t:N:pe:I:w:f:M:K:VT:C:RFE:Q:P:vqh", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'r':
+                cfg->recursive = 1;
+                break;
+            case 'j':
+                cfg->num_walkers = atoi(optarg);
+                if (cfg->num_walkers < 1 || cfg->num_walkers > MAX_WALKERS) {
+                    LOG_ERROR("Número de walkers inválido: %s (1..%d)", optarg, MAX_WALKERS);
+                    return -1;
+                }
+                break;
+            case 'l':
+                cfg->list_file = optarg;
+                break;
+            case '0':
+                cfg->list_delim = '\0';
+                break;
+            case 'd':
+                cfg->daemon = 1;
+                break;
+            case 's':
+                cfg->socket_path = optarg;
+                cfg->daemon = 1;
+                break;
+            case 't':
+                cfg->trace_file = optarg;
+                break;
+            case 'N':
+                cfg->trace_events = atoi(optarg);
+                if (cfg->trace_events < 1 || cfg->trace_events > TRACE_MAX_EVENTS) {
+                    LOG_ERROR("Eventos de trace inválidos: %s (1..%d)", optarg, TRACE_MAX_EVENTS);
+                    return -1;
+                }
+                break;
+            case 'p':
+                cfg->perf = 1;
+                break;
+            case 'e':
+                cfg->metrics_file = optarg;
+                break;
+            case 'I':
+                cfg->metrics_interval_ms = atoi(optarg);
+                if (cfg->metrics_interval_ms < 10) {
+                    LOG_ERROR("Intervalo de métricas inválido: %s (mínimo 10 ms)", optarg);
+                    return -1;
+                }
+                break;
+            case 'w':
+                cfg->num_workers = atoi(optarg);
+                if (cfg->num_workers < 1 || cfg->num_workers > MAX_WORKERS) {
+                    LOG_ERROR("Número de workers inválido: %s (1..%d)", optarg, MAX_WORKERS);
+                    return -1;
+                }
+                break;
+            case 'f':
+                cfg->filter_mask = parse_filter_list(optarg);
+                if (cfg->filter_mask <= 0) {
+                    LOG_ERROR("Lista de filtros inválida: %s", optarg);
+                    return -1;
+                }
+                break;
+            case 'M':
+                cfg->mem_budget = parse_mem_size(optarg);
+                if (cfg->mem_budget == 0) {
+                    LOG_ERROR("Orçamento de memória inválido: %s", optarg);
+                    return -1;
+                }
+                break;
+            case 'K':
+                cfg->kernel_set = parse_kernel_set(optarg);
+                if (cfg->kernel_set < 0) {
+                    LOG_ERROR("Kernels desconhecidos: %s (ref ou fast)", optarg);
+                    return -1;
+                }
+                break;
+            case 'V':
+                cfg->verify = 1;
+                break;
+            case 'T':
+                cfg->verify_tolerance = atoi(optarg);
+                if (cfg->verify_tolerance < 0 || cfg->verify_tolerance > 255) {
+                    LOG_ERROR("Tolerância inválida: %s (0..255)", optarg);
+                    return -1;
+                }
+                break;
+            case 'C':
+                if (parse_crop_spec(optarg, &cfg->crop) != 0) {
+                    LOG_ERROR("Região de crop inválida: %s (ex.: 50%%, 640x480, 640x480+10+20)", optarg);
+                    return -1;
+                }
+                break;
+            case 'R':
+                cfg->scaled_decode = 1;
+                break;
+            case 'F':
+                cfg->partial_decode = 0;
+                break;
+            case 'Q':
+                if (parse_encode_profiles(optarg, cfg->profiles) != 0) {
+                    LOG_ERROR("Perfil de codificação inválido: %s (ex.: thumb, resize=q70/z1/sub)", optarg);
+                    return -1;
+                }
+                break;
+            case 'P':
+                cfg->pack_prefix = optarg;
+                break;
+            case 'E':
+                cfg->encode_threads = atoi(optarg);
+                if (cfg->encode_threads < 1 || cfg->encode_threads > MAX_ENCODE_THREADS) {
+                    LOG_ERROR("Threads de codificação inválidas: %s (1..%d)", optarg, MAX_ENCODE_THREADS);
+                    return -1;
+                }
+                break;
+            case 'v':
+                cfg->verbosity++;
+                break;
+            case 'q':
+                cfg->verbosity = 0;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 1;
+            default:
+                print_usage(argv[0]);
+                return -1;
+        }
+    }
+    
+    if (cfg->recursive && cfg->list_file) {
+        LOG_ERROR("Use --recursive ou --list, não ambos");
+        return -1;
+    }
+    if (cfg->daemon && cfg->pack_prefix) {
+        LOG_ERROR("--pack só vale no modo lote (o índice é gravado no fim)");
+        return -1;
+    }
+    if (cfg->daemon && cfg->list_file) {
+        LOG_ERROR("--daemon observa %s/ e não combina com --list", INPUT_DIR);
+        return -1;
+    }
+    if (cfg->daemon && cfg->recursive) {
+        // O inotify observa só o nível superior: subdiretórios seriam ignorados
+        LOG_ERROR("--daemon observa só o nível superior de %s/ e não combina com --recursive",
+                  INPUT_DIR);
+        return -1;
+    }
+    if (cfg->scaled_decode && !cfg->partial_decode) {
+        LOG_ERROR("--scaled-decode e --full-decode são opostos");
+        return -1;
+    }
+    
+    return 0;
+}
+
+encode_profile_t task_profile(const task_message_t *task, int filter) {
+    return task->profiles[filter].jpeg_quality ? task->profiles[filter] : g_config.profiles[filter];
+}
+
+const char* task_output_ext(const task_message_t *task, int filter) {
+    encode_profile_t profile = task_profile(task, filter);
+    return profile.format ? output_format_ext((output_format_t)(profile.format - 1)) : task->out_ext;
+}
@@ -0,0 +1,162 @@
+#include "daemon.h"
+#include "server.h"
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+
+// Tamanho do buffer de leitura de eventos inotify
+#define INOTIFY_BUF_SIZE    (64 * 1024)
+
+// ============================================================
+// SINAIS
+// ============================================================
+
+static void termination_sigset(sigset_t *set) {
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTERM);
+}
+
+int daemon_block_signals(void) {
+    sigset_t set;
+    termination_sigset(&set);
+    
+    if (pthread_sigmask(SIG_BLOCK, &set, NULL) != 0) {
+        LOG_ERROR("Falha ao bloquear sinais");
+        return -1;
+    }
+    return 0;
+}
+
+// ============================================================
+// EVENTOS INOTIFY
+// ============================================================
+
+// Lê os eventos pendentes e despacha as imagens novas
+static int handle_inotify(int fd, ingest_cb_t dispatch, void *user) {
+    char buf[INOTIFY_BUF_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+    
+    while (1) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len == -1) {
+            if (errno == EAGAIN) return 0;
+            if (errno == EINTR) continue;
+            perror("read (inotify)");
+            return -1;
+        }
+        
+        for (char *p = buf; p < buf + len; ) {
+            struct inotify_event *ev = (struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            
+            if (ev->mask & IN_Q_OVERFLOW) {
+                LOG_ERROR("Fila do inotify transbordou: eventos perdidos");
+                continue;
+            }
+            if (ev->mask & IN_ISDIR) continue;
+            if (ev->len == 0 || !is_image_file(ev->name)) continue;
+            
+            LOG_COORD("Nova imagem: %s", ev->name);
+            dispatch(ev->name, user);
+        }
+    }
+}
+
+// ============================================================
+// LAÇO PRINCIPAL DO MODO SERVIÇO
+// ============================================================
+
+// Descritores do laço de eventos (somente no coordenador)
+static int ino_fd = -1;
+static int sig_fd = -1;
+static int ep_fd = -1;
+
+int daemon_init(void) {
+    ino_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (ino_fd == -1) {
+        perror("inotify_init1");
+        return -1;
+    }
+    
+    if (inotify_add_watch(ino_fd, INPUT_DIR, DAEMON_WATCH_MASK) == -1) {
+        LOG_ERROR("Falha ao observar %s/: %s", INPUT_DIR, strerror(errno));
+        daemon_shutdown();
+        return -1;
+    }
+    
+    // SIGINT/SIGTERM já estão bloqueados: chegam pelo signalfd
+    sigset_t set;
+    termination_sigset(&set);
+    sig_fd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sig_fd == -1) {
+        perror("signalfd");
+        daemon_shutdown();
+        return -1;
+    }
+    
+    ep_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (ep_fd == -1) {
+        perror("epoll_create1");
+        daemon_shutdown();
+        return -1;
+    }
+    
+    struct epoll_event ev = { .events = EPOLLIN };
+    ev.data.u64 = EV_TAG(EV_INOTIFY, 0);
+    epoll_ctl(ep_fd, EPOLL_CTL_ADD, ino_fd, &ev);
+    ev.data.u64 = EV_TAG(EV_SIGNAL, 0);
+    epoll_ctl(ep_fd, EPOLL_CTL_ADD, sig_fd, &ev);
+    
+    return 0;
+}
+
+int daemon_run(ingest_cb_t dispatch, void *user) {
+    LOG_COORD("Modo serviço: observando %s/ (Ctrl+C para encerrar)", INPUT_DIR);
+    
+    int running = 1;
+    int result = 0;
+    
+    while (running) {
+        // Sem timeout: tarefas da API que aguardam espaço na fila são
+        // reenviadas a cada aviso de progresso dos workers
+        struct epoll_event events[64];
+        int n = epoll_wait(ep_fd, events, 64, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            result = -1;
+            break;
+        }
+        
+        for (int i = 0; i < n; i++) {
+            int type = EV_TYPE(events[i].data.u64);
+            if (type == EV_SIGNAL) {
+                struct signalfd_siginfo si;
+                if (read(sig_fd, &si, sizeof(si)) == sizeof(si)) {
+                    LOG_COORD("Sinal %d recebido: encerrando serviço", (int)si.ssi_signo);
+                }
+                running = 0;
+            } else if (type == EV_INOTIFY) {
+                if (handle_inotify(ino_fd, dispatch, user) != 0) {
+                    result = -1;
+                    running = 0;
+                }
+            } else {
+                server_handle_event(&events[i]);
+            }
+        }
+    }
+    
+    return result;
+}
+
+int daemon_epoll_fd(void) {
+    return ep_fd;
+}
+
+void daemon_shutdown(void) {
+    if (ep_fd != -1) close(ep_fd);
+    if (sig_fd != -1) close(sig_fd);
+    if (ino_fd != -1) close(ino_fd);
+    ep_fd = sig_fd = ino_fd = -1;
+}
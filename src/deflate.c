@@ -0,0 +1,609 @@
+#include "deflate.h"
+
+#define WINDOW_SIZE     32768
+#define HASH_BITS       15
+#define MIN_MATCH       4               // A tabela hash indexa 4 bytes
+#define MAX_MATCH       258
+#define BLOCK_SYMBOLS   (1 << 16)       // Símbolos por bloco Huffman
+#define LITLEN_CODES    286
+#define DIST_CODES      30
+#define CODELEN_CODES   19
+#define MAX_CODE_BITS   15
+#define MAX_CODELEN_BITS 7
+#define MATCH_FLAG      0x80000000u     // Símbolo: flag | (comprimento - 3) << 16 | (distância - 1)
+
+// ============================================================
+// TABELAS
+// ============================================================
+
+static const unsigned short len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const unsigned char len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short dist_base[DIST_CODES] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const unsigned char dist_extra[DIST_CODES] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+// Ordem dos comprimentos do alfabeto de comprimentos no cabeçalho
+static const unsigned char codelen_order[CODELEN_CODES] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+static unsigned char len_code[256];     // comprimento - 3 -> código - 257
+static unsigned char dist_code[512];    // distância - 1 < 256 direto; acima, 256 + (d >> 7)
+static uint32_t crc_table[4][256];      // Slicing-by-4
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void build_tables(void) {
+    // Em ordem crescente: 258 (código 28) sobrescreve o fim da faixa do 27
+    for (int c = 0; c < 29; c++) {
+        for (int l = len_base[c]; l < len_base[c] + (1 << len_extra[c]) && l <= MAX_MATCH; l++) {
+            len_code[l - 3] = (unsigned char)c;
+        }
+    }
+    for (int c = 0; c < DIST_CODES; c++) {
+        for (int d = dist_base[c] - 1; d < dist_base[c] - 1 + (1 << dist_extra[c]); d++) {
+            if (d < 256) dist_code[d] = (unsigned char)c;
+            else dist_code[256 + (d >> 7)] = (unsigned char)c;
+        }
+    }
+    
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = crc_table[0][n];
+        for (int k = 1; k < 4; k++) {
+            c = crc_table[0][c & 0xFF] ^ (c >> 8);
+            crc_table[k][n] = c;
+        }
+    }
+}
+
+// ============================================================
+// SOMAS DE VERIFICAÇÃO
+// ============================================================
+
+uint32_t adler32_update(uint32_t adler, const unsigned char *data, size_t len) {
+    uint32_t a = adler & 0xFFFF, b = adler >> 16;
+    
+    while (len > 0) {
+        // 5552: maior bloco sem estourar 32 bits antes do módulo
+        size_t n = len < 5552 ? len : 5552;
+        len -= n;
+        for (; n >= 4; n -= 4, data += 4) {
+            a += data[0]; b += a;
+            a += data[1]; b += a;
+            a += data[2]; b += a;
+            a += data[3]; b += a;
+        }
+        while (n-- > 0) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return b << 16 | a;
+}
+
+uint32_t crc32_update(uint32_t crc, const unsigned char *data, size_t len) {
+    pthread_once(&tables_once, build_tables);
+    
+    crc = ~crc;
+    for (; len >= 4; len -= 4, data += 4) {
+        crc ^= (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 |
+               (uint32_t)data[3] << 24;
+        crc = crc_table[3][crc & 0xFF] ^ crc_table[2][(crc >> 8) & 0xFF] ^
+              crc_table[1][(crc >> 16) & 0xFF] ^ crc_table[0][crc >> 24];
+    }
+    while (len-- > 0) crc = crc_table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// ============================================================
+// ESCRITA DE BITS
+// ============================================================
+
+// Bits saem do menos significativo para o mais (ordem do deflate)
+typedef struct {
+    unsigned char *out;
+    size_t len, cap;
+    uint64_t bits;
+    int count;
+} bit_writer_t;
+
+static int ensure_space(bit_writer_t *bw, size_t extra) {
+    if (bw->len + extra <= bw->cap) return 0;
+    size_t cap = bw->cap * 2;
+    if (cap < bw->len + extra) cap = bw->len + extra;
+    unsigned char *out = (unsigned char*)realloc(bw->out, cap);
+    if (!out) return -1;
+    bw->out = out;
+    bw->cap = cap;
+    return 0;
+}
+
+// n <= 16; o espaço já foi reservado por ensure_space
+static inline void put_bits(bit_writer_t *bw, uint32_t value, int n) {
+    bw->bits |= (uint64_t)value << bw->count;
+    bw->count += n;
+    if (bw->count >= 32) {
+        unsigned char *o = bw->out + bw->len;
+        o[0] = (unsigned char)bw->bits;
+        o[1] = (unsigned char)(bw->bits >> 8);
+        o[2] = (unsigned char)(bw->bits >> 16);
+        o[3] = (unsigned char)(bw->bits >> 24);
+        bw->len += 4;
+        bw->bits >>= 32;
+        bw->count -= 32;
+    }
+}
+
+// Completa o byte atual com zeros
+static void align_byte(bit_writer_t *bw) {
+    while (bw->count > 0) {
+        bw->out[bw->len++] = (unsigned char)bw->bits;
+        bw->bits >>= 8;
+        bw->count -= 8;
+    }
+    bw->bits = 0;
+    bw->count = 0;
+}
+
+// ============================================================
+// CÓDIGOS DE HUFFMAN
+// ============================================================
+
+// Comprimentos de um código de Huffman mínimo, no lugar (Moffat e
+// Katajainen): a[] chega com os pesos em ordem crescente e sai com o
+// comprimento de cada posição
+static void minimum_redundancy(uint32_t *a, int n) {
+    if (n == 1) {
+        a[0] = 1;
+        return;
+    }
+    
+    a[0] += a[1];
+    int root = 0, leaf = 2;
+    for (int next = 1; next < n - 1; next++) {
+        if (leaf >= n || a[root] < a[leaf]) {
+            a[next] = a[root];
+            a[root++] = next;
+        } else {
+            a[next] = a[leaf++];
+        }
+        if (leaf >= n || (root < next && a[root] < a[leaf])) {
+            a[next] += a[root];
+            a[root++] = next;
+        } else {
+            a[next] += a[leaf++];
+        }
+    }
+    
+    a[n - 2] = 0;
+    for (int next = n - 3; next >= 0; next--) a[next] = a[a[next]] + 1;
+    
+    // Folhas por profundidade, a partir da raiz
+    int avbl = 1, used = 0, depth = 0, next = n - 1;
+    root = n - 2;
+    while (avbl > 0) {
+        while (root >= 0 && (int)a[root] == depth) {
+            used++;
+            root--;
+        }
+        while (avbl > used) {
+            a[next--] = depth;
+            avbl--;
+        }
+        avbl = 2 * used;
+        depth++;
+        used = 0;
+    }
+}
+
+// Comprimentos limitados a max_bits para as frequências dadas. Um só
+// símbolo usado ganha um par de 1 bit (código completo, aceito por
+// qualquer decodificador)
+static void build_lengths(const uint32_t *freq, int n, int max_bits, unsigned char *lens) {
+    int syms[LITLEN_CODES];
+    uint32_t weight[LITLEN_CODES];
+    int used = 0;
+    
+    memset(lens, 0, n);
+    for (int i = 0; i < n; i++) {
+        if (freq[i] == 0) continue;
+        // Inserção ordenada por frequência (no máximo 286 símbolos)
+        int j = used++;
+        while (j > 0 && freq[syms[j - 1]] > freq[i]) {
+            syms[j] = syms[j - 1];
+            j--;
+        }
+        syms[j] = i;
+    }
+    if (used == 0) return;
+    if (used == 1) {
+        lens[syms[0]] = 1;
+        lens[syms[0] == 0 ? 1 : 0] = 1;
+        return;
+    }
+    
+    for (int i = 0; i < used; i++) weight[i] = freq[syms[i]];
+    minimum_redundancy(weight, used);
+    
+    int count[33] = { 0 };
+    for (int i = 0; i < used; i++) count[weight[i] > 32 ? 32 : weight[i]]++;
+    
+    // Códigos longos demais encurtam para max_bits; a desigualdade de
+    // Kraft é refeita alongando códigos mais curtos, um de cada vez
+    for (int i = max_bits + 1; i <= 32; i++) {
+        count[max_bits] += count[i];
+        count[i] = 0;
+    }
+    uint32_t total = 0;
+    for (int i = max_bits; i > 0; i--) total += (uint32_t)count[i] << (max_bits - i);
+    while (total != 1u << max_bits) {
+        count[max_bits]--;
+        for (int i = max_bits - 1; i > 0; i--) {
+            if (count[i]) {
+                count[i]--;
+                count[i + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+    
+    // Os mais frequentes (fim da ordem) recebem os códigos curtos
+    int j = used;
+    for (int bits = 1; bits <= max_bits; bits++) {
+        for (int k = count[bits]; k > 0; k--) lens[syms[--j]] = (unsigned char)bits;
+    }
+}
+
+// Códigos canônicos, já invertidos para a escrita do bit menos significativo
+static void build_codes(const unsigned char *lens, int n, unsigned short *codes) {
+    int count[MAX_CODE_BITS + 1] = { 0 }, next[MAX_CODE_BITS + 1];
+    for (int i = 0; i < n; i++) count[lens[i]]++;
+    count[0] = 0;
+    
+    int code = 0;
+    for (int bits = 1; bits <= MAX_CODE_BITS; bits++) {
+        code = (code + count[bits - 1]) << 1;
+        next[bits] = code;
+    }
+    for (int i = 0; i < n; i++) {
+        int len = lens[i];
+        if (len == 0) continue;
+        unsigned int c = next[len]++, rev = 0;
+        for (int b = 0; b < len; b++, c >>= 1) rev = rev << 1 | (c & 1);
+        codes[i] = (unsigned short)rev;
+    }
+}
+
+// ============================================================
+// BLOCOS
+// ============================================================
+
+static inline int match_dist_code(uint32_t dist) {
+    return dist <= 256 ? dist_code[dist - 1] : dist_code[256 + ((dist - 1) >> 7)];
+}
+
+// Blocos armazenados (até 65535 bytes cada)
+static void write_stored(bit_writer_t *bw, const unsigned char *raw, size_t len, int final) {
+    do {
+        size_t n = len < 65535 ? len : 65535;
+        put_bits(bw, final && n == len, 1);
+        put_bits(bw, 0, 2);
+        align_byte(bw);
+        unsigned char *o = bw->out + bw->len;
+        o[0] = (unsigned char)n;
+        o[1] = (unsigned char)(n >> 8);
+        o[2] = (unsigned char)~n;
+        o[3] = (unsigned char)(~n >> 8);
+        memcpy(o + 4, raw, n);
+        bw->len += 4 + n;
+        raw += n;
+        len -= n;
+    } while (len > 0);
+}
+
+// Um bloco com os símbolos de raw[0, raw_len): Huffman dinâmico ou, se
+// sair maior, armazenado
+static int write_block(bit_writer_t *bw, const uint32_t *syms, int nsyms,
+                       const unsigned char *raw, size_t raw_len, int final) {
+    // Pior caso: 48 bits por símbolo ou os bytes crus, mais cabeçalhos
+    size_t worst = (size_t)nsyms * 6 + raw_len + 5 * (raw_len / 65535 + 1) + 1024;
+    if (ensure_space(bw, worst) != 0) return -1;
+    
+    uint32_t lfreq[LITLEN_CODES] = { 0 }, dfreq[DIST_CODES] = { 0 };
+    uint64_t extra_bits = 0;
+    int matches = 0;
+    for (int i = 0; i < nsyms; i++) {
+        uint32_t s = syms[i];
+        if (!(s & MATCH_FLAG)) {
+            lfreq[s]++;
+            continue;
+        }
+        int lc = len_code[(s >> 16) & 0xFF], dc = match_dist_code((s & 0x7FFF) + 1);
+        lfreq[257 + lc]++;
+        dfreq[dc]++;
+        matches++;
+        extra_bits += len_extra[lc] + dist_extra[dc];
+    }
+    lfreq[256] = 1;
+    
+    unsigned char llens[LITLEN_CODES], dlens[DIST_CODES];
+    build_lengths(lfreq, LITLEN_CODES, MAX_CODE_BITS, llens);
+    build_lengths(dfreq, DIST_CODES, MAX_CODE_BITS, dlens);
+    if (matches == 0) {
+        // Sem distâncias: um código completo de 2 símbolos que nunca aparece
+        dlens[0] = dlens[1] = 1;
+    }
+    
+    int hlit = LITLEN_CODES, hdist = DIST_CODES;
+    while (hlit > 257 && llens[hlit - 1] == 0) hlit--;
+    while (hdist > 1 && dlens[hdist - 1] == 0) hdist--;
+    
+    // Comprimentos dos dois alfabetos em sequência, com repetições (16),
+    // corridas curtas (17) e longas (18) de zeros
+    unsigned char all[LITLEN_CODES + DIST_CODES];
+    memcpy(all, llens, hlit);
+    memcpy(all + hlit, dlens, hdist);
+    int total = hlit + hdist;
+    unsigned char rle_sym[LITLEN_CODES + DIST_CODES], rle_extra[LITLEN_CODES + DIST_CODES];
+    int nrle = 0;
+    uint32_t cfreq[CODELEN_CODES] = { 0 };
+    for (int i = 0; i < total; ) {
+        int l = all[i], run = 1;
+        while (i + run < total && all[i + run] == l) run++;
+        i += run;
+        
+        if (l == 0) {
+            while (run >= 11) {
+                int n = run < 138 ? run : 138;
+                rle_sym[nrle] = 18;
+                rle_extra[nrle++] = (unsigned char)(n - 11);
+                run -= n;
+            }
+            if (run >= 3) {
+                rle_sym[nrle] = 17;
+                rle_extra[nrle++] = (unsigned char)(run - 3);
+                run = 0;
+            }
+        } else {
+            rle_sym[nrle] = (unsigned char)l;
+            rle_extra[nrle++] = 0;
+            run--;
+            while (run >= 3) {
+                int n = run < 6 ? run : 6;
+                rle_sym[nrle] = 16;
+                rle_extra[nrle++] = (unsigned char)(n - 3);
+                run -= n;
+            }
+        }
+        while (run-- > 0) {
+            rle_sym[nrle] = (unsigned char)l;
+            rle_extra[nrle++] = 0;
+        }
+    }
+    for (int i = 0; i < nrle; i++) cfreq[rle_sym[i]]++;
+    
+    unsigned char clens[CODELEN_CODES];
+    build_lengths(cfreq, CODELEN_CODES, MAX_CODELEN_BITS, clens);
+    int hclen = CODELEN_CODES;
+    while (hclen > 4 && clens[codelen_order[hclen - 1]] == 0) hclen--;
+    
+    // Tamanho do bloco dinâmico contra o armazenado (com alinhamento)
+    uint64_t dyn_bits = 3 + 14 + 3 * hclen + extra_bits;
+    for (int i = 0; i < CODELEN_CODES; i++) dyn_bits += (uint64_t)cfreq[i] * clens[i];
+    dyn_bits += 2 * (uint64_t)cfreq[16] + 3 * (uint64_t)cfreq[17] + 7 * (uint64_t)cfreq[18];
+    for (int i = 0; i < LITLEN_CODES; i++) dyn_bits += (uint64_t)lfreq[i] * llens[i];
+    for (int i = 0; i < DIST_CODES; i++) dyn_bits += (uint64_t)dfreq[i] * dlens[i];
+    uint64_t stored_bits = (raw_len + 5 * (raw_len / 65535 + 1)) * 8 + 7;
+    if (stored_bits < dyn_bits) {
+        write_stored(bw, raw, raw_len, final);
+        return 0;
+    }
+    
+    unsigned short lcodes[LITLEN_CODES], dcodes[DIST_CODES], ccodes[CODELEN_CODES];
+    build_codes(llens, LITLEN_CODES, lcodes);
+    build_codes(dlens, DIST_CODES, dcodes);
+    build_codes(clens, CODELEN_CODES, ccodes);
+    
+    put_bits(bw, final, 1);
+    put_bits(bw, 2, 2);
+    put_bits(bw, hlit - 257, 5);
+    put_bits(bw, hdist - 1, 5);
+    put_bits(bw, hclen - 4, 4);
+    for (int i = 0; i < hclen; i++) put_bits(bw, clens[codelen_order[i]], 3);
+    for (int i = 0; i < nrle; i++) {
+        int s = rle_sym[i];
+        put_bits(bw, ccodes[s], clens[s]);
+        if (s == 16) put_bits(bw, rle_extra[i], 2);
+        else if (s == 17) put_bits(bw, rle_extra[i], 3);
+        else if (s == 18) put_bits(bw, rle_extra[i], 7);
+    }
+    
+    for (int i = 0; i < nsyms; i++) {
+        uint32_t s = syms[i];
+        if (!(s & MATCH_FLAG)) {
+            put_bits(bw, lcodes[s], llens[s]);
+            continue;
+        }
+        uint32_t len = ((s >> 16) & 0xFF) + 3, dist = (s & 0x7FFF) + 1;
+        int lc = len_code[len - 3], dc = match_dist_code(dist);
+        put_bits(bw, lcodes[257 + lc], llens[257 + lc]);
+        if (len_extra[lc]) put_bits(bw, len - len_base[lc], len_extra[lc]);
+        put_bits(bw, dcodes[dc], dlens[dc]);
+        if (dist_extra[dc]) put_bits(bw, dist - dist_base[dc], dist_extra[dc]);
+    }
+    put_bits(bw, lcodes[256], llens[256]);
+    return 0;
+}
+
+// ============================================================
+// LZ77
+// ============================================================
+
+// Profundidade da cadeia e comprimento que encerra a busca, por nível.
+// Do nível 2 em diante as posições dentro das repetições também entram na
+// tabela hash e a repetição do byte anterior (a do nível 1) é sempre
+// tentada: um nível mais alto nunca perde do RLE em áreas lisas
+static const struct {
+    int depth;
+    int nice;
+} level_params[10] = {
+    { 0, 0 }, { 0, 0 }, { 1, MAX_MATCH }, { 1, MAX_MATCH }, { 2, 16 }, { 2, 32 },
+    { 4, 64 }, { 4, 128 }, { 8, MAX_MATCH }, { 16, MAX_MATCH }
+};
+
+static inline uint32_t hash4(const unsigned char *p) {
+    uint32_t v = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Bytes iguais a partir de a e b, até max; compara 8 de cada vez
+static inline size_t match_length(const unsigned char *a, const unsigned char *b, size_t max) {
+    size_t n = 0;
+    while (n + 8 <= max) {
+        uint64_t x, y;
+        memcpy(&x, a + n, 8);
+        memcpy(&y, b + n, 8);
+        uint64_t diff = x ^ y;
+        if (diff) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return n + (__builtin_ctzll(diff) >> 3);
+#else
+            return n + (__builtin_clzll(diff) >> 3);
+#endif
+        }
+        n += 8;
+    }
+    while (n < max && a[n] == b[n]) n++;
+    return n;
+}
+
+// Varredura LZ77 de data inteiro, emitindo um bloco a cada BLOCK_SYMBOLS
+static int compress_blocks(bit_writer_t *bw, const unsigned char *data, size_t len, int level) {
+    int rle = level == 1;
+    int depth = level_params[level].depth, nice = level_params[level].nice;
+    
+    // Posições + 1 (0 = vazio); prev só existe com cadeia
+    uint32_t *head = rle ? NULL : (uint32_t*)calloc(1u << HASH_BITS, sizeof(uint32_t));
+    uint32_t *prev = depth > 1 ? (uint32_t*)malloc(WINDOW_SIZE * sizeof(uint32_t)) : NULL;
+    uint32_t *syms = (uint32_t*)malloc(BLOCK_SYMBOLS * sizeof(uint32_t));
+    int result = (!rle && !head) || (depth > 1 && !prev) || !syms ? -1 : 0;
+    
+    size_t pos = 0, block_start = 0;
+    int nsyms = 0;
+    while (result == 0 && pos < len) {
+        size_t avail = len - pos, max_len = avail < MAX_MATCH ? avail : MAX_MATCH;
+        size_t best_len = 0, best_dist = 0;
+        
+        if (rle) {
+            if (pos > 0 && avail >= MIN_MATCH) {
+                best_len = match_length(data + pos, data + pos - 1, max_len);
+                best_dist = 1;
+            }
+        } else if (avail >= MIN_MATCH) {
+            // O hash lê 4 bytes: os 3 últimos só têm a distância 1
+            uint32_t cand = 0;
+            if (avail >= 4) {
+                uint32_t h = hash4(data + pos);
+                cand = head[h];
+                head[h] = (uint32_t)pos + 1;
+                if (prev) prev[pos & (WINDOW_SIZE - 1)] = cand;
+            }
+            
+            // Distância 1 primeiro: a cadeia só troca por algo mais longo
+            if (pos > 0) {
+                best_len = match_length(data + pos, data + pos - 1, max_len);
+                best_dist = 1;
+                if (best_len >= (size_t)nice) cand = 0;
+            }
+            for (int probes = depth; cand && probes > 0 && best_len < max_len; probes--) {
+                size_t c = cand - 1;
+                if (pos - c > WINDOW_SIZE) break;
+                // Só compara quem pode superar a melhor até aqui
+                if (data[c + best_len] == data[pos + best_len]) {
+                    size_t l = match_length(data + pos, data + c, max_len);
+                    if (l > best_len) {
+                        best_len = l;
+                        best_dist = pos - c;
+                        if (l >= (size_t)nice || l == max_len) break;
+                    }
+                }
+                if (!prev) break;
+                cand = prev[c & (WINDOW_SIZE - 1)];
+            }
+        }
+        
+        if (best_len >= MIN_MATCH) {
+            syms[nsyms++] = MATCH_FLAG | (uint32_t)(best_len - 3) << 16 | (uint32_t)(best_dist - 1);
+            if (!rle) {
+                size_t end = pos + best_len;
+                for (size_t p = pos + 1; p < end && p + 4 <= len; p++) {
+                    uint32_t h = hash4(data + p);
+                    if (prev) prev[p & (WINDOW_SIZE - 1)] = head[h];
+                    head[h] = (uint32_t)p + 1;
+                }
+            }
+            pos += best_len;
+        } else {
+            syms[nsyms++] = data[pos++];
+        }
+        
+        if (nsyms == BLOCK_SYMBOLS) {
+            result = write_block(bw, syms, nsyms, data + block_start, pos - block_start, pos == len);
+            block_start = pos;
+            nsyms = 0;
+        }
+    }
+    if (result == 0 && (block_start < len || len == 0)) {
+        result = write_block(bw, syms, nsyms, data + block_start, len - block_start, 1);
+    }
+    
+    free(head);
+    free(prev);
+    free(syms);
+    return result;
+}
+
+unsigned char* deflate_zlib(const unsigned char *data, size_t len, int level, size_t *out_len) {
+    pthread_once(&tables_once, build_tables);
+    if (len > UINT32_MAX - MAX_MATCH) return NULL;
+    if (level < 1) level = 1;
+    if (level > 9) level = 9;
+    
+    bit_writer_t bw = { .cap = len / 2 + 1024 };
+    bw.out = (unsigned char*)malloc(bw.cap);
+    if (!bw.out) return NULL;
+    
+    // Cabeçalho zlib: deflate, janela de 32 KB, sem dicionário
+    bw.out[bw.len++] = 0x78;
+    bw.out[bw.len++] = 0x01;
+    if (compress_blocks(&bw, data, len, level) != 0 || ensure_space(&bw, 16) != 0) {
+        free(bw.out);
+        return NULL;
+    }
+    
+    // Adler-32 em big-endian depois do último byte do deflate
+    align_byte(&bw);
+    uint32_t adler = adler32_update(1, data, len);
+    bw.out[bw.len++] = (unsigned char)(adler >> 24);
+    bw.out[bw.len++] = (unsigned char)(adler >> 16);
+    bw.out[bw.len++] = (unsigned char)(adler >> 8);
+    bw.out[bw.len++] = (unsigned char)adler;
+    
+    *out_len = bw.len;
+    return bw.out;
+}
@@ -0,0 +1,153 @@
+#include "event_log.h"
+#include "sync_manager.h"
+#include "filters.h"
+
+// ============================================================
+// ESCRITA (WORKER)
+// ============================================================
+
+void log_emit(log_channel_t *ch, int worker_id, int event, int task_id,
+              const char *name, int64_t arg0, int64_t arg1) {
+    log_ring_t *ring = &ch->rings[worker_id];
+    uint64_t head = ring->head;     // Único escritor
+    
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SIZE) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    log_record_t *rec = &ring->records[head & (LOG_RING_SIZE - 1)];
+    rec->ts_ns = monotonic_ns();
+    rec->event = event;
+    rec->task_id = task_id;
+    rec->args[0] = arg0;
+    rec->args[1] = arg1;
+    
+    // Caminhos longos: o final (nome do arquivo) é o que interessa
+    size_t len = name ? strlen(name) : 0;
+    if (len >= LOG_NAME_MAX) {
+        name += len - (LOG_NAME_MAX - 1);
+        len = LOG_NAME_MAX - 1;
+    }
+    if (len) memcpy(rec->name, name, len);
+    rec->name[len] = '\0';
+    
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    
+    // Publicação do head antes da leitura de reader_waiting (par com a
+    // barreira em log_wait): ou o leitor vê o registro, ou nós o vemos
+    // dormindo e o acordamos
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ch->reader_waiting, __ATOMIC_RELAXED)) {
+        __atomic_add_fetch(&ch->seq, 1, __ATOMIC_RELEASE);
+        futex_wake_all(&ch->seq);
+    }
+}
+
+// ============================================================
+// LEITURA E FORMATAÇÃO (COORDENADOR)
+// ============================================================
+
+static const int event_levels[LOG_EV_COUNT] = {
+    [LOG_EV_STARTED]     = LOG_LEVEL_DEFAULT,
+    [LOG_EV_TASK_START]  = LOG_LEVEL_VERBOSE,
+    [LOG_EV_FILTER]      = LOG_LEVEL_VERBOSE,
+    [LOG_EV_TASK_DONE]   = LOG_LEVEL_DEFAULT,
+    [LOG_EV_LOAD_FAILED] = LOG_LEVEL_QUIET,
+    [LOG_EV_MEM_DEFERRED] = LOG_LEVEL_DEFAULT,
+    [LOG_EV_TERMINATE]   = LOG_LEVEL_VERBOSE,
+    [LOG_EV_FINISHED]    = LOG_LEVEL_DEFAULT,
+};
+
+static void format_record(int worker_id, const log_record_t *rec, int verbosity) {
+    if (rec->event < 0 || rec->event >= LOG_EV_COUNT) return;
+    
+    // Falhas de filtro aparecem mesmo sem -v
+    int level = event_levels[rec->event];
+    if (rec->event == LOG_EV_FILTER && !rec->args[1]) level = LOG_LEVEL_DEFAULT;
+    if (level > verbosity) return;
+    
+    switch (rec->event) {
+        case LOG_EV_STARTED:
+            LOG_WORKER(worker_id, "PID %lld iniciado", (long long)rec->args[0]);
+            break;
+        case LOG_EV_TASK_START:
+            LOG_WORKER(worker_id, "Processando: %s (%lldx%lld)", rec->name,
+                       (long long)rec->args[0], (long long)rec->args[1]);
+            break;
+        case LOG_EV_FILTER:
+            LOG_WORKER(worker_id, "  Thread %lld: %s %s", (long long)rec->args[0],
+                       get_filter_name((int)rec->args[0]), rec->args[1] ? "✓" : "✗");
+            break;
+        case LOG_EV_TASK_DONE:
+            LOG_WORKER(worker_id, "%s: %s (%.2fs)", rec->args[1] ? "Concluído" : "Falhou",
+                       rec->name, rec->args[0] / 1e6);
+            break;
+        case LOG_EV_LOAD_FAILED:
+            LOG_WORKER(worker_id, "Falha ao carregar: %s", rec->name);
+            break;
+        case LOG_EV_MEM_DEFERRED:
+            LOG_WORKER(worker_id, "Adiada por memória: %s (%.1f MB, esperou %.2fs)", rec->name,
+                       rec->args[0] / (1024.0 * 1024.0), rec->args[1] / 1e6);
+            break;
+        case LOG_EV_TERMINATE:
+            LOG_WORKER(worker_id, "Recebido sinal de término");
+            break;
+        case LOG_EV_FINISHED:
+            LOG_WORKER(worker_id, "Finalizado");
+            break;
+    }
+}
+
+int log_drain(log_channel_t *ch, int verbosity) {
+    static uint64_t reported_drops[MAX_WORKERS];
+    int consumed = 0;
+    
+    for (int w = 0; w < MAX_WORKERS; w++) {
+        log_ring_t *ring = &ch->rings[w];
+        uint64_t tail = ring->tail;     // Único leitor
+        uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        
+        for (; tail != head; tail++) {
+            format_record(w, &ring->records[tail & (LOG_RING_SIZE - 1)], verbosity);
+            consumed++;
+        }
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+        
+        uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != reported_drops[w]) {
+            LOG_ERROR("Worker %d: %llu registros de log descartados (anel cheio)",
+                      w, (unsigned long long)(dropped - reported_drops[w]));
+            reported_drops[w] = dropped;
+        }
+    }
+    
+    if (consumed > 0) fflush(stdout);
+    return consumed;
+}
+
+static int log_pending(log_channel_t *ch) {
+    for (int w = 0; w < MAX_WORKERS; w++) {
+        log_ring_t *ring = &ch->rings[w];
+        if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != ring->tail) return 1;
+    }
+    return 0;
+}
+
+void log_wait(log_channel_t *ch, int timeout_ms) {
+    // Lê seq antes de conferir os anéis: um log_emit entre a conferência
+    // e o futex_wait muda seq e o futex retorna na hora
+    __atomic_store_n(&ch->reader_waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    unsigned int seq = __atomic_load_n(&ch->seq, __ATOMIC_ACQUIRE);
+    
+    if (!log_pending(ch)) {
+        futex_wait(&ch->seq, seq, timeout_ms);
+    }
+    __atomic_store_n(&ch->reader_waiting, 0, __ATOMIC_RELAXED);
+}
+
+void log_wake(log_channel_t *ch) {
+    __atomic_add_fetch(&ch->seq, 1, __ATOMIC_RELEASE);
+    futex_wake_all(&ch->seq);
+}
@@ -1,16 +1,49 @@
-// IMPORTANTE: defines devem vir ANTES de qualquer include
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-
+// As implementações do stb_image e do stb_image_write ficam em
+// jpeg_decode.c e image_encode.c
 #include "filters.h"
+#include "histogram.h"
+#include "trace.h"
+#include "perf_counters.h"
+#include "image_encode.h"
+#include "qoi.h"
+#include "pack.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
+#include <sys/uio.h>
 
 // ============================================================
 // CARREGAMENTO E SALVAMENTO DE IMAGENS
 // ============================================================
 
+// O stb_image não lê QOI: arquivos .qoi vão para qoi.c
+static int is_qoi_file(const char *filename) {
+    const char *ext = strrchr(filename, '.');
+    return ext && strcasecmp(ext, ".qoi") == 0;
+}
+
+// Decodifica o arquivo mapeado inteiro (sem cópia para um buffer)
+static unsigned char* load_qoi(const char *filename, int *width, int *height, int *channels) {
+    unsigned char *data = NULL;
+    struct stat st;
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd != -1 && fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            data = qoi_decode(map, st.st_size, width, height, channels);
+            munmap(map, st.st_size);
+        }
+    }
+    if (fd != -1) close(fd);
+    
+    if (!data) {
+        LOG_ERROR("Falha ao carregar: %s - QOI inválido ou ilegível", filename);
+    }
+    return data;
+}
+
 unsigned char* load_image(const char *filename, int *width, int *height, int *channels) {
+    if (is_qoi_file(filename)) return load_qoi(filename, width, height, channels);
+    
     unsigned char *data = stbi_load(filename, width, height, channels, 0);
     if (!data) {
         LOG_ERROR("Falha ao carregar: %s - %s", filename, stbi_failure_reason());
@@ -18,6 +51,47 @@ unsigned char* load_image(const char *filename, int *width, int *height, int *ch
     return data;
 }
 
+unsigned char* load_image_from_memory(const unsigned char *buffer, size_t len,
+                                      int *width, int *height, int *channels) {
+    if (len > INT_MAX) {
+        LOG_ERROR("Imagem em memória grande demais: %zu bytes", len);
+        return NULL;
+    }
+    if (qoi_info(buffer, len, width, height, channels) == 0) {
+        unsigned char *data = qoi_decode(buffer, len, width, height, channels);
+        if (!data) LOG_ERROR("Falha ao decodificar imagem em memória - QOI inválido");
+        return data;
+    }
+    unsigned char *data = stbi_load_from_memory(buffer, (int)len, width, height, channels, 0);
+    if (!data) {
+        LOG_ERROR("Falha ao decodificar imagem em memória - %s", stbi_failure_reason());
+    }
+    return data;
+}
+
+int image_info(const char *filename, int *width, int *height, int *channels) {
+    if (is_qoi_file(filename)) {
+        unsigned char header[QOI_HEADER_SIZE];
+        int fd = open(filename, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) return -1;
+        ssize_t n = pread(fd, header, sizeof(header), 0);
+        close(fd);
+        return n == (ssize_t)sizeof(header) ? qoi_info(header, sizeof(header), width, height, channels) : -1;
+    }
+    return stbi_info(filename, width, height, channels) ? 0 : -1;
+}
+
+int image_info_from_memory(const unsigned char *buffer, size_t len,
+                           int *width, int *height, int *channels) {
+    if (qoi_info(buffer, len, width, height, channels) == 0) return 0;
+    if (len > INT_MAX) return -1;
+    return stbi_info_from_memory(buffer, (int)len, width, height, channels) ? 0 : -1;
+}
+
+static void write_stdio(void *context, void *data, int size) {
+    fwrite(data, 1, size, (FILE*)context);
+}
+
 int save_image(const char *filename, unsigned char *data, int width, int height, int channels) {
     // Determina formato pelo nome do arquivo
     const char *ext = strrchr(filename, '.');
@@ -27,6 +101,16 @@ int save_image(const char *filename, unsigned char *data, int width, int height,
         result = stbi_write_jpg(filename, width, height, channels, data, 90);
     } else if (ext && strcmp(ext, ".png") == 0) {
         result = stbi_write_png(filename, width, height, channels, data, width * channels);
+    } else if (output_format_for(filename) > OUTPUT_PNG) {
+        // QOI, PPM e PAM pelos codificadores de image_encode.c
+        output_format_t format = output_format_for(filename);
+        FILE *f = fopen(filename, "wb");
+        if (f) {
+            int rc = format == OUTPUT_QOI
+                ? encode_qoi(write_stdio, f, width, height, channels, data)
+                : encode_raw(write_stdio, f, format, width, height, channels, data);
+            result = fclose(f) == 0 && rc == 0;
+        }
     } else {
         // Default: JPG
         result = stbi_write_jpg(filename, width, height, channels, data, 90);
@@ -39,6 +123,104 @@ int save_image(const char *filename, unsigned char *data, int width, int height,
     return 0;
 }
 
+// Saída do codificador acumulada no buffer da thread (reutilizado)
+typedef struct {
+    thread_args_t *targs;
+    int failed;
+} encode_context_t;
+
+static void encode_to_buffer(void *context, void *data, int size) {
+    encode_context_t *ctx = (encode_context_t*)context;
+    thread_args_t *targs = ctx->targs;
+    if (ctx->failed) return;
+    
+    if (targs->encoded_len + size > targs->encoded_cap) {
+        size_t cap = targs->encoded_cap ? targs->encoded_cap * 2 : 64 * 1024;
+        while (cap < targs->encoded_len + size) cap *= 2;
+        unsigned char *grown = (unsigned char*)realloc(targs->encoded, cap);
+        if (!grown) {
+            ctx->failed = 1;
+            return;
+        }
+        targs->encoded = grown;
+        targs->encoded_cap = cap;
+    }
+    memcpy(targs->encoded + targs->encoded_len, data, size);
+    targs->encoded_len += size;
+}
+
+// Threads por codificação JPEG (-E); 1 = stb_image_write direto
+static int encode_threads = 1;
+
+void set_encode_threads(int threads) {
+    encode_threads = threads;
+}
+
+// Codifica em memória com o perfil do filtro (formato pela extensão de
+// output_file, como em save_image)
+static int encode_image(thread_args_t *targs, output_format_t format, unsigned char *data,
+                        int width, int height) {
+    encode_context_t ctx = { .targs = targs, .failed = 0 };
+    int result;
+    
+    targs->encoded_len = 0;
+    if (format == OUTPUT_PNG) {
+        result = encode_png(encode_to_buffer, &ctx, width, height, targs->channels, data,
+                            &targs->profile);
+    } else if (format == OUTPUT_QOI) {
+        result = encode_qoi(encode_to_buffer, &ctx, width, height, targs->channels, data);
+    } else if (format != OUTPUT_JPEG) {
+        result = encode_raw(encode_to_buffer, &ctx, format, width, height, targs->channels, data);
+    } else {
+        result = encode_jpeg(encode_to_buffer, &ctx, width, height, targs->channels, data,
+                             &targs->profile, encode_threads);
+    }
+    
+    return (result == 0 && !ctx.failed) ? 0 : -1;
+}
+
+// Soma a saída na entrada do perfil (ocupa uma livre na primeira vez;
+// com todas ocupadas por outros perfis, a saída não é contada)
+static void record_encode(encode_stats_t *es, uint32_t key, uint64_t pixels, uint64_t bytes,
+                          uint64_t ns) {
+    if (!es) return;
+    
+    for (int i = 0; i < ENCODE_STAT_SLOTS; i++) {
+        encode_totals_t *t = &es->slots[i];
+        uint32_t cur = __atomic_load_n(&t->key, __ATOMIC_RELAXED);
+        if (cur != 0 && cur != key) continue;
+        
+        __atomic_store_n(&t->outputs, t->outputs + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->pixels, t->pixels + pixels, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->bytes, t->bytes + bytes, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->ns, t->ns + ns, __ATOMIC_RELAXED);
+        if (cur == 0) __atomic_store_n(&t->key, key, __ATOMIC_RELEASE);
+        return;
+    }
+}
+
+// Grava os blocos em ordem; uma chamada de writev costuma bastar
+static int write_all(int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t n = writev(fd, iov, iovcnt);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        // Escrita parcial: avança pelos blocos já gravados
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
 void free_image(unsigned char *data) {
     if (data) {
         stbi_image_free(data);
@@ -50,15 +232,84 @@ const char* get_filter_name(int filter_type) {
         case FILTER_GRAYSCALE: return "grayscale";
         case FILTER_BLUR:      return "blur";
         case FILTER_RESIZE:    return "resize";
+        case FILTER_CROP:      return "crop";
         default:               return "unknown";
     }
 }
 
+// Lista separada por vírgulas ("grayscale,resize") -> máscara 1 << FILTER_*.
+// Retorna -1 se algum nome for desconhecido.
+int parse_filter_list(const char *list) {
+    int mask = 0;
+    char *copy = strdup(list);
+    if (!copy) return -1;
+    
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        int found = -1;
+        for (int i = 0; i < NUM_THREADS; i++) {
+            if (strcmp(tok, get_filter_name(i)) == 0) found = i;
+        }
+        if (found < 0) {
+            free(copy);
+            return -1;
+        }
+        mask |= 1 << found;
+    }
+    
+    free(copy);
+    return mask;
+}
+
+int parse_encode_profiles(const char *text, encode_profile_t profiles[NUM_THREADS]) {
+    encode_profile_t parsed[NUM_THREADS];
+    memcpy(parsed, profiles, sizeof(parsed));
+    char *copy = strdup(text);
+    if (!copy) return -1;
+    
+    int result = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ",", &save); tok && result == 0; tok = strtok_r(NULL, ",", &save)) {
+        // FILTRO=PERFIL vale só para aquele filtro; PERFIL sozinho, para todos
+        char *eq = strchr(tok, '=');
+        int mask = (1 << NUM_THREADS) - 1;
+        if (eq) {
+            *eq = '\0';
+            mask = parse_filter_list(tok);
+            tok = eq + 1;
+        }
+        
+        encode_profile_t p;
+        if (mask <= 0 || parse_encode_profile(tok, &p) != 0) {
+            result = -1;
+            break;
+        }
+        for (int i = 0; i < NUM_THREADS; i++) {
+            if (mask & (1 << i)) parsed[i] = p;
+        }
+    }
+    
+    free(copy);
+    if (result == 0) memcpy(profiles, parsed, sizeof(parsed));
+    return result;
+}
+
 // ============================================================
 // IMPLEMENTAÇÃO DOS FILTROS
 // ============================================================
 
-void apply_grayscale(unsigned char *image, int width, int height, int channels) {
+void resize_dimensions(int src_w, int src_h, int *dst_w, int *dst_h) {
+    // Reduz para 50%
+    *dst_w = src_w / 2;
+    *dst_h = src_h / 2;
+    
+    if (*dst_w < 1) *dst_w = 1;
+    if (*dst_h < 1) *dst_h = 1;
+}
+
+// Versões de referência: escalares e diretas, a saída de ouro
+
+static void grayscale_ref(unsigned char *image, int width, int height, int channels) {
     // Só faz sentido se tiver RGB ou RGBA
     if (channels < 3) return;
     
@@ -80,7 +331,7 @@ void apply_grayscale(unsigned char *image, int width, int height, int channels)
     }
 }
 
-void apply_blur(unsigned char *src, unsigned char *dst, int width, int height, int channels) {
+static void blur_ref(unsigned char *src, unsigned char *dst, int width, int height, int channels) {
     // Box blur 3x3
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
@@ -110,24 +361,11 @@ void apply_blur(unsigned char *src, unsigned char *dst, int width, int height, i
     }
 }
 
-void apply_resize(unsigned char *src, int src_w, int src_h, int channels,
-                  unsigned char **dst, int *dst_w, int *dst_h) {
-    // Reduz para 50%
-    *dst_w = src_w / 2;
-    *dst_h = src_h / 2;
-    
-    if (*dst_w < 1) *dst_w = 1;
-    if (*dst_h < 1) *dst_h = 1;
-    
-    *dst = (unsigned char*)malloc((*dst_w) * (*dst_h) * channels);
-    if (!*dst) {
-        LOG_ERROR("Falha ao alocar memória para resize");
-        return;
-    }
-    
+static void resize_ref(unsigned char *src, int src_w, int src_h, int channels,
+                       unsigned char *dst, int dst_w, int dst_h) {
     // Interpolação simples (nearest neighbor)
-    for (int y = 0; y < *dst_h; y++) {
-        for (int x = 0; x < *dst_w; x++) {
+    for (int y = 0; y < dst_h; y++) {
+        for (int x = 0; x < dst_w; x++) {
             int src_x = x * 2;
             int src_y = y * 2;
             
@@ -136,23 +374,401 @@ void apply_resize(unsigned char *src, int src_w, int src_h, int channels,
             
             for (int c = 0; c < channels; c++) {
                 int src_idx = (src_y * src_w + src_x) * channels + c;
-                int dst_idx = (y * (*dst_w) + x) * channels + c;
-                (*dst)[dst_idx] = src[src_idx];
+                int dst_idx = (y * dst_w + x) * channels + c;
+                dst[dst_idx] = src[src_idx];
+            }
+        }
+    }
+}
+
+// Versões rápidas: mesma semântica, laços sem índice por pixel e com
+// número de canais constante para o compilador vetorizar
+
+// Luminância em ponto fixo (pesos × 65536, soma 65536). Difere da
+// referência em no máximo 1 nível (a referência trunca um double)
+static inline __attribute__((always_inline))
+void grayscale_pixels(unsigned char *p, size_t n, int channels) {
+    for (size_t i = 0; i < n; i++, p += channels) {
+        unsigned int gray = (19595u * p[0] + 38470u * p[1] + 7471u * p[2]) >> 16;
+        p[0] = p[1] = p[2] = (unsigned char)gray;
+    }
+}
+
+static void grayscale_fast(unsigned char *image, int width, int height, int channels) {
+    size_t n = (size_t)width * height;
+    if (channels == 3) grayscale_pixels(image, n, 3);
+    else if (channels == 4) grayscale_pixels(image, n, 4);
+    else if (channels > 4) grayscale_pixels(image, n, channels);
+}
+
+// Box blur 3x3 separável: soma vertical das 3 linhas por coluna e depois
+// janela horizontal. Só inteiros, idêntico à referência
+static void blur_fast(unsigned char *src, unsigned char *dst, int width, int height, int channels) {
+    // Somas de coluna (até 3 × 255); cresce e fica com a thread do pool
+    static __thread unsigned short *colsum = NULL;
+    static __thread size_t colsum_cap = 0;
+    
+    size_t row = (size_t)width * channels;
+    if (colsum_cap < row) {
+        unsigned short *buf = (unsigned short*)realloc(colsum, row * sizeof(*colsum));
+        if (!buf) {
+            blur_ref(src, dst, width, height, channels);
+            return;
+        }
+        colsum = buf;
+        colsum_cap = row;
+    }
+    
+    for (int y = 0; y < height; y++) {
+        const unsigned char *cur = src + y * row;
+        int rows = 1;
+        for (size_t i = 0; i < row; i++) colsum[i] = cur[i];
+        if (y > 0) {
+            const unsigned char *above = cur - row;
+            for (size_t i = 0; i < row; i++) colsum[i] += above[i];
+            rows++;
+        }
+        if (y + 1 < height) {
+            const unsigned char *below = cur + row;
+            for (size_t i = 0; i < row; i++) colsum[i] += below[i];
+            rows++;
+        }
+        
+        unsigned char *out = dst + y * row;
+        if (width == 1) {
+            for (int c = 0; c < channels; c++) out[c] = (unsigned char)(colsum[c] / rows);
+            continue;
+        }
+        
+        // Bordas esquerda e direita: 2 colunas
+        size_t last = row - channels;
+        for (int c = 0; c < channels; c++) {
+            out[c] = (unsigned char)((colsum[c] + colsum[channels + c]) / (2 * rows));
+            out[last + c] = (unsigned char)((colsum[last - channels + c] + colsum[last + c]) / (2 * rows));
+        }
+        
+        // Interior: divisor constante nas linhas internas (vira multiplicação)
+        if (rows == 3) {
+            for (size_t i = channels; i < last; i++) {
+                out[i] = (unsigned char)((colsum[i - channels] + colsum[i] + colsum[i + channels]) / 9);
+            }
+        } else {
+            int count = 3 * rows;
+            for (size_t i = channels; i < last; i++) {
+                out[i] = (unsigned char)((colsum[i - channels] + colsum[i] + colsum[i + channels]) / count);
+            }
+        }
+    }
+}
+
+static inline __attribute__((always_inline))
+void resize_row(const unsigned char *s, unsigned char *d, int count, int channels) {
+    for (int x = 0; x < count; x++, s += 2 * channels, d += channels) {
+        for (int c = 0; c < channels; c++) d[c] = s[c];
+    }
+}
+
+// Vizinho mais próximo com passo 2: um ponteiro por linha e cópia de
+// pixel com tamanho fixo; só as bordas fora da origem são limitadas
+static void resize_fast(unsigned char *src, int src_w, int src_h, int channels,
+                        unsigned char *dst, int dst_w, int dst_h) {
+    size_t src_row = (size_t)src_w * channels;
+    int inside = (src_w + 1) / 2 < dst_w ? (src_w + 1) / 2 : dst_w;
+    
+    for (int y = 0; y < dst_h; y++) {
+        int src_y = y * 2 < src_h ? y * 2 : src_h - 1;
+        const unsigned char *s = src + src_y * src_row;
+        unsigned char *d = dst + (size_t)y * dst_w * channels;
+        
+        if (channels == 3) resize_row(s, d, inside, 3);
+        else if (channels == 4) resize_row(s, d, inside, 4);
+        else resize_row(s, d, inside, channels);
+        
+        for (int x = inside; x < dst_w; x++) {
+            memcpy(d + (size_t)x * channels, s + src_row - channels, channels);
+        }
+    }
+}
+
+static const filter_kernels_t kernel_sets[NUM_KERNEL_SETS] = {
+    [KERNELS_REFERENCE] = { "ref",  grayscale_ref,  blur_ref,  resize_ref },
+    [KERNELS_FAST]      = { "fast", grayscale_fast, blur_fast, resize_fast },
+};
+
+// Conjunto usado por apply_*; escolhido antes do fork e herdado
+static const filter_kernels_t *active_kernels = &kernel_sets[KERNELS_REFERENCE];
+
+const filter_kernels_t* get_filter_kernels(kernel_set_t set) {
+    return &kernel_sets[set];
+}
+
+void select_filter_kernels(kernel_set_t set) {
+    active_kernels = &kernel_sets[set];
+}
+
+int parse_kernel_set(const char *name) {
+    for (int i = 0; i < NUM_KERNEL_SETS; i++) {
+        if (strcmp(name, kernel_sets[i].name) == 0) return i;
+    }
+    return -1;
+}
+
+void apply_grayscale(unsigned char *image, int width, int height, int channels) {
+    active_kernels->grayscale(image, width, height, channels);
+}
+
+void apply_blur(unsigned char *src, unsigned char *dst, int width, int height, int channels) {
+    active_kernels->blur(src, dst, width, height, channels);
+}
+
+void apply_resize_into(unsigned char *src, int src_w, int src_h, int channels,
+                       unsigned char *dst, int dst_w, int dst_h) {
+    active_kernels->resize_into(src, src_w, src_h, channels, dst, dst_w, dst_h);
+}
+
+void apply_resize(unsigned char *src, int src_w, int src_h, int channels,
+                  unsigned char **dst, int *dst_w, int *dst_h) {
+    resize_dimensions(src_w, src_h, dst_w, dst_h);
+    
+    *dst = (unsigned char*)malloc((*dst_w) * (*dst_h) * channels);
+    if (!*dst) {
+        LOG_ERROR("Falha ao alocar memória para resize");
+        return;
+    }
+    
+    apply_resize_into(src, src_w, src_h, channels, *dst, *dst_w, *dst_h);
+}
+
+// Copia as linhas da região; a região já foi limitada por crop_region
+void apply_crop(const unsigned char *src, int src_w, int channels,
+                int x, int y, int width, int height, unsigned char *dst) {
+    size_t row = (size_t)width * channels;
+    for (int j = 0; j < height; j++) {
+        memcpy(dst + j * row, src + ((size_t)(y + j) * src_w + x) * channels, row);
+    }
+}
+
+int parse_crop_spec(const char *text, crop_spec_t *spec) {
+    crop_spec_t c = { .x = -1, .y = -1 };
+    int percent, end = -1;
+    
+    // %n só é preenchido se o '%' casou ("640x480" também lê o número)
+    if (sscanf(text, "%d%%%n", &percent, &end) == 1 && end > 0 && text[end] == '\0') {
+        if (percent < 1 || percent > 100) return -1;
+        c.percent = percent;
+        c.x = c.y = 0;
+    } else if (sscanf(text, "%dx%d%n", &c.width, &c.height, &end) == 2) {
+        if (text[end] != '\0') {
+            int off = 0;
+            if (sscanf(text + end, "+%d+%d%n", &c.x, &c.y, &off) != 2 || text[end + off] != '\0') {
+                return -1;
             }
+            if (c.x < 0 || c.y < 0) return -1;
         }
+        if (c.width < 1 || c.height < 1) return -1;
+    } else {
+        return -1;
     }
+    
+    *spec = c;
+    return 0;
+}
+
+int crop_region(const crop_spec_t *spec, int img_w, int img_h,
+                int *x, int *y, int *width, int *height) {
+    int w, h;
+    if (spec->percent > 0) {
+        w = (int)((int64_t)img_w * spec->percent / 100);
+        h = (int)((int64_t)img_h * spec->percent / 100);
+        if (w < 1) w = 1;
+        if (h < 1) h = 1;
+    } else {
+        w = spec->width < img_w ? spec->width : img_w;
+        h = spec->height < img_h ? spec->height : img_h;
+    }
+    
+    // Centrado no eixo sem deslocamento; senão corta o que passar da borda
+    int left = spec->percent > 0 || spec->x < 0 ? (img_w - w) / 2 : spec->x;
+    int top = spec->percent > 0 || spec->y < 0 ? (img_h - h) / 2 : spec->y;
+    if (left >= img_w || top >= img_h) return -1;
+    if (w > img_w - left) w = img_w - left;
+    if (h > img_h - top) h = img_h - top;
+    
+    *x = left;
+    *y = top;
+    *width = w;
+    *height = h;
+    return 0;
 }
 
 // ============================================================
 // FUNÇÕES DE THREAD PARA FILTROS
 // ============================================================
 
+// Codifica o resultado e o grava no arquivo de saída (ou no memfd da
+// tarefa) com uma única escrita. Registra as latências de filtro
+// (desde start), codificação e gravação
+static int write_output(thread_args_t *targs, const struct timespec *start,
+                        unsigned char *data, int width, int height) {
+    struct timespec encode_start, write_start, end;
+    clock_gettime(CLOCK_MONOTONIC, &encode_start);
+    
+    // PPM/PAM: cabeçalho e pixels do filtro vão direto para o writev,
+    // sem passar pelo buffer de codificação
+    output_format_t format = output_format_for(targs->output_file);
+    char header[RAW_HEADER_MAX];
+    int header_len = raw_header(format, width, height, targs->channels, header, sizeof(header));
+    struct iovec iov[2];
+    int iovcnt = 1;
+    int result = 0;
+    if (header_len > 0) {
+        iov[0] = (struct iovec){ .iov_base = header, .iov_len = header_len };
+        iov[1] = (struct iovec){ .iov_base = data, .iov_len = (size_t)width * height * targs->channels };
+        iovcnt = 2;
+    } else {
+        result = encode_image(targs, format, data, width, height);
+        iov[0] = (struct iovec){ .iov_base = targs->encoded, .iov_len = targs->encoded_len };
+    }
+    clock_gettime(CLOCK_MONOTONIC, &write_start);
+    if (result == 0) {
+        record_encode(targs->encode_stats, encode_stat_key(format, &targs->profile),
+                      (uint64_t)width * height, iov[0].iov_len + (iovcnt > 1 ? iov[1].iov_len : 0),
+                      timespec_ns(&write_start) - timespec_ns(&encode_start));
+    }
+    
+    if (result == 0 && targs->pack) {
+        // No pacote, o nome da entrada é o caminho relativo a OUTPUT_DIR
+        const char *name = targs->output_file;
+        size_t dir_len = strlen(OUTPUT_DIR);
+        if (strncmp(name, OUTPUT_DIR, dir_len) == 0 && name[dir_len] == '/') name += dir_len + 1;
+        result = pack_append(targs->pack, name, iov, iovcnt);
+    } else if (result == 0) {
+        int fd = targs->output_fd;
+        if (fd < 0) {
+            fd = open(targs->output_file, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        }
+        result = fd == -1 ? -1 : write_all(fd, iov, iovcnt);
+        if (fd != -1 && fd != targs->output_fd && close(fd) == -1) {
+            result = -1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    
+    if (result != 0) {
+        LOG_ERROR("Falha ao salvar: %s", targs->output_file);
+    }
+    
+    worker_latency_t *lat = targs->latency;
+    if (lat) {
+        hist_record_interval(&lat->filter[targs->filter_type], start, &encode_start);
+        hist_record_interval(&lat->encode[targs->filter_type], &encode_start, &write_start);
+        if (result == 0) {
+            hist_record_interval(&lat->write[targs->filter_type], &write_start, &end);
+        }
+    }
+    
+    if (targs->trace) {
+        int f = targs->filter_type;
+        trace_record(targs->trace, TRACE_FILTER, f, targs->task_id,
+                     timespec_ns(start), timespec_ns(&encode_start));
+        trace_record(targs->trace, TRACE_ENCODE, f, targs->task_id,
+                     timespec_ns(&encode_start), timespec_ns(&write_start));
+        trace_record(targs->trace, TRACE_WRITE, f, targs->task_id,
+                     timespec_ns(&write_start), timespec_ns(&end));
+    }
+    return result;
+}
+
+// Garante que o buffer de trabalho da thread comporte size bytes.
+// O buffer só cresce e é mantido entre imagens (pool aquecido).
+static unsigned char* ensure_scratch(thread_args_t *targs, size_t size) {
+    if (targs->scratch_size < size) {
+        unsigned char *buf = (unsigned char*)realloc(targs->scratch, size);
+        if (!buf) return NULL;
+        targs->scratch = buf;
+        targs->scratch_size = size;
+    }
+    return targs->scratch;
+}
+
+// -V: recalcula a saída com o outro conjunto de kernels (referência x
+// rápido) sobre a mesma imagem decodificada e compara os buffers antes da
+// codificação. Retorna -1 se a maior diferença passar da tolerância
+static int verify_output(thread_args_t *targs, const unsigned char *out, int out_w, int out_h) {
+    size_t size = (size_t)out_w * out_h * targs->channels;
+    if (targs->verify_scratch_size < size) {
+        unsigned char *buf = (unsigned char*)realloc(targs->verify_scratch, size);
+        if (!buf) {
+            LOG_ERROR("Worker %d: Falha ao alocar memória (verificação)", targs->worker_id);
+            return -1;
+        }
+        targs->verify_scratch = buf;
+        targs->verify_scratch_size = size;
+    }
+    
+    unsigned char *other_out = targs->verify_scratch;
+    const filter_kernels_t *other = get_filter_kernels(
+        active_kernels == &kernel_sets[KERNELS_FAST] ? KERNELS_REFERENCE : KERNELS_FAST);
+    switch (targs->filter_type) {
+        case FILTER_GRAYSCALE:
+            memcpy(other_out, targs->image_data, size);
+            other->grayscale(other_out, out_w, out_h, targs->channels);
+            break;
+        case FILTER_BLUR:
+            other->blur(targs->image_data, other_out, out_w, out_h, targs->channels);
+            break;
+        default:
+            other->resize_into(targs->image_data, targs->width, targs->height, targs->channels,
+                               other_out, out_w, out_h);
+            break;
+    }
+    
+    uint64_t sum_abs = 0, sum_sq = 0;
+    int max_abs = 0;
+    for (size_t i = 0; i < size; i++) {
+        int diff = abs((int)out[i] - (int)other_out[i]);
+        sum_abs += diff;
+        sum_sq += (uint64_t)(diff * diff);
+        if (diff > max_abs) max_abs = diff;
+    }
+    
+    verify_totals_t *v = targs->verify;
+    v->frames++;
+    v->values += size;
+    v->sum_abs += sum_abs;
+    v->sum_sq += sum_sq;
+    if (max_abs > v->max_abs) v->max_abs = max_abs;
+    if (max_abs <= targs->verify_tolerance) return 0;
+    
+    v->failed++;
+    LOG_ERROR("Worker %d: %s: kernels ref e fast divergem em %s (erro máximo %d > %d)",
+              targs->worker_id, get_filter_name(targs->filter_type), targs->input_file,
+              max_abs, targs->verify_tolerance);
+    return -1;
+}
+
+// Contadores de hardware só em volta do kernel do filtro (-p): cópias,
+// codificação e gravação ficam de fora
+static int perf_begin(thread_args_t *targs, perf_sample_t *before) {
+    return targs->perf && perf_group_read(targs->perf, before) == 0;
+}
+
+static void perf_end(thread_args_t *targs, const perf_sample_t *before) {
+    perf_sample_t after;
+    if (perf_group_read(targs->perf, &after) == 0) {
+        perf_accumulate(targs->perf_totals, targs->perf, before, &after,
+                        (uint64_t)targs->width * targs->height);
+    }
+}
+
 void* thread_grayscale(void *args) {
     thread_args_t *targs = (thread_args_t*)args;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     
     // Copia dados da imagem para não interferir com outras threads
-    size_t size = targs->width * targs->height * targs->channels;
-    unsigned char *img_copy = (unsigned char*)malloc(size);
+    size_t size = (size_t)targs->width * targs->height * targs->channels;
+    unsigned char *img_copy = ensure_scratch(targs, size);
     if (!img_copy) {
         LOG_ERROR("Worker %d: Falha ao alocar memória (grayscale)", targs->worker_id);
         targs->success = 0;
@@ -162,24 +778,33 @@ void* thread_grayscale(void *args) {
     memcpy(img_copy, targs->image_data, size);
     
     // Aplica filtro
+    perf_sample_t before;
+    int counting = perf_begin(targs, &before);
     apply_grayscale(img_copy, targs->width, targs->height, targs->channels);
+    if (counting) perf_end(targs, &before);
+    
+    if (targs->verify && verify_output(targs, img_copy, targs->width, targs->height) != 0) {
+        targs->success = 0;
+        return NULL;
+    }
     
     // Salva resultado
-    if (save_image(targs->output_file, img_copy, targs->width, targs->height, targs->channels) == 0) {
+    if (write_output(targs, &start, img_copy, targs->width, targs->height) == 0) {
         targs->success = 1;
     } else {
         targs->success = 0;
     }
     
-    free(img_copy);
     return NULL;
 }
 
 void* thread_blur(void *args) {
     thread_args_t *targs = (thread_args_t*)args;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
     
-    size_t size = targs->width * targs->height * targs->channels;
-    unsigned char *img_blur = (unsigned char*)malloc(size);
+    size_t size = (size_t)targs->width * targs->height * targs->channels;
+    unsigned char *img_blur = ensure_scratch(targs, size);
     if (!img_blur) {
         LOG_ERROR("Worker %d: Falha ao alocar memória (blur)", targs->worker_id);
         targs->success = 0;
@@ -187,41 +812,105 @@ void* thread_blur(void *args) {
     }
     
     // Aplica blur
+    perf_sample_t before;
+    int counting = perf_begin(targs, &before);
     apply_blur(targs->image_data, img_blur, targs->width, targs->height, targs->channels);
+    if (counting) perf_end(targs, &before);
+    
+    if (targs->verify && verify_output(targs, img_blur, targs->width, targs->height) != 0) {
+        targs->success = 0;
+        return NULL;
+    }
     
     // Salva resultado
-    if (save_image(targs->output_file, img_blur, targs->width, targs->height, targs->channels) == 0) {
+    if (write_output(targs, &start, img_blur, targs->width, targs->height) == 0) {
         targs->success = 1;
     } else {
         targs->success = 0;
     }
     
-    free(img_blur);
     return NULL;
 }
 
 void* thread_resize(void *args) {
     thread_args_t *targs = (thread_args_t*)args;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    // A decodificação reduzida (IDCT 1/2) já entregou a imagem no tamanho
+    // final: não há kernel a aplicar nem a verificar
+    if (targs->decoded_output) {
+        targs->success = write_output(targs, &start, targs->image_data,
+                                      targs->width, targs->height) == 0;
+        return NULL;
+    }
     
-    unsigned char *resized = NULL;
     int new_w, new_h;
+    resize_dimensions(targs->width, targs->height, &new_w, &new_h);
+    
+    unsigned char *resized = ensure_scratch(targs, (size_t)new_w * new_h * targs->channels);
+    if (!resized) {
+        LOG_ERROR("Falha ao alocar memória para resize");
+        targs->success = 0;
+        return NULL;
+    }
     
     // Aplica resize
-    apply_resize(targs->image_data, targs->width, targs->height, targs->channels,
-                 &resized, &new_w, &new_h);
+    perf_sample_t before;
+    int counting = perf_begin(targs, &before);
+    apply_resize_into(targs->image_data, targs->width, targs->height, targs->channels,
+                      resized, new_w, new_h);
+    if (counting) perf_end(targs, &before);
     
-    if (!resized) {
+    if (targs->verify && verify_output(targs, resized, new_w, new_h) != 0) {
         targs->success = 0;
         return NULL;
     }
     
     // Salva resultado
-    if (save_image(targs->output_file, resized, new_w, new_h, targs->channels) == 0) {
+    if (write_output(targs, &start, resized, new_w, new_h) == 0) {
         targs->success = 1;
     } else {
         targs->success = 0;
     }
     
-    free(resized);
+    return NULL;
+}
+
+void* thread_crop(void *args) {
+    thread_args_t *targs = (thread_args_t*)args;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    
+    // Decodificado só na região: a imagem já é o recorte
+    if (targs->decoded_output) {
+        targs->success = write_output(targs, &start, targs->image_data,
+                                      targs->width, targs->height) == 0;
+        return NULL;
+    }
+    
+    if (targs->crop_width <= 0) {
+        LOG_ERROR("Worker %d: região de crop fora da imagem: %s", targs->worker_id,
+                  targs->input_file);
+        targs->success = 0;
+        return NULL;
+    }
+    
+    unsigned char *cropped = ensure_scratch(targs, (size_t)targs->crop_width *
+                                                   targs->crop_height * targs->channels);
+    if (!cropped) {
+        LOG_ERROR("Worker %d: Falha ao alocar memória (crop)", targs->worker_id);
+        targs->success = 0;
+        return NULL;
+    }
+    
+    perf_sample_t before;
+    int counting = perf_begin(targs, &before);
+    apply_crop(targs->image_data, targs->width, targs->channels, targs->crop_x, targs->crop_y,
+               targs->crop_width, targs->crop_height, cropped);
+    if (counting) perf_end(targs, &before);
+    
+    targs->success = write_output(targs, &start, cropped, targs->crop_width,
+                                  targs->crop_height) == 0;
     return NULL;
 }
@@ -0,0 +1,21 @@
+#include "fs_util.h"
+
+int make_parent_dirs(const char *path) {
+    char *copy = strdup(path);
+    if (!copy) return -1;
+    
+    for (char *p = copy + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(copy, 0755) == -1 && errno != EEXIST) {
+            int saved = errno;
+            free(copy);
+            errno = saved;
+            return -1;
+        }
+        *p = '/';
+    }
+    
+    free(copy);
+    return 0;
+}
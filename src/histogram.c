@@ -0,0 +1,91 @@
+#include "histogram.h"
+
+// ============================================================
+// ÍNDICE DAS FAIXAS
+// ============================================================
+
+// Valores < 16 têm faixa própria; acima disso, cada potência de 2 é
+// dividida em 16 faixas pelos 4 bits seguintes ao mais significativo
+static int bucket_index(uint64_t v) {
+    if (v < HIST_SUB_BUCKETS) return (int)v;
+    
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - HIST_SUB_BITS;
+    if (shift > HIST_MAX_SHIFT) return HIST_BUCKETS - 1;
+    
+    return (shift + 1) * HIST_SUB_BUCKETS + (int)(v >> shift) - HIST_SUB_BUCKETS;
+}
+
+// Maior valor que cai na faixa idx
+static uint64_t bucket_upper(int idx) {
+    if (idx < HIST_SUB_BUCKETS) return (uint64_t)idx;
+    
+    int shift = idx / HIST_SUB_BUCKETS - 1;
+    uint64_t mantissa = HIST_SUB_BUCKETS + idx % HIST_SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+// ============================================================
+// REGISTRO E LEITURA
+// ============================================================
+
+void hist_record(latency_hist_t *h, uint64_t usec) {
+    // Contadores relaxados: o coordenador pode ler a qualquer momento,
+    // e cada histograma tem um único escritor
+    __atomic_fetch_add(&h->buckets[bucket_index(usec)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_us, usec, __ATOMIC_RELAXED);
+    if (usec > __atomic_load_n(&h->max_us, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&h->max_us, usec, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+}
+
+void hist_record_interval(latency_hist_t *h, const struct timespec *start,
+                          const struct timespec *end) {
+    int64_t usec = (int64_t)(end->tv_sec - start->tv_sec) * 1000000 +
+                   (end->tv_nsec - start->tv_nsec) / 1000;
+    hist_record(h, usec > 0 ? (uint64_t)usec : 0);
+}
+
+void hist_merge(latency_hist_t *dst, const latency_hist_t *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        dst->buckets[i] += __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+    }
+    dst->count += __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+    dst->sum_us += __atomic_load_n(&src->sum_us, __ATOMIC_RELAXED);
+    
+    uint64_t max = __atomic_load_n(&src->max_us, __ATOMIC_RELAXED);
+    if (max > dst->max_us) dst->max_us = max;
+}
+
+uint64_t hist_percentile(const latency_hist_t *h, double pct) {
+    uint64_t total = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) total += h->buckets[i];
+    if (total == 0) return 0;
+    
+    // Posição (1..total) da amostra procurada
+    uint64_t rank = (uint64_t)(pct / 100.0 * total + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > total) rank = total;
+    
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            // A última faixa também recebe tudo acima do alcance: sem
+            // limite superior próprio, o máximo é o melhor valor
+            if (i == HIST_BUCKETS - 1) return h->max_us;
+            uint64_t upper = bucket_upper(i);
+            return upper < h->max_us ? upper : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+uint64_t hist_count_at_most(const latency_hist_t *h, uint64_t usec) {
+    uint64_t count = 0;
+    for (int i = 0; i < HIST_BUCKETS && bucket_upper(i) <= usec; i++) {
+        count += h->buckets[i];
+    }
+    return count;
+}
@@ -0,0 +1,793 @@
+// Implementação do stb_image_write: fica nesta unidade porque o JPEG com
+// croma escolhido, a codificação em faixas e o PNG por perfil usam as
+// funções internas dele (stbiw__jpg_processDU, stbiw__encode_png_line)
+// IMPORTANTE: o define deve vir ANTES de qualquer include
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "image_encode.h"
+#include "deflate.h"
+#include "qoi.h"
+#include "stb_image_write.h"
+
+// Faixa mínima, em linhas de MCU: abaixo disso a thread não se paga
+#define MIN_STRIP_MCU_ROWS  4
+
+// ============================================================
+// TABELAS JPEG
+// ============================================================
+
+// Tabelas de Huffman padrão (anexo K da norma), as mesmas do stb:
+// quantidade de códigos por comprimento (1..16) e símbolos em ordem
+static const unsigned char dc_lum_nrcodes[] = {0,0,1,5,1,1,1,1,1,1,0,0,0,0,0,0,0};
+static const unsigned char dc_lum_values[] = {0,1,2,3,4,5,6,7,8,9,10,11};
+static const unsigned char ac_lum_nrcodes[] = {0,0,2,1,3,3,2,4,3,5,5,4,4,0,0,1,0x7d};
+static const unsigned char ac_lum_values[] = {
+    0x01,0x02,0x03,0x00,0x04,0x11,0x05,0x12,0x21,0x31,0x41,0x06,0x13,0x51,0x61,0x07,0x22,0x71,0x14,0x32,0x81,0x91,0xa1,0x08,
+    0x23,0x42,0xb1,0xc1,0x15,0x52,0xd1,0xf0,0x24,0x33,0x62,0x72,0x82,0x09,0x0a,0x16,0x17,0x18,0x19,0x1a,0x25,0x26,0x27,0x28,
+    0x29,0x2a,0x34,0x35,0x36,0x37,0x38,0x39,0x3a,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4a,0x53,0x54,0x55,0x56,0x57,0x58,0x59,
+    0x5a,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6a,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7a,0x83,0x84,0x85,0x86,0x87,0x88,0x89,
+    0x8a,0x92,0x93,0x94,0x95,0x96,0x97,0x98,0x99,0x9a,0xa2,0xa3,0xa4,0xa5,0xa6,0xa7,0xa8,0xa9,0xaa,0xb2,0xb3,0xb4,0xb5,0xb6,
+    0xb7,0xb8,0xb9,0xba,0xc2,0xc3,0xc4,0xc5,0xc6,0xc7,0xc8,0xc9,0xca,0xd2,0xd3,0xd4,0xd5,0xd6,0xd7,0xd8,0xd9,0xda,0xe1,0xe2,
+    0xe3,0xe4,0xe5,0xe6,0xe7,0xe8,0xe9,0xea,0xf1,0xf2,0xf3,0xf4,0xf5,0xf6,0xf7,0xf8,0xf9,0xfa
+};
+static const unsigned char dc_chr_nrcodes[] = {0,0,3,1,1,1,1,1,1,1,1,1,0,0,0,0,0};
+static const unsigned char dc_chr_values[] = {0,1,2,3,4,5,6,7,8,9,10,11};
+static const unsigned char ac_chr_nrcodes[] = {0,0,2,1,2,4,4,3,4,7,5,4,4,0,1,2,0x77};
+static const unsigned char ac_chr_values[] = {
+    0x00,0x01,0x02,0x03,0x11,0x04,0x05,0x21,0x31,0x06,0x12,0x41,0x51,0x07,0x61,0x71,0x13,0x22,0x32,0x81,0x08,0x14,0x42,0x91,
+    0xa1,0xb1,0xc1,0x09,0x23,0x33,0x52,0xf0,0x15,0x62,0x72,0xd1,0x0a,0x16,0x24,0x34,0xe1,0x25,0xf1,0x17,0x18,0x19,0x1a,0x26,
+    0x27,0x28,0x29,0x2a,0x35,0x36,0x37,0x38,0x39,0x3a,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4a,0x53,0x54,0x55,0x56,0x57,0x58,
+    0x59,0x5a,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6a,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7a,0x82,0x83,0x84,0x85,0x86,0x87,
+    0x88,0x89,0x8a,0x92,0x93,0x94,0x95,0x96,0x97,0x98,0x99,0x9a,0xa2,0xa3,0xa4,0xa5,0xa6,0xa7,0xa8,0xa9,0xaa,0xb2,0xb3,0xb4,
+    0xb5,0xb6,0xb7,0xb8,0xb9,0xba,0xc2,0xc3,0xc4,0xc5,0xc6,0xc7,0xc8,0xc9,0xca,0xd2,0xd3,0xd4,0xd5,0xd6,0xd7,0xd8,0xd9,0xda,
+    0xe2,0xe3,0xe4,0xe5,0xe6,0xe7,0xe8,0xe9,0xea,0xf2,0xf3,0xf4,0xf5,0xf6,0xf7,0xf8,0xf9,0xfa
+};
+
+// Quantização base (qualidade 50) e fatores de escala da DCT AAN
+static const int y_qt[] = {16,11,10,16,24,40,51,61,12,12,14,19,26,58,60,55,14,13,16,24,40,57,69,56,14,17,22,29,51,87,80,62,18,22,
+                           37,56,68,109,103,77,24,35,55,64,81,104,113,92,49,64,78,87,103,121,120,101,72,92,95,98,112,100,103,99};
+static const int uv_qt[] = {17,18,24,47,99,99,99,99,18,21,26,66,99,99,99,99,24,26,56,99,99,99,99,99,47,66,99,99,99,99,99,99,
+                            99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99,99};
+static const float aasf[] = { 1.0f * 2.828427125f, 1.387039845f * 2.828427125f, 1.306562965f * 2.828427125f,
+                              1.175875602f * 2.828427125f, 1.0f * 2.828427125f, 0.785694958f * 2.828427125f,
+                              0.541196100f * 2.828427125f, 0.275899379f * 2.828427125f };
+
+// Códigos canônicos ({código, comprimento} por símbolo), montados uma vez
+static unsigned short ydc_ht[256][2], yac_ht[256][2], uvdc_ht[256][2], uvac_ht[256][2];
+static pthread_once_t huffman_once = PTHREAD_ONCE_INIT;
+
+static void build_huffman(const unsigned char *nrcodes, const unsigned char *values,
+                          unsigned short ht[256][2]) {
+    int code = 0, k = 0;
+    for (int len = 1; len <= 16; len++, code <<= 1) {
+        for (int i = 0; i < nrcodes[len]; i++, k++, code++) {
+            ht[values[k]][0] = (unsigned short)code;
+            ht[values[k]][1] = (unsigned short)len;
+        }
+    }
+}
+
+static void build_huffman_tables(void) {
+    build_huffman(dc_lum_nrcodes, dc_lum_values, ydc_ht);
+    build_huffman(ac_lum_nrcodes, ac_lum_values, yac_ht);
+    build_huffman(dc_chr_nrcodes, dc_chr_values, uvdc_ht);
+    build_huffman(ac_chr_nrcodes, ac_chr_values, uvac_ht);
+}
+
+// Quantização de uma qualidade: tabelas em zigue-zague (como no DQT) e
+// os divisores da DCT já com a escala AAN
+typedef struct {
+    unsigned char y_table[64], uv_table[64];
+    float fdtbl_y[64], fdtbl_uv[64];
+} jpeg_quant_t;
+
+static void build_quant(int quality, jpeg_quant_t *q) {
+    quality = quality < 1 ? 1 : quality > 100 ? 100 : quality;
+    quality = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    
+    for (int i = 0; i < 64; i++) {
+        int yti = (y_qt[i] * quality + 50) / 100;
+        int uvti = (uv_qt[i] * quality + 50) / 100;
+        q->y_table[stbiw__jpg_ZigZag[i]] = (unsigned char)(yti < 1 ? 1 : yti > 255 ? 255 : yti);
+        q->uv_table[stbiw__jpg_ZigZag[i]] = (unsigned char)(uvti < 1 ? 1 : uvti > 255 ? 255 : uvti);
+    }
+    for (int row = 0, k = 0; row < 8; row++) {
+        for (int col = 0; col < 8; col++, k++) {
+            q->fdtbl_y[k] = 1 / (q->y_table[stbiw__jpg_ZigZag[k]] * aasf[row] * aasf[col]);
+            q->fdtbl_uv[k] = 1 / (q->uv_table[stbiw__jpg_ZigZag[k]] * aasf[row] * aasf[col]);
+        }
+    }
+}
+
+// ============================================================
+// CODIFICAÇÃO JPEG
+// ============================================================
+
+// SOI, JFIF, DQT, SOF0, DHT, DRI (se restart_interval > 0) e SOS, na
+// ordem e com os bytes do stb_image_write
+static void write_jpeg_header(stbi__write_context *s, int width, int height, const jpeg_quant_t *q,
+                              int subsample, int restart_interval) {
+    static const unsigned char head0[] = { 0xFF,0xD8,0xFF,0xE0,0,0x10,'J','F','I','F',0,1,1,0,0,1,0,1,0,0,0xFF,0xDB,0,0x84,0 };
+    static const unsigned char head2[] = { 0xFF,0xDA,0,0xC,3,1,0,2,0x11,3,0x11,0,0x3F,0 };
+    const unsigned char head1[] = { 0xFF,0xC0,0,0x11,8,(unsigned char)(height >> 8),(unsigned char)height,
+                                    (unsigned char)(width >> 8),(unsigned char)width,
+                                    3,1,(unsigned char)(subsample ? 0x22 : 0x11),0,2,0x11,1,3,0x11,1,
+                                    0xFF,0xC4,0x01,0xA2,0 };
+    
+    s->func(s->context, (void*)head0, sizeof(head0));
+    s->func(s->context, (void*)q->y_table, sizeof(q->y_table));
+    stbiw__putc(s, 1);
+    s->func(s->context, (void*)q->uv_table, sizeof(q->uv_table));
+    s->func(s->context, (void*)head1, sizeof(head1));
+    s->func(s->context, (void*)(dc_lum_nrcodes + 1), sizeof(dc_lum_nrcodes) - 1);
+    s->func(s->context, (void*)dc_lum_values, sizeof(dc_lum_values));
+    stbiw__putc(s, 0x10);
+    s->func(s->context, (void*)(ac_lum_nrcodes + 1), sizeof(ac_lum_nrcodes) - 1);
+    s->func(s->context, (void*)ac_lum_values, sizeof(ac_lum_values));
+    stbiw__putc(s, 1);
+    s->func(s->context, (void*)(dc_chr_nrcodes + 1), sizeof(dc_chr_nrcodes) - 1);
+    s->func(s->context, (void*)dc_chr_values, sizeof(dc_chr_values));
+    stbiw__putc(s, 0x11);
+    s->func(s->context, (void*)(ac_chr_nrcodes + 1), sizeof(ac_chr_nrcodes) - 1);
+    s->func(s->context, (void*)ac_chr_values, sizeof(ac_chr_values));
+    if (restart_interval > 0) {
+        unsigned char dri[6] = { 0xFF, 0xDD, 0, 4, (unsigned char)(restart_interval >> 8),
+                                 (unsigned char)restart_interval };
+        s->func(s->context, dri, sizeof(dri));
+    }
+    s->func(s->context, (void*)head2, sizeof(head2));
+}
+
+// Cor de um pixel (linha/coluna além da borda repetem a última)
+static void rgb_to_ycc(const unsigned char *data, int width, int height, int comp, int row, int col,
+                       float *y, float *u, float *v) {
+    // comp == 2 é cinza + alfa (o alfa é ignorado)
+    int ofs_g = comp > 2 ? 1 : 0, ofs_b = comp > 2 ? 2 : 0;
+    int p = ((row < height ? row : height - 1) * width + (col < width ? col : width - 1)) * comp;
+    float r = data[p], g = data[p + ofs_g], b = data[p + ofs_b];
+    *y = +0.29900f * r + 0.58700f * g + 0.11400f * b - 128;
+    *u = -0.16874f * r - 0.33126f * g + 0.50000f * b;
+    *v = +0.50000f * r - 0.41869f * g - 0.08131f * b;
+}
+
+// Dados entrópicos das linhas [y0, y1) (múltiplo do MCU, exceto no fim da
+// imagem), com os preditores de DC zerados no início e o último byte
+// completado com bits 1, como no fim da imagem ou antes de um RST
+static void encode_mcu_rows(stbi__write_context *s, const unsigned char *data, int width, int height,
+                            int comp, int y0, int y1, const jpeg_quant_t *q, int subsample) {
+    static const unsigned short fill_bits[] = { 0x7F, 7 };
+    int dcy = 0, dcu = 0, dcv = 0;
+    int bit_buf = 0, bit_cnt = 0;
+    float *fdtbl_y = (float*)q->fdtbl_y, *fdtbl_uv = (float*)q->fdtbl_uv;
+    
+    if (subsample) {
+        for (int y = y0; y < y1; y += 16) {
+            for (int x = 0; x < width; x += 16) {
+                float Y[256], U[256], V[256];
+                for (int row = y, pos = 0; row < y + 16; row++) {
+                    for (int col = x; col < x + 16; col++, pos++) {
+                        rgb_to_ycc(data, width, height, comp, row, col, &Y[pos], &U[pos], &V[pos]);
+                    }
+                }
+                dcy = stbiw__jpg_processDU(s, &bit_buf, &bit_cnt, Y + 0, 16, fdtbl_y, dcy, ydc_ht, yac_ht);
+                dcy = stbiw__jpg_processDU(s, &bit_buf, &bit_cnt, Y + 8, 16, fdtbl_y, dcy, ydc_ht, yac_ht);
+                dcy = stbiw__jpg_processDU(s, &bit_buf, &bit_cnt, Y + 128, 16, fdtbl_y, dcy, ydc_ht, yac_ht);
+                dcy = stbiw__jpg_processDU(s, &bit_buf, &bit_cnt, Y + 136, 16, fdtbl_y, dcy, ydc_ht, yac_ht);
+                
+                // Croma: média de cada 2×2
+                float sub_u[64], sub_v[64];
+                for (int yy = 0, pos = 0; yy < 8; yy++) {
+                    for (int xx = 0; xx < 8; xx++, pos++) {
+                        int j = yy * 32 + xx * 2;
+                        sub_u[pos] = (U[j + 0] + U[j + 1] + U[j + 16] + U[j + 17]) * 0.25f;
+                        sub_v[pos] = (V[j + 0] + V[j + 1] + V[j + 16] + V[j + 17]) * 0.25f;
+                    }
+                }
+                dcu = stbiw__jpg_processDU(s, &bit_buf, &bit_cnt, sub_u, 8, fdtbl_uv, dcu, uvdc_ht, uvac_ht);
+                dcv = stbiw__jpg_processDU(s, &bit_buf, &bit_cnt, sub_v, 8, fdtbl_uv, dcv, uvdc_ht, uvac_ht);
+            }
+        }
+    } else {
+        for (int y = y0; y < y1; y += 8) {
+            for (int x = 0; x < width; x += 8) {
+                float Y[64], U[64], V[64];
+                for (int row = y, pos = 0; row < y + 8; row++) {
+                    for (int col = x; col < x + 8; col++, pos++) {
+                        rgb_to_ycc(data, width, height, comp, row, col, &Y[pos], &U[pos], &V[pos]);
+                    }
+                }
+                dcy = stbiw__jpg_processDU(s, &bit_buf, &bit_cnt, Y, 8, fdtbl_y, dcy, ydc_ht, yac_ht);
+                dcu = stbiw__jpg_processDU(s, &bit_buf, &bit_cnt, U, 8, fdtbl_uv, dcu, uvdc_ht, uvac_ht);
+                dcv = stbiw__jpg_processDU(s, &bit_buf, &bit_cnt, V, 8, fdtbl_uv, dcv, uvdc_ht, uvac_ht);
+            }
+        }
+    }
+    
+    stbiw__jpg_writeBits(s, &bit_buf, &bit_cnt, fill_bits);
+}
+
+// ============================================================
+// FAIXAS
+// ============================================================
+
+// Dados entrópicos de uma faixa
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+    int failed;
+} strip_buffer_t;
+
+typedef struct {
+    const unsigned char *data;
+    int width, height, channels;
+    const jpeg_quant_t *quant;
+    int subsample;
+    int strip_rows;             // Linhas por faixa (a última pode ter menos)
+    int num_strips;
+    int num_threads;            // A thread t codifica as faixas t, t + num_threads, ...
+    strip_buffer_t *strips;
+} strip_job_t;
+
+typedef struct {
+    strip_job_t *job;
+    int first;
+} strip_thread_t;
+
+static void strip_sink(void *context, void *data, int size) {
+    strip_buffer_t *s = (strip_buffer_t*)context;
+    if (s->failed) return;
+    
+    if (s->len + size > s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 64 * 1024;
+        while (cap < s->len + size) cap *= 2;
+        unsigned char *grown = (unsigned char*)realloc(s->data, cap);
+        if (!grown) {
+            s->failed = 1;
+            return;
+        }
+        s->data = grown;
+        s->cap = cap;
+    }
+    memcpy(s->data + s->len, data, size);
+    s->len += size;
+}
+
+static void encode_strips(strip_job_t *job, int first) {
+    for (int i = first; i < job->num_strips; i += job->num_threads) {
+        int y0 = i * job->strip_rows;
+        int y1 = y0 + job->strip_rows < job->height ? y0 + job->strip_rows : job->height;
+        stbi__write_context s = { 0 };
+        stbi__start_write_callbacks(&s, strip_sink, &job->strips[i]);
+        encode_mcu_rows(&s, job->data, job->width, job->height, job->channels, y0, y1,
+                        job->quant, job->subsample);
+    }
+}
+
+static void* strip_thread(void *arg) {
+    strip_thread_t *t = (strip_thread_t*)arg;
+    encode_strips(t->job, t->first);
+    return NULL;
+}
+
+// Codifica as faixas em paralelo e grava o JPEG: cabeçalho com DRI de uma
+// faixa e os dados de cada faixa separados por RST0..RST7 em ciclo. Cada
+// faixa começa com os preditores de DC zerados, como depois de um RST
+static int encode_jpeg_strips(stbi__write_context *out, strip_job_t *job, int mcu_cols) {
+    job->strips = (strip_buffer_t*)calloc(job->num_strips, sizeof(strip_buffer_t));
+    if (!job->strips) return -1;
+    
+    // A thread chamadora codifica a faixa 0; se uma thread não puder ser
+    // criada, as faixas dela também ficam com a chamadora
+    pthread_t tids[MAX_ENCODE_THREADS];
+    strip_thread_t args[MAX_ENCODE_THREADS];
+    int started[MAX_ENCODE_THREADS] = { 0 };
+    for (int t = 1; t < job->num_threads; t++) {
+        args[t] = (strip_thread_t){ .job = job, .first = t };
+        started[t] = pthread_create(&tids[t], NULL, strip_thread, &args[t]) == 0;
+    }
+    encode_strips(job, 0);
+    for (int t = 1; t < job->num_threads; t++) {
+        if (started[t]) pthread_join(tids[t], NULL);
+        else encode_strips(job, t);
+    }
+    
+    int failed = 0;
+    for (int i = 0; i < job->num_strips; i++) failed |= job->strips[i].failed;
+    if (!failed) {
+        int mcu = job->subsample ? 16 : 8;
+        write_jpeg_header(out, job->width, job->height, job->quant, job->subsample,
+                          job->strip_rows / mcu * mcu_cols);
+        for (int i = 0; i < job->num_strips; i++) {
+            if (i > 0) {
+                stbiw__putc(out, 0xFF);
+                stbiw__putc(out, (unsigned char)(0xD0 + ((i - 1) & 7)));
+            }
+            out->func(out->context, job->strips[i].data, (int)job->strips[i].len);
+        }
+    }
+    
+    for (int i = 0; i < job->num_strips; i++) free(job->strips[i].data);
+    free(job->strips);
+    return failed ? -1 : 0;
+}
+
+int encode_jpeg(encode_write_func *func, void *context, int width, int height, int channels,
+                const unsigned char *data, const encode_profile_t *profile, int threads) {
+    if (!data || width < 1 || height < 1 || channels < 1 || channels > 4) return -1;
+    pthread_once(&huffman_once, build_huffman_tables);
+    
+    jpeg_quant_t quant;
+    build_quant(profile->jpeg_quality, &quant);
+    int subsample = profile->jpeg_subsample != 0;
+    int mcu = subsample ? 16 : 8;
+    int mcu_rows = (height + mcu - 1) / mcu;
+    int mcu_cols = (width + mcu - 1) / mcu;
+    
+    stbi__write_context out = { 0 };
+    stbi__start_write_callbacks(&out, func, context);
+    
+    if (threads > MAX_ENCODE_THREADS) threads = MAX_ENCODE_THREADS;
+    if (threads > mcu_rows / MIN_STRIP_MCU_ROWS) threads = mcu_rows / MIN_STRIP_MCU_ROWS;
+    if (threads > 1) {
+        // Uma faixa por thread; o intervalo de restart (em MCUs) tem 16 bits
+        int rows_per_strip = (mcu_rows + threads - 1) / threads;
+        if (rows_per_strip > 65535 / mcu_cols) rows_per_strip = 65535 / mcu_cols;
+        
+        strip_job_t job = {
+            .data = data, .width = width, .height = height, .channels = channels,
+            .quant = &quant, .subsample = subsample, .strip_rows = rows_per_strip * mcu,
+            .num_strips = (mcu_rows + rows_per_strip - 1) / rows_per_strip,
+        };
+        job.num_threads = threads < job.num_strips ? threads : job.num_strips;
+        if (encode_jpeg_strips(&out, &job, mcu_cols) != 0) return -1;
+    } else {
+        write_jpeg_header(&out, width, height, &quant, subsample, 0);
+        encode_mcu_rows(&out, data, width, height, channels, 0, height, &quant, subsample);
+    }
+    
+    stbiw__putc(&out, 0xFF);
+    stbiw__putc(&out, 0xD9);
+    return 0;
+}
+
+// ============================================================
+// CODIFICAÇÃO PNG
+// ============================================================
+
+// Linhas filtradas como o stb_image_write (stbiw__encode_png_line). No
+// adaptativo, o filtro de menor soma de |resíduo| em cada linha
+static int filter_rows_stb(const unsigned char *data, int width, int height, int channels,
+                           int filter, unsigned char *filt) {
+    int row = width * channels;
+    signed char *line = (signed char*)STBIW_MALLOC(row);
+    if (!line) return -1;
+    
+    for (int j = 0; j < height; j++) {
+        int type = filter;
+        if (type >= 0) {
+            stbiw__encode_png_line((unsigned char*)data, row, width, height, j, channels, type, line);
+        } else {
+            int best = 0, best_est = 0x7fffffff, last = 0;
+            for (int t = 0; t < 5; t++) {
+                stbiw__encode_png_line((unsigned char*)data, row, width, height, j, channels, t, line);
+                last = t;
+                int est = 0;
+                for (int i = 0; i < row; i++) est += abs(line[i]);
+                if (est < best_est) {
+                    best_est = est;
+                    best = t;
+                }
+            }
+            // line guarda o último filtro tentado: só refaz se não for o melhor
+            if (last != best) {
+                stbiw__encode_png_line((unsigned char*)data, row, width, height, j, channels, best, line);
+            }
+            type = best;
+        }
+        filt[(size_t)j * (row + 1)] = (unsigned char)type;
+        memcpy(filt + (size_t)j * (row + 1) + 1, line, row);
+    }
+    STBIW_FREE(line);
+    return 0;
+}
+
+// Vetores de 16 bytes (extensões do GCC): SSE2 no x86-64, NEON no ARM
+typedef unsigned char v16u8 __attribute__((vector_size(16)));
+typedef signed char v16s8 __attribute__((vector_size(16)));
+typedef unsigned char v8u8 __attribute__((vector_size(8)));
+typedef short v8s16 __attribute__((vector_size(16)));
+typedef unsigned int v16u32 __attribute__((vector_size(64)));
+
+static inline v16u8 load16(const unsigned char *p) {
+    v16u8 v;
+    memcpy(&v, p, 16);
+    return v;
+}
+
+static inline void store16(unsigned char *p, v16u8 v) {
+    memcpy(p, &v, 16);
+}
+
+// 8 bytes alargados para 16 bits
+static inline v8s16 load8_wide(const unsigned char *p) {
+    v8u8 v;
+    memcpy(&v, p, 8);
+    return __builtin_convertvector(v, v8s16);
+}
+
+static inline v8s16 abs16(v8s16 v) {
+    v8s16 sign = v >> 15;
+    return (v ^ sign) - sign;
+}
+
+// Resíduos de uma linha com o filtro type (prior: linha de cima, zeros na
+// primeira). Todos os filtros leem só a imagem original, então 16 bytes
+// saem por iteração; o Paeth escolhe o preditor com máscaras em 16 bits,
+// 8 bytes por vez
+static void filter_row(int type, const unsigned char *cur, const unsigned char *prior,
+                       int row, int bpp, unsigned char *out) {
+    if (type == 0) {
+        memcpy(out, cur, row);
+        return;
+    }
+    
+    // Primeiro pixel: vizinhos à esquerda valem zero (Paeth vira Up)
+    int i = 0;
+    for (; i < bpp && i < row; i++) {
+        int up = prior[i];
+        out[i] = (unsigned char)(cur[i] - (type == 1 ? 0 : type == 3 ? up >> 1 : up));
+    }
+    
+    switch (type) {
+        case 1:
+            for (; i + 16 <= row; i += 16) {
+                store16(out + i, load16(cur + i) - load16(cur + i - bpp));
+            }
+            for (; i < row; i++) out[i] = (unsigned char)(cur[i] - cur[i - bpp]);
+            break;
+        case 2:
+            for (; i + 16 <= row; i += 16) {
+                store16(out + i, load16(cur + i) - load16(prior + i));
+            }
+            for (; i < row; i++) out[i] = (unsigned char)(cur[i] - prior[i]);
+            break;
+        case 3:
+            // Média sem alargar: (a & b) + ((a ^ b) >> 1) == (a + b) >> 1
+            for (; i + 16 <= row; i += 16) {
+                v16u8 a = load16(cur + i - bpp), b = load16(prior + i);
+                store16(out + i, load16(cur + i) - ((a & b) + ((a ^ b) >> 1)));
+            }
+            for (; i < row; i++) out[i] = (unsigned char)(cur[i] - ((cur[i - bpp] + prior[i]) >> 1));
+            break;
+        case 4:
+            for (; i + 8 <= row; i += 8) {
+                v8s16 a = load8_wide(cur + i - bpp), b = load8_wide(prior + i);
+                v8s16 c = load8_wide(prior + i - bpp);
+                v8s16 pa = abs16(b - c), pb = abs16(a - c), pc = abs16(a + b - c - c);
+                v8s16 use_a = (pa <= pb) & (pa <= pc), use_b = pb <= pc;
+                v8s16 pred = (use_a & a) | (~use_a & ((use_b & b) | (~use_b & c)));
+                v8u8 res = __builtin_convertvector(load8_wide(cur + i) - pred, v8u8);
+                memcpy(out + i, &res, 8);
+            }
+            for (; i < row; i++) {
+                int a = cur[i - bpp], b = prior[i], c = prior[i - bpp];
+                int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+                int pred = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+                out[i] = (unsigned char)(cur[i] - pred);
+            }
+            break;
+    }
+}
+
+// Soma de |resíduo| com sinal, a mesma estimativa do stb
+static uint32_t row_cost(const unsigned char *out, int row) {
+    v16u32 acc = { 0 };
+    int i = 0;
+    for (; i + 16 <= row; i += 16) {
+        v16u8 v = load16(out + i);
+        v16u8 sign = (v16u8)((v16s8)v >> 7);
+        acc += __builtin_convertvector((v ^ sign) - sign, v16u32);
+    }
+    uint32_t cost = 0;
+    for (int k = 0; k < 16; k++) cost += acc[k];
+    for (; i < row; i++) cost += abs((signed char)out[i]);
+    return cost;
+}
+
+// Mesmos filtros e escolha que filter_rows_stb, com os laços vetoriais
+static int filter_rows_fast(const unsigned char *data, int width, int height, int channels,
+                            int filter, unsigned char *filt) {
+    size_t row = (size_t)width * channels;
+    unsigned char *zero = (unsigned char*)calloc(1, row);
+    unsigned char *scratch = (unsigned char*)malloc(row);
+    if (!zero || !scratch) {
+        free(zero);
+        free(scratch);
+        return -1;
+    }
+    
+    for (int j = 0; j < height; j++) {
+        const unsigned char *cur = data + j * row, *prior = j > 0 ? cur - row : zero;
+        unsigned char *dst = filt + j * (row + 1) + 1;
+        int type = filter;
+        if (type >= 0) {
+            filter_row(type, cur, prior, (int)row, channels, dst);
+        } else {
+            // O melhor até aqui e o candidato trocam de buffer
+            unsigned char *best_buf = dst, *cand = scratch;
+            uint32_t best_cost = UINT32_MAX;
+            for (int t = 0; t < 5; t++) {
+                filter_row(t, cur, prior, (int)row, channels, cand);
+                uint32_t cost = row_cost(cand, (int)row);
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    type = t;
+                    unsigned char *tmp = best_buf;
+                    best_buf = cand;
+                    cand = tmp;
+                }
+            }
+            if (best_buf != dst) memcpy(dst, best_buf, row);
+        }
+        dst[-1] = (unsigned char)type;
+    }
+    
+    free(zero);
+    free(scratch);
+    return 0;
+}
+
+// Tamanho, tipo, dados e CRC (do tipo e dos dados) de um bloco PNG
+static unsigned char* put_chunk(unsigned char *o, const char *tag, const unsigned char *data,
+                                uint32_t len) {
+    stbiw__wp32(o, len);
+    memcpy(o, tag, 4);
+    if (len > 0) memcpy(o + 4, data, len);
+    uint32_t crc = crc32_update(0, o, len + 4);
+    o += len + 4;
+    stbiw__wp32(o, crc);
+    return o;
+}
+
+// Como stbi_write_png_to_mem, com o filtro e o nível do perfil; com
+// png_fast, filtros vetoriais e o deflate de deflate.c no lugar do zlib
+// do stb
+int encode_png(encode_write_func *func, void *context, int width, int height, int channels,
+               const unsigned char *data, const encode_profile_t *profile) {
+    static const int ctype[5] = { -1, 0, 4, 2, 6 };
+    static const unsigned char sig[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    if (!data || width < 1 || height < 1 || channels < 1 || channels > 4) return -1;
+    
+    size_t filt_len = ((size_t)width * channels + 1) * height;
+    unsigned char *filt = (unsigned char*)STBIW_MALLOC(filt_len);
+    if (!filt) return -1;
+    int rc = profile->png_fast
+        ? filter_rows_fast(data, width, height, channels, profile->png_filter, filt)
+        : filter_rows_stb(data, width, height, channels, profile->png_filter, filt);
+    
+    unsigned char *zlib = NULL;
+    size_t zlen = 0;
+    if (rc == 0 && profile->png_fast) {
+        zlib = deflate_zlib(filt, filt_len, profile->png_level, &zlen);
+    } else if (rc == 0) {
+        int len;
+        zlib = stbi_zlib_compress(filt, (int)filt_len, &len, profile->png_level);
+        zlen = (size_t)len;
+    }
+    STBIW_FREE(filt);
+    if (!zlib || zlen > 0x7fffffff - 64) {
+        STBIW_FREE(zlib);
+        return -1;
+    }
+    
+    // Assinatura, IHDR, IDAT e IEND (12 bytes de moldura por bloco)
+    size_t len = 8 + 12 + 13 + 12 + zlen + 12;
+    unsigned char *out = (unsigned char*)STBIW_MALLOC(len), *o = out;
+    if (!out) {
+        STBIW_FREE(zlib);
+        return -1;
+    }
+    unsigned char ihdr[13], *h = ihdr;
+    stbiw__wp32(h, width);
+    stbiw__wp32(h, height);
+    *h++ = 8;
+    *h++ = (unsigned char)ctype[channels];
+    *h++ = 0;
+    *h++ = 0;
+    *h++ = 0;
+    
+    memcpy(o, sig, 8);
+    o = put_chunk(o + 8, "IHDR", ihdr, 13);
+    o = put_chunk(o, "IDAT", zlib, (uint32_t)zlen);
+    put_chunk(o, "IEND", NULL, 0);
+    STBIW_FREE(zlib);
+    
+    func(context, out, (int)len);
+    STBIW_FREE(out);
+    return 0;
+}
+
+// ============================================================
+// QOI, PPM E PAM
+// ============================================================
+
+int encode_qoi(encode_write_func *func, void *context, int width, int height, int channels,
+               const unsigned char *data) {
+    if (!data) return -1;
+    size_t len;
+    unsigned char *out = qoi_encode(data, width, height, channels, &len);
+    if (!out || len > INT_MAX) {
+        free(out);
+        return -1;
+    }
+    func(context, out, (int)len);
+    free(out);
+    return 0;
+}
+
+int raw_header(output_format_t format, int width, int height, int channels,
+               char *buf, size_t len) {
+    static const char *const tupltype[5] = { NULL, "GRAYSCALE", "GRAYSCALE_ALPHA", "RGB", "RGB_ALPHA" };
+    if (channels < 1 || channels > 4) return 0;
+    
+    int n = 0;
+    if (format == OUTPUT_PPM && (channels == 1 || channels == 3)) {
+        n = snprintf(buf, len, "P%d\n%d %d\n255\n", channels == 1 ? 5 : 6, width, height);
+    } else if (format == OUTPUT_PAM) {
+        n = snprintf(buf, len, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n",
+                     width, height, channels, tupltype[channels]);
+    }
+    return n > 0 && (size_t)n < len ? n : 0;
+}
+
+int encode_raw(encode_write_func *func, void *context, output_format_t format,
+               int width, int height, int channels, const unsigned char *data) {
+    if (!data || width < 1 || height < 1) return -1;
+    char header[RAW_HEADER_MAX];
+    size_t row = (size_t)width * channels;
+    if (row > INT_MAX) return -1;
+    
+    int n = raw_header(format, width, height, channels, header, sizeof(header));
+    if (n > 0) {
+        func(context, header, n);
+        for (int y = 0; y < height; y++) {
+            func(context, (void*)(data + y * row), (int)row);
+        }
+        return 0;
+    }
+    
+    // PPM com alfa: só os canais de cor
+    if (format != OUTPUT_PPM || (channels != 2 && channels != 4)) return -1;
+    int color = channels - 1;
+    n = raw_header(format, width, height, color, header, sizeof(header));
+    unsigned char *line = (unsigned char*)malloc((size_t)width * color);
+    if (n == 0 || !line) {
+        free(line);
+        return -1;
+    }
+    func(context, header, n);
+    for (int y = 0; y < height; y++) {
+        const unsigned char *src = data + y * row;
+        for (int x = 0; x < width; x++) {
+            memcpy(line + (size_t)x * color, src + (size_t)x * channels, color);
+        }
+        func(context, line, width * color);
+    }
+    free(line);
+    return 0;
+}
+
+// ============================================================
+// PERFIS
+// ============================================================
+
+static const char *const png_filter_names[] = { "none", "sub", "up", "avg", "paeth" };
+
+typedef struct {
+    const char *name;
+    encode_profile_t profile;
+} profile_preset_t;
+
+// default reproduz o stbi_write_jpg (qualidade 90) e o stbi_write_png
+static const profile_preset_t presets[] = {
+    { "default", ENCODE_PROFILE_DEFAULT },
+    { "thumb",   { .jpeg_quality = 75, .jpeg_subsample = 1, .png_level = 5, .png_filter = 1 } },
+    { "archive", { .jpeg_quality = 95, .jpeg_subsample = 0, .png_level = 9, .png_filter = -1 } },
+};
+
+static const char *const format_names[NUM_OUTPUT_FORMATS] = { "jpg", "png", "qoi", "ppm", "pam" };
+
+output_format_t output_format_for(const char *filename) {
+    const char *ext = strrchr(filename, '.');
+    if (!ext) return OUTPUT_JPEG;
+    if (strcmp(ext, ".pgm") == 0) return OUTPUT_PPM;
+    int format = parse_output_format(ext + 1);
+    return format > 0 ? (output_format_t)format : OUTPUT_JPEG;
+}
+
+const char* output_format_ext(output_format_t format) {
+    return format >= 0 && format < NUM_OUTPUT_FORMATS ? format_names[format] : format_names[0];
+}
+
+int parse_output_format(const char *name) {
+    for (int i = 0; i < NUM_OUTPUT_FORMATS; i++) {
+        if (strcmp(name, format_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+// Inteiro decimal que ocupa o resto do texto, em [min, max]
+static int parse_field_int(const char *text, int min, int max, int *value) {
+    char *end;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < min || v > max) return -1;
+    *value = (int)v;
+    return 0;
+}
+
+int parse_encode_profile(const char *text, encode_profile_t *profile) {
+    encode_profile_t p = presets[0].profile;
+    char buf[128];
+    if (strlen(text) >= sizeof(buf)) return -1;
+    strcpy(buf, text);
+    
+    char *save = NULL;
+    for (char *field = strtok_r(buf, "/", &save); field; field = strtok_r(NULL, "/", &save)) {
+        int value, known = 0;
+        for (size_t i = 0; i < sizeof(presets) / sizeof(presets[0]); i++) {
+            if (strcmp(field, presets[i].name) == 0) {
+                p = presets[i].profile;
+                known = 1;
+            }
+        }
+        for (int i = 0; i < 5; i++) {
+            if (strcmp(field, png_filter_names[i]) == 0) {
+                p.png_filter = (signed char)i;
+                known = 1;
+            }
+        }
+        if (known) continue;
+        
+        if (parse_output_format(field) >= 0) {
+            p.format = (signed char)(parse_output_format(field) + 1);
+        } else if (strcmp(field, "adaptive") == 0) {
+            p.png_filter = -1;
+        } else if (strcmp(field, "fast") == 0 || strcmp(field, "stb") == 0) {
+            p.png_fast = field[0] == 'f';
+        } else if (strcmp(field, "420") == 0 || strcmp(field, "444") == 0) {
+            p.jpeg_subsample = field[1] == '2';
+        } else if (field[0] == 'q' && parse_field_int(field + 1, 1, 100, &value) == 0) {
+            p.jpeg_quality = (signed char)value;
+        } else if (field[0] == 'z' && parse_field_int(field + 1, 1, 9, &value) == 0) {
+            p.png_level = (signed char)value;
+        } else {
+            return -1;
+        }
+    }
+    
+    *profile = p;
+    return 0;
+}
+
+uint32_t encode_stat_key(output_format_t format, const encode_profile_t *profile) {
+    // QOI, PPM e PAM não têm parâmetros
+    if (format > OUTPUT_PNG) return (uint32_t)(format + 1) << 16;
+    int a = format == OUTPUT_PNG ? profile->png_level : profile->jpeg_quality;
+    int b = format == OUTPUT_PNG ? profile->png_filter + 1 : profile->jpeg_subsample;
+    uint32_t fast = format == OUTPUT_PNG && profile->png_fast;
+    return fast << 24 | (uint32_t)(format + 1) << 16 | (uint32_t)(a & 0xFF) << 8 | (uint32_t)(b & 0xFF);
+}
+
+void describe_encode_key(uint32_t key, char *buf, size_t len) {
+    int format = (int)((key >> 16) & 0xFF) - 1;
+    int a = (key >> 8) & 0xFF, b = key & 0xFF;
+    if (format == OUTPUT_PNG) {
+        snprintf(buf, len, "png%s z%d %s", key >> 24 ? " fast" : "", a,
+                 b == 0 ? "adaptive" : png_filter_names[b - 1]);
+    } else if (format > OUTPUT_PNG) {
+        snprintf(buf, len, "%s", output_format_ext((output_format_t)format));
+    } else {
+        snprintf(buf, len, "jpg q%d %s", a, b ? "4:2:0" : "4:4:4");
+    }
+}
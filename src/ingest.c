@@ -0,0 +1,400 @@
+#include "ingest.h"
+#include <sys/syscall.h>
+
+// Registro devolvido pelo kernel em getdents64
+struct linux_dirent64 {
+    ino64_t        d_ino;
+    off64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+
+// ============================================================
+// ARENA DE NOMES
+// ============================================================
+
+int arena_init(name_arena_t *arena, size_t size) {
+    arena->data = (char*)malloc(size);
+    if (!arena->data) {
+        LOG_ERROR("Falha ao alocar arena de nomes (%zu bytes)", size);
+        return -1;
+    }
+    arena->size = size;
+    arena->used = 0;
+    return 0;
+}
+
+const char* arena_push(name_arena_t *arena, const char *name, size_t len) {
+    if (arena->used + len + 1 > arena->size) {
+        return NULL;
+    }
+    char *dst = arena->data + arena->used;
+    memcpy(dst, name, len);
+    dst[len] = '\0';
+    arena->used += len + 1;
+    return dst;
+}
+
+void arena_reset(name_arena_t *arena) {
+    arena->used = 0;
+}
+
+void arena_free(name_arena_t *arena) {
+    free(arena->data);
+    arena->data = NULL;
+    arena->size = 0;
+    arena->used = 0;
+}
+
+// ============================================================
+// FILTRO DE EXTENSÕES
+// ============================================================
+
+int is_image_file(const char *name) {
+    // Ignora ocultos, . e ..
+    if (name[0] == '.') return 0;
+    
+    const char *ext = strrchr(name, '.');
+    if (!ext) return 0;
+    
+    // QOI pelo decodificador de qoi.c; PPM/PGM (P5/P6) pelo stb_image
+    return strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0 ||
+           strcasecmp(ext, ".png") == 0 || strcasecmp(ext, ".bmp") == 0 ||
+           strcasecmp(ext, ".qoi") == 0 || strcasecmp(ext, ".ppm") == 0 ||
+           strcasecmp(ext, ".pgm") == 0;
+}
+
+// ============================================================
+// VARREDURA EM STREAMING (getdents64)
+// ============================================================
+
+// Despacha os nomes acumulados na arena e a esvazia
+static int flush_arena(name_arena_t *arena, ingest_cb_t cb, void *user) {
+    size_t pos = 0;
+    while (pos < arena->used) {
+        const char *name = arena->data + pos;
+        size_t len = strlen(name);
+        if (cb(name, user) != 0) {
+            return -1;
+        }
+        pos += len + 1;
+    }
+    arena_reset(arena);
+    return 0;
+}
+
+long ingest_directory_stream(const char *dir_path, ingest_cb_t cb, void *user) {
+    int fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        LOG_ERROR("Não foi possível abrir diretório: %s", dir_path);
+        return -1;
+    }
+    
+    // Buffer do lote e arena têm tamanho fixo: a memória usada não
+    // depende da quantidade de arquivos no diretório
+    char *batch = (char*)malloc(INGEST_BATCH_SIZE);
+    name_arena_t arena;
+    if (!batch || arena_init(&arena, INGEST_BATCH_SIZE) != 0) {
+        LOG_ERROR("Falha ao alocar buffers de varredura");
+        free(batch);
+        close(fd);
+        return -1;
+    }
+    
+    long found = 0;
+    int error = 0;
+    
+    while (!error) {
+        long nread = syscall(SYS_getdents64, fd, batch, INGEST_BATCH_SIZE);
+        if (nread == -1) {
+            if (errno == EINTR) continue;
+            perror("getdents64");
+            error = 1;
+            break;
+        }
+        if (nread == 0) break;  // Fim do diretório
+        
+        for (long pos = 0; pos < nread; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64*)(batch + pos);
+            pos += d->d_reclen;
+            
+            // Só arquivos regulares (DT_UNKNOWN em alguns sistemas de arquivos)
+            if (d->d_type != DT_REG && d->d_type != DT_UNKNOWN && d->d_type != DT_LNK) continue;
+            if (!is_image_file(d->d_name)) continue;
+            
+            // Um nome nunca ocupa mais que seu registro, então a arena
+            // (do mesmo tamanho do lote) sempre comporta o lote inteiro
+            arena_push(&arena, d->d_name, strlen(d->d_name));
+            found++;
+        }
+        
+        // Despacha o lote antes de ler o próximo
+        if (flush_arena(&arena, cb, user) != 0) {
+            error = 1;
+        }
+    }
+    
+    arena_free(&arena);
+    free(batch);
+    close(fd);
+    
+    return error ? -1 : found;
+}
+
+// ============================================================
+// VARREDURA RECURSIVA COM VÁRIAS THREADS
+// ============================================================
+
+// Diretório pendente (caminho relativo à raiz)
+typedef struct dir_node {
+    struct dir_node *next;
+    char path[];
+} dir_node_t;
+
+// Pilha compartilhada pelos walkers (LIFO: mantém a fronteira pequena)
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    dir_node_t *stack;
+    int pending;            // Diretórios na pilha ou em processamento
+    int aborted;
+    int root_fd;
+    long found;
+    ingest_cb_t cb;
+    void *user;
+} walk_state_t;
+
+static dir_node_t* make_dir_node(const char *parent, const char *name) {
+    size_t plen = parent ? strlen(parent) : 0;
+    size_t nlen = strlen(name);
+    dir_node_t *node = (dir_node_t*)malloc(sizeof(dir_node_t) + plen + nlen + 2);
+    if (!node) return NULL;
+    
+    if (plen > 0) {
+        memcpy(node->path, parent, plen);
+        node->path[plen] = '/';
+        memcpy(node->path + plen + 1, name, nlen + 1);
+    } else {
+        memcpy(node->path, name, nlen + 1);
+    }
+    node->next = NULL;
+    return node;
+}
+
+static void push_dir(walk_state_t *ws, dir_node_t *node) {
+    pthread_mutex_lock(&ws->lock);
+    node->next = ws->stack;
+    ws->stack = node;
+    ws->pending++;
+    pthread_cond_signal(&ws->cond);
+    pthread_mutex_unlock(&ws->lock);
+}
+
+// Lê um diretório: subdiretórios vão para a pilha, imagens para o callback
+static void walk_one_dir(walk_state_t *ws, const char *rel) {
+    int fd = openat(ws->root_fd, rel, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        LOG_ERROR("Não foi possível abrir diretório: %s/%s (%s)", INPUT_DIR, rel, strerror(errno));
+        return;
+    }
+    
+    DIR *dir = fdopendir(fd);
+    if (!dir) {
+        perror("fdopendir");
+        close(fd);
+        return;
+    }
+    
+    // "." é a raiz: os filhos não recebem prefixo
+    const char *prefix = strcmp(rel, ".") == 0 ? NULL : rel;
+    struct dirent *entry;
+    
+    while ((entry = readdir(dir)) != NULL) {
+        if (__atomic_load_n(&ws->aborted, __ATOMIC_RELAXED)) break;
+        if (entry->d_name[0] == '.') continue;
+        
+        unsigned char type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == -1) continue;
+            if (S_ISDIR(st.st_mode)) type = DT_DIR;
+            else if (S_ISREG(st.st_mode)) type = DT_REG;
+            else if (S_ISLNK(st.st_mode)) type = DT_LNK;
+        }
+        
+        if (type == DT_DIR) {
+            // Links simbólicos para diretórios não são seguidos (evita ciclos)
+            dir_node_t *node = make_dir_node(prefix, entry->d_name);
+            if (!node) {
+                LOG_ERROR("Falha ao alocar nó de diretório");
+                continue;
+            }
+            push_dir(ws, node);
+        } else if ((type == DT_REG || type == DT_LNK) && is_image_file(entry->d_name)) {
+            dir_node_t *file = make_dir_node(prefix, entry->d_name);
+            if (!file) {
+                LOG_ERROR("Falha ao alocar caminho de arquivo");
+                continue;
+            }
+            if (ws->cb(file->path, ws->user) != 0) {
+                __atomic_store_n(&ws->aborted, 1, __ATOMIC_RELAXED);
+            } else {
+                __atomic_fetch_add(&ws->found, 1, __ATOMIC_RELAXED);
+            }
+            free(file);
+        }
+    }
+    
+    closedir(dir);  // Fecha também o fd
+}
+
+static void* walker_thread(void *arg) {
+    walk_state_t *ws = (walk_state_t*)arg;
+    
+    while (1) {
+        pthread_mutex_lock(&ws->lock);
+        while (!ws->stack && ws->pending > 0) {
+            pthread_cond_wait(&ws->cond, &ws->lock);
+        }
+        if (!ws->stack) {
+            // Pilha vazia e nenhum diretório em processamento: fim
+            pthread_mutex_unlock(&ws->lock);
+            break;
+        }
+        dir_node_t *node = ws->stack;
+        ws->stack = node->next;
+        pthread_mutex_unlock(&ws->lock);
+        
+        walk_one_dir(ws, node->path);
+        free(node);
+        
+        pthread_mutex_lock(&ws->lock);
+        if (--ws->pending == 0) {
+            pthread_cond_broadcast(&ws->cond);
+        }
+        pthread_mutex_unlock(&ws->lock);
+    }
+    
+    return NULL;
+}
+
+long ingest_tree_parallel(const char *dir_path, int num_walkers, ingest_cb_t cb, void *user) {
+    walk_state_t ws = {
+        .stack = NULL,
+        .pending = 0,
+        .aborted = 0,
+        .found = 0,
+        .cb = cb,
+        .user = user
+    };
+    
+    ws.root_fd = open(dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (ws.root_fd == -1) {
+        LOG_ERROR("Não foi possível abrir diretório: %s", dir_path);
+        return -1;
+    }
+    pthread_mutex_init(&ws.lock, NULL);
+    pthread_cond_init(&ws.cond, NULL);
+    
+    dir_node_t *root = make_dir_node(NULL, ".");
+    if (!root) {
+        close(ws.root_fd);
+        return -1;
+    }
+    push_dir(&ws, root);
+    
+    pthread_t *walkers = (pthread_t*)calloc(num_walkers, sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; walkers && i < num_walkers; i++) {
+        if (pthread_create(&walkers[i], NULL, walker_thread, &ws) != 0) {
+            LOG_ERROR("Falha ao criar walker %d", i);
+            break;
+        }
+        started++;
+    }
+    
+    if (started == 0) {
+        // Sem threads extras: percorre na thread atual
+        walker_thread(&ws);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(walkers[i], NULL);
+    }
+    free(walkers);
+    
+    // Em caso de abort podem sobrar diretórios na pilha
+    while (ws.stack) {
+        dir_node_t *next = ws.stack->next;
+        free(ws.stack);
+        ws.stack = next;
+    }
+    
+    pthread_cond_destroy(&ws.cond);
+    pthread_mutex_destroy(&ws.lock);
+    close(ws.root_fd);
+    
+    return ws.aborted ? -1 : ws.found;
+}
+
+// ============================================================
+// LISTA DE ARQUIVOS (MANIFESTO)
+// ============================================================
+
+int is_safe_relative_path(const char *path) {
+    const char *p = path;
+    while (*p) {
+        const char *end = strchr(p, '/');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len == 2 && p[0] == '.' && p[1] == '.') return 0;
+        if (!end) break;
+        p = end + 1;
+    }
+    return 1;
+}
+
+long ingest_file_list(const char *list_path, int delim, ingest_cb_t cb, void *user) {
+    FILE *fp = stdin;
+    if (strcmp(list_path, "-") != 0) {
+        fp = fopen(list_path, "r");
+        if (!fp) {
+            LOG_ERROR("Não foi possível abrir lista: %s (%s)", list_path, strerror(errno));
+            return -1;
+        }
+    }
+    
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    long found = 0;
+    int error = 0;
+    
+    while ((len = getdelim(&line, &cap, delim, fp)) != -1) {
+        // Remove o delimitador (e '\r' de listas geradas no Windows)
+        if (len > 0 && line[len - 1] == delim) line[--len] = '\0';
+        if (delim == '\n' && len > 0 && line[len - 1] == '\r') line[--len] = '\0';
+        if (len == 0) continue;
+        
+        const char *name = strrchr(line, '/');
+        name = name ? name + 1 : line;
+        if (!is_image_file(name)) {
+            LOG_ERROR("Ignorado (extensão não suportada): %s", line);
+            continue;
+        }
+        if (!is_safe_relative_path(line)) {
+            LOG_ERROR("Ignorado (caminho com \"..\"): %s", line);
+            continue;
+        }
+        
+        if (cb(line, user) != 0) {
+            error = 1;
+            break;
+        }
+        found++;
+    }
+    
+    free(line);
+    if (fp != stdin) fclose(fp);
+    
+    return error ? -1 : found;
+}
@@ -1,4 +1,6 @@
 #include "ipc_manager.h"
+#include "histogram.h"
+#include <sys/eventfd.h>
 
 // ============================================================
 // FILA DE MENSAGENS POSIX
@@ -33,29 +35,62 @@ mqd_t open_message_queue(const char *name) {
     return mq;
 }
 
-int send_task(mqd_t mq, const char *filename, int task_id) {
-    task_message_t msg = {
-        .msg_type = MSG_TASK,
-        .task_id = task_id
-    };
-    strncpy(msg.filename, filename, MAX_FILENAME - 1);
-    msg.filename[MAX_FILENAME - 1] = '\0';
+void init_task_message(task_message_t *msg, int task_id) {
+    memset(msg, 0, offsetof(task_message_t, filename));
+    msg->msg_type = MSG_TASK;
+    msg->task_id = task_id;
+    msg->job_id = 0;
+    msg->filter_mask = FILTER_ALL_MASK;
+    msg->src_fd = -1;
+    msg->flags = 0;
+    strcpy(msg->out_ext, "jpg");
+    msg->filename[0] = '\0';
+    msg->filename[1] = '\0';
+}
+
+const char* task_output_prefix(const task_message_t *msg) {
+    return msg->filename + strlen(msg->filename) + 1;
+}
+
+int send_task_message(mqd_t mq, task_message_t *msg) {
+    // Envia apenas o cabeçalho e os dois caminhos (sem o restante do buffer)
+    size_t in_len = strlen(msg->filename);
+    size_t out_len = strlen(msg->filename + in_len + 1);
+    size_t msg_len = offsetof(task_message_t, filename) + in_len + out_len + 2;
     
-    if (mq_send(mq, (char*)&msg, sizeof(msg), 0) == -1) {
-        perror("mq_send");
+    msg->enqueue_ns = monotonic_ns();
+    if (mq_send(mq, (char*)msg, msg_len, 0) == -1) {
+        if (errno != EAGAIN) {
+            perror("mq_send");
+        }
         return -1;
     }
     return 0;
 }
 
+int send_task(mqd_t mq, const char *filename, int task_id, int filter_mask) {
+    size_t len = strlen(filename);
+    if (len + 2 > MAX_TASK_PATH) {
+        LOG_ERROR("Caminho excede PATH_MAX: %.64s...", filename);
+        return -1;
+    }
+    
+    task_message_t msg;
+    init_task_message(&msg, task_id);
+    memcpy(msg.filename, filename, len + 1);
+    msg.filename[len + 1] = '\0';  // Prefixo de saída vazio
+    msg.filter_mask = filter_mask;
+    
+    return send_task_message(mq, &msg);
+}
+
 int send_terminate(mqd_t mq) {
-    task_message_t msg = {
-        .msg_type = MSG_TERMINATE,
-        .task_id = -1
-    };
-    msg.filename[0] = '\0';
+    task_message_t msg;
+    init_task_message(&msg, -1);
+    msg.msg_type = MSG_TERMINATE;
     
-    if (mq_send(mq, (char*)&msg, sizeof(msg), 0) == -1) {
+    size_t msg_len = offsetof(task_message_t, filename) + 2;
+    if (mq_send(mq, (char*)&msg, msg_len, 0) == -1) {
         perror("mq_send (terminate)");
         return -1;
     }
@@ -153,17 +188,204 @@ void unlink_shared_memory(const char *name) {
 }
 
 // ============================================================
-// PIPES
+// ESTATÍSTICAS SEM TRAVA
 // ============================================================
 
-int create_pipe(int pipefd[2]) {
-    if (pipe(pipefd) == -1) {
-        perror("pipe");
+// Um id que não chega à fila é só pulado; o total conta apenas as enviadas
+int stats_next_task_id(shared_stats_t *stats) {
+    return __atomic_fetch_add(&stats->next_task_id, 1, __ATOMIC_RELAXED);
+}
+
+void stats_count_task(shared_stats_t *stats) {
+    __atomic_fetch_add(&stats->total_images, 1, __ATOMIC_RELAXED);
+}
+
+void stats_collect(const shared_stats_t *stats, stats_totals_t *totals) {
+    memset(totals, 0, sizeof(*totals));
+    
+    for (int i = 0; i < stats->num_workers; i++) {
+        const worker_stats_t *ws = &stats->workers[i];
+        totals->processed_images += __atomic_load_n(&ws->processed, __ATOMIC_RELAXED);
+        totals->failed_images += __atomic_load_n(&ws->failed, __ATOMIC_RELAXED);
+        totals->busy_time += __atomic_load_n(&ws->busy_us, __ATOMIC_RELAXED) / 1e6;
+        totals->workers_active += __atomic_load_n(&ws->active, __ATOMIC_RELAXED);
+        totals->workers_done += __atomic_load_n(&ws->done, __ATOMIC_RELAXED);
+        totals->scaled_decodes += __atomic_load_n(&ws->scaled_decodes, __ATOMIC_RELAXED);
+        totals->region_decodes += __atomic_load_n(&ws->region_decodes, __ATOMIC_RELAXED);
+    }
+}
+
+void stats_merge_latency(const shared_stats_t *stats, worker_latency_t *merged) {
+    memset(merged, 0, sizeof(*merged));
+    
+    for (int w = 0; w < stats->num_workers; w++) {
+        const worker_latency_t *lat = &stats->latency[w];
+        hist_merge(&merged->decode, &lat->decode);
+        hist_merge(&merged->total, &lat->total);
+        for (int f = 0; f < NUM_THREADS; f++) {
+            hist_merge(&merged->filter[f], &lat->filter[f]);
+            hist_merge(&merged->encode[f], &lat->encode[f]);
+            hist_merge(&merged->write[f], &lat->write[f]);
+        }
+    }
+}
+
+int stats_collect_encode(const shared_stats_t *stats, encode_totals_t *out, int max) {
+    int count = 0;
+    
+    for (int w = 0; w < stats->num_workers; w++) {
+        for (int f = 0; f < NUM_THREADS; f++) {
+            for (int s = 0; s < ENCODE_STAT_SLOTS; s++) {
+                // A chave é publicada depois dos primeiros contadores
+                const encode_totals_t *t = &stats->encode[w][f].slots[s];
+                uint32_t key = __atomic_load_n(&t->key, __ATOMIC_ACQUIRE);
+                if (key == 0) break;
+                
+                int i = 0;
+                while (i < count && out[i].key != key) i++;
+                if (i == count) {
+                    if (count == max) continue;
+                    memset(&out[count], 0, sizeof(out[count]));
+                    out[count++].key = key;
+                }
+                out[i].outputs += __atomic_load_n(&t->outputs, __ATOMIC_RELAXED);
+                out[i].pixels += __atomic_load_n(&t->pixels, __ATOMIC_RELAXED);
+                out[i].bytes += __atomic_load_n(&t->bytes, __ATOMIC_RELAXED);
+                out[i].ns += __atomic_load_n(&t->ns, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    return count;
+}
+
+void stats_set_current_file(worker_stats_t *ws, const char *name) {
+    // Mantém o final do nome se for longo
+    size_t len = strlen(name);
+    if (len >= MAX_FILENAME) name += len - (MAX_FILENAME - 1);
+    
+    // Seqlock: número ímpar enquanto o texto está sendo trocado
+    unsigned int seq = ws->file_seq;
+    __atomic_store_n(&ws->file_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    strncpy(ws->current_file, name, MAX_FILENAME - 1);
+    ws->current_file[MAX_FILENAME - 1] = '\0';
+    __atomic_store_n(&ws->file_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void stats_get_current_file(const worker_stats_t *ws, char *out) {
+    unsigned int seq;
+    do {
+        seq = __atomic_load_n(&ws->file_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+        memcpy(out, ws->current_file, MAX_FILENAME);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || __atomic_load_n(&ws->file_seq, __ATOMIC_RELAXED) != seq);
+    
+    out[MAX_FILENAME - 1] = '\0';
+}
+
+// ============================================================
+// CANAL DE EVENTOS DE CONCLUSÃO
+// ============================================================
+
+int create_done_channel(int sv[2]) {
+    // SEQPACKET preserva os limites de cada mensagem: vários workers
+    // podem escrever na mesma ponta sem intercalar eventos
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+        perror("socketpair");
+        return -1;
+    }
+    return 0;
+}
+
+// eventfd de progresso: workers somam 1 a cada imagem concluída (e ao
+// terminar); o coordenador dorme nele em vez de consultar periodicamente
+int create_progress_channel(void) {
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd == -1) {
+        perror("eventfd");
+    }
+    return fd;
+}
+
+void notify_progress(int fd) {
+    uint64_t one = 1;
+    if (write(fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+        perror("write (progresso)");
+    }
+}
+
+int send_job_done(int fd, const job_done_t *done, const int *fds, int nfds) {
+    ssize_t n;
+    do {
+        n = send_with_fds(fd, done, sizeof(*done), fds, nfds, 0);
+    } while (n == -1 && errno == EINTR);
+    
+    if (n == -1) {
+        perror("send (conclusão)");
         return -1;
     }
     return 0;
 }
 
+// ============================================================
+// PASSAGEM DE DESCRITORES (SCM_RIGHTS)
+// ============================================================
+
+ssize_t send_with_fds(int sock, const void *buf, size_t len,
+                      const int *fds, int nfds, int flags) {
+    struct iovec iov = { .iov_base = (void*)buf, .iov_len = len };
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+    char control[CMSG_SPACE(MAX_PASSED_FDS * sizeof(int))];
+    
+    if (nfds > MAX_PASSED_FDS) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (nfds > 0) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(nfds * sizeof(int));
+        
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(nfds * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, nfds * sizeof(int));
+    }
+    
+    return sendmsg(sock, &msg, flags | MSG_NOSIGNAL);
+}
+
+ssize_t recv_with_fds(int sock, void *buf, size_t len,
+                      int *fds, int *nfds, int flags) {
+    struct iovec iov = { .iov_base = buf, .iov_len = len };
+    char control[CMSG_SPACE(MAX_PASSED_FDS * sizeof(int))];
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = sizeof(control)
+    };
+    
+    *nfds = 0;
+    ssize_t n = recvmsg(sock, &msg, flags | MSG_CMSG_CLOEXEC);
+    if (n == -1) return -1;
+    
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        memcpy(fds + *nfds, CMSG_DATA(cmsg), count * sizeof(int));
+        *nfds += count;
+    }
+    
+    // Descritores que não couberam foram fechados pelo kernel
+    if (msg.msg_flags & MSG_CTRUNC) {
+        LOG_ERROR("Descritores recebidos descartados (MSG_CTRUNC)");
+    }
+    return n;
+}
+
 // ============================================================
 // LIMPEZA GERAL
 // ============================================================
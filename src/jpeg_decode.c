@@ -0,0 +1,587 @@
+// Implementação do stb_image: fica nesta unidade porque a decodificação
+// reduzida usa as estruturas internas do decodificador JPEG (stbi__jpeg)
+// IMPORTANTE: o define deve vir ANTES de qualquer include
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "jpeg_decode.h"
+#include "stb_image.h"
+
+// ============================================================
+// IDCT REDUZIDA
+// ============================================================
+
+// Uma IDCT de N pontos sobre os N primeiros coeficientes da DCT 8×8 dá
+// a imagem filtrada amostrada no centro de cada grupo de 8/N pixels (perto
+// da média da área, sem o aliasing do vizinho mais próximo). Tabelas em Q12:
+// C(u) * cos((2x + 1) * u * pi / 2N), com C(0) = 1/sqrt(2)
+static const int idct4_table[4][4] = {
+    { 2896,  3784,  2896,  1567 },
+    { 2896,  1567, -2896, -3784 },
+    { 2896, -1567, -2896,  3784 },
+    { 2896, -3784,  2896, -1567 }
+};
+
+static const int idct2_table[2][2] = {
+    { 2896,  2896 },
+    { 2896, -2896 }
+};
+
+// O kernel do stb só recebe o destino do bloco 8×8: o decodificador em
+// curso (um por thread) permite achar o componente e a posição do bloco
+static __thread stbi__jpeg *active_jpeg;
+static __thread int scaled_block;   // Lado do bloco reduzido: 4, 2 ou 1
+
+static stbi_uc clamp_sample(int v) {
+    return (stbi_uc)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+// Componente do destino de idct_block_kernel e o bloco (bx, by) no plano
+// dele; -1 se o endereço não pertence a nenhum plano
+static int locate_block(const stbi__jpeg *z, const stbi_uc *out, int stride, int *bx, int *by) {
+    for (int k = 0; k < z->s->img_n; k++) {
+        uintptr_t base = (uintptr_t)z->img_comp[k].data;
+        uintptr_t addr = (uintptr_t)out;
+        if (addr < base || addr >= base + (size_t)z->img_comp[k].w2 * z->img_comp[k].h2) continue;
+        
+        size_t off = addr - base;
+        *by = (int)(off / stride / 8);
+        *bx = (int)(off % stride / 8);
+        return k;
+    }
+    return -1;
+}
+
+// Substitui idct_block_kernel. Os coeficientes chegam desquantizados, em
+// ordem natural (data[v * 8 + u]); o bloco (i, j) do plano, que o stb
+// escreveria em data + w2*8j + 8i, vai para data + w2*N*j + N*i
+static void idct_scaled_block(stbi_uc *out, int out_stride, short data[64]) {
+    int n = scaled_block;
+    int bx, by;
+    int k = locate_block(active_jpeg, out, out_stride, &bx, &by);
+    if (k >= 0) out = active_jpeg->img_comp[k].data + (size_t)by * n * out_stride + bx * n;
+    
+    if (n == 1) {
+        // Só o DC: média do bloco
+        out[0] = clamp_sample(((data[0] + 4) >> 3) + 128);
+        return;
+    }
+    
+    const int (*table)[4] = idct4_table;
+    int tmp[4][4];
+    if (n == 2) {
+        for (int v = 0; v < 2; v++) {
+            for (int x = 0; x < 2; x++) {
+                tmp[v][x] = idct2_table[x][0] * data[v * 8] + idct2_table[x][1] * data[v * 8 + 1];
+            }
+        }
+        for (int y = 0; y < 2; y++) {
+            for (int x = 0; x < 2; x++) {
+                int64_t acc = (int64_t)idct2_table[y][0] * tmp[0][x] +
+                              (int64_t)idct2_table[y][1] * tmp[1][x];
+                // 1/4 da IDCT 2-D e as duas escalas Q12
+                out[y * out_stride + x] = clamp_sample((int)((acc + (1 << 25)) >> 26) + 128);
+            }
+        }
+        return;
+    }
+    
+    // Linhas (frequência horizontal u), depois colunas (v)
+    for (int v = 0; v < 4; v++) {
+        const short *row = data + v * 8;
+        for (int x = 0; x < 4; x++) {
+            tmp[v][x] = table[x][0] * row[0] + table[x][1] * row[1] +
+                        table[x][2] * row[2] + table[x][3] * row[3];
+        }
+    }
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            int64_t acc = (int64_t)table[y][0] * tmp[0][x] + (int64_t)table[y][1] * tmp[1][x] +
+                          (int64_t)table[y][2] * tmp[2][x] + (int64_t)table[y][3] * tmp[3][x];
+            out[y * out_stride + x] = clamp_sample((int)((acc + (1 << 25)) >> 26) + 128);
+        }
+    }
+}
+
+// ============================================================
+// REAMOSTRAGEM E COR NO TAMANHO REDUZIDO
+// ============================================================
+
+// Mesmo caminho de load_jpeg_image do stb, mas com os planos já reduzidos
+// e a imagem de saída em img_x / scale × img_y / scale. Só Y e YCbCr/RGB
+// (n = 1 ou 3, sem req_comp)
+static stbi_uc* convert_scaled(stbi__jpeg *z, int scale, int *out_x, int *out_y, int *comp) {
+    int img_n = z->s->img_n;
+    if (img_n != 1 && img_n != 3) {
+        stbi__err("unsupported color space", "JPEG CMYK/YCCK");
+        return NULL;
+    }
+    int is_rgb = img_n == 3 && (z->rgb == 3 || (z->app14_color_transform == 0 && !z->jfif));
+    
+    unsigned int sx = z->s->img_x / scale, sy = z->s->img_y / scale;
+    if (sx < 1) sx = 1;
+    if (sy < 1) sy = 1;
+    
+    stbi__resample res_comp[3];
+    int rows[3];
+    for (int k = 0; k < img_n; k++) {
+        stbi__resample *r = &res_comp[k];
+        
+        // Liberado por stbi__cleanup_jpeg junto com os planos
+        z->img_comp[k].linebuf = (stbi_uc*)stbi__malloc(sx + 3);
+        if (!z->img_comp[k].linebuf) {
+            stbi__err("outofmem", "Out of memory");
+            return NULL;
+        }
+        
+        r->hs      = z->img_h_max / z->img_comp[k].h;
+        r->vs      = z->img_v_max / z->img_comp[k].v;
+        r->ystep   = r->vs >> 1;
+        r->w_lores = (sx + r->hs - 1) / r->hs;
+        r->ypos    = 0;
+        r->line0   = r->line1 = z->img_comp[k].data;
+        rows[k]    = (z->img_comp[k].y + scale - 1) / scale;
+        
+        if      (r->hs == 1 && r->vs == 1) r->resample = resample_row_1;
+        else if (r->hs == 1 && r->vs == 2) r->resample = stbi__resample_row_v_2;
+        else if (r->hs == 2 && r->vs == 1) r->resample = stbi__resample_row_h_2;
+        else if (r->hs == 2 && r->vs == 2) r->resample = z->resample_row_hv_2_kernel;
+        else                               r->resample = stbi__resample_row_generic;
+    }
+    
+    // +1: os kernels de cor do stb escrevem out[3] mesmo com passo 3
+    stbi_uc *output = (stbi_uc*)stbi__malloc_mad3(img_n, sx, sy, 1);
+    if (!output) {
+        stbi__err("outofmem", "Out of memory");
+        return NULL;
+    }
+    
+    for (unsigned int j = 0; j < sy; j++) {
+        stbi_uc *out = output + (size_t)img_n * sx * j;
+        stbi_uc *coutput[3];
+        for (int k = 0; k < img_n; k++) {
+            stbi__resample *r = &res_comp[k];
+            int y_bot = r->ystep >= (r->vs >> 1);
+            coutput[k] = r->resample(z->img_comp[k].linebuf,
+                                     y_bot ? r->line1 : r->line0,
+                                     y_bot ? r->line0 : r->line1,
+                                     r->w_lores, r->hs);
+            if (++r->ystep >= r->vs) {
+                r->ystep = 0;
+                r->line0 = r->line1;
+                if (++r->ypos < rows[k]) r->line1 += z->img_comp[k].w2;
+            }
+        }
+        
+        if (img_n == 1) {
+            memcpy(out, coutput[0], sx);
+        } else if (is_rgb) {
+            for (unsigned int i = 0; i < sx; i++) {
+                out[0] = coutput[0][i];
+                out[1] = coutput[1][i];
+                out[2] = coutput[2][i];
+                out += 3;
+            }
+        } else {
+            z->YCbCr_to_RGB_kernel(out, coutput[0], coutput[1], coutput[2], sx, 3);
+        }
+    }
+    
+    *out_x = sx;
+    *out_y = sy;
+    *comp = img_n;
+    return output;
+}
+
+// ============================================================
+// DECODIFICAÇÃO POR REGIÃO
+// ============================================================
+
+// Região pedida e, por componente, os blocos 8×8 que a afetam (limites
+// inclusivos). A margem de um bloco cobre os vizinhos lidos pela
+// interpolação de croma, então o resultado é idêntico ao da imagem cheia
+typedef struct {
+    int x0, y0, x1, y1;         // [x0, x1) × [y0, y1) em pixels da imagem
+    int bx0[4], bx1[4];
+    int by0[4], by1[4];
+} region_t;
+
+static __thread const region_t *active_region;
+static __thread void (*region_idct)(stbi_uc *out, int out_stride, short data[64]);
+
+static void region_blocks(const stbi__jpeg *z, region_t *r) {
+    for (int k = 0; k < z->s->img_n; k++) {
+        int h = z->img_comp[k].h, v = z->img_comp[k].v;
+        int last_x = z->img_comp[k].w2 / 8 - 1, last_y = z->img_comp[k].h2 / 8 - 1;
+        
+        r->bx0[k] = r->x0 * h / z->img_h_max / 8 - 1;
+        r->bx1[k] = (r->x1 - 1) * h / z->img_h_max / 8 + 1;
+        r->by0[k] = r->y0 * v / z->img_v_max / 8 - 1;
+        r->by1[k] = (r->y1 - 1) * v / z->img_v_max / 8 + 1;
+        if (r->bx0[k] < 0) r->bx0[k] = 0;
+        if (r->by0[k] < 0) r->by0[k] = 0;
+        if (r->bx1[k] > last_x) r->bx1[k] = last_x;
+        if (r->by1[k] > last_y) r->by1[k] = last_y;
+    }
+}
+
+// Substitui idct_block_kernel: blocos fora da região não passam pela IDCT
+static void idct_region_block(stbi_uc *out, int out_stride, short data[64]) {
+    const region_t *r = active_region;
+    int bx, by;
+    int k = locate_block(active_jpeg, out, out_stride, &bx, &by);
+    if (k < 0 || bx < r->bx0[k] || bx > r->bx1[k] || by < r->by0[k] || by > r->by1[k]) return;
+    region_idct(out, out_stride, data);
+}
+
+// Pula os dados entrópicos até o próximo marcador, sem decodificar.
+// Retorna 1 num RST (decodificador pronto para o intervalo seguinte) e 0
+// no fim da varredura (o marcador fica para stbi__get_marker)
+static int skip_to_restart(stbi__jpeg *z) {
+    while (z->marker == STBI__MARKER_none && !stbi__at_eof(z->s)) {
+        if (stbi__get8(z->s) != 0xff) continue;
+        int c;
+        do {
+            c = stbi__get8(z->s);
+        } while (c == 0xff && !stbi__at_eof(z->s));
+        if (c != 0x00 && c != 0xff) z->marker = (unsigned char)c;
+    }
+    if (!STBI__RESTART(z->marker)) return 0;
+    stbi__jpeg_reset(z);
+    return 1;
+}
+
+// Unidades de uma varredura baseline: MCUs (intercalada) ou blocos do
+// único componente, com o retângulo de unidades que a região usa
+typedef struct {
+    int units_x, units_y;
+    int ux0, ux1, uy0, uy1;
+} scan_units_t;
+
+static void scan_units(const stbi__jpeg *z, const region_t *r, scan_units_t *u) {
+    if (z->scan_n == 1) {
+        int n = z->order[0];
+        u->units_x = (z->img_comp[n].x + 7) >> 3;
+        u->units_y = (z->img_comp[n].y + 7) >> 3;
+        u->ux0 = r->bx0[n];
+        u->ux1 = r->bx1[n];
+        u->uy0 = r->by0[n];
+        u->uy1 = r->by1[n];
+        return;
+    }
+    
+    u->units_x = z->img_mcu_x;
+    u->units_y = z->img_mcu_y;
+    u->ux0 = u->uy0 = INT_MAX;
+    u->ux1 = u->uy1 = -1;
+    for (int k = 0; k < z->scan_n; k++) {
+        int n = z->order[k];
+        int h = z->img_comp[n].h, v = z->img_comp[n].v;
+        if (r->bx0[n] / h < u->ux0) u->ux0 = r->bx0[n] / h;
+        if (r->bx1[n] / h > u->ux1) u->ux1 = r->bx1[n] / h;
+        if (r->by0[n] / v < u->uy0) u->uy0 = r->by0[n] / v;
+        if (r->by1[n] / v > u->uy1) u->uy1 = r->by1[n] / v;
+    }
+}
+
+// Algum MCU de [first, first + count) cai no retângulo da região?
+static int units_needed(const scan_units_t *u, int first, int count) {
+    for (int m = first; m < first + count && m < u->units_x * u->units_y; m++) {
+        int j = m / u->units_x, i = m % u->units_x;
+        if (j >= u->uy0 && j <= u->uy1 && i >= u->ux0 && i <= u->ux1) return 1;
+    }
+    return 0;
+}
+
+// stbi__parse_entropy_coded_data (baseline) limitado à região: para
+// depois da última linha de unidades usada e, com intervalos de restart,
+// salta os intervalos que não tocam a região procurando o próximo RST.
+// Os demais são decodificados inteiros (o preditor DC depende deles), mas
+// a IDCT fica só nos blocos da região. Retorna 0 em erro, 1 ao fim da
+// varredura e 2 se parou antes (o resto não é necessário)
+static int parse_region_scan(stbi__jpeg *z, const region_t *r) {
+    STBI_SIMD_ALIGN(short, data[64]);
+    scan_units_t u;
+    scan_units(z, r, &u);
+    
+    stbi__jpeg_reset(z);
+    int total = u.units_x * u.units_y;
+    int interval = z->restart_interval;
+    
+    for (int m = 0; m < total; ) {
+        int j = m / u.units_x, i = m % u.units_x;
+        if (j > u.uy1) return 2;
+        
+        if (interval > 0 && z->todo == interval && !units_needed(&u, m, interval)) {
+            if (!skip_to_restart(z)) return 1;
+            m += interval;
+            continue;
+        }
+        
+        for (int k = 0; k < z->scan_n; k++) {
+            int n = z->order[k];
+            int bh = z->scan_n == 1 ? 1 : z->img_comp[n].h;
+            int bv = z->scan_n == 1 ? 1 : z->img_comp[n].v;
+            for (int y = 0; y < bv; y++) {
+                for (int x = 0; x < bh; x++) {
+                    int x2 = (i * bh + x) * 8;
+                    int y2 = (j * bv + y) * 8;
+                    int ha = z->img_comp[n].ha;
+                    if (!stbi__jpeg_decode_block(z, data, z->huff_dc + z->img_comp[n].hd,
+                                                 z->huff_ac + ha, z->fast_ac[ha], n,
+                                                 z->dequant[z->img_comp[n].tq])) return 0;
+                    z->idct_block_kernel(z->img_comp[n].data + z->img_comp[n].w2 * y2 + x2,
+                                         z->img_comp[n].w2, data);
+                }
+            }
+        }
+        m++;
+        
+        if (--z->todo <= 0) {
+            if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
+            if (!STBI__RESTART(z->marker)) return 1;
+            stbi__jpeg_reset(z);
+        }
+    }
+    return 1;
+}
+
+// stbi__decode_jpeg_image com as varreduras baseline de parse_region_scan.
+// Progressivo: todos os coeficientes são necessários para a última
+// passada, então só a IDCT (no fim) é limitada à região
+static int decode_region(stbi__jpeg *z, region_t *r) {
+    for (int m = 0; m < 4; m++) {
+        z->img_comp[m].raw_data = NULL;
+        z->img_comp[m].raw_coeff = NULL;
+    }
+    z->restart_interval = 0;
+    if (!stbi__decode_jpeg_header(z, STBI__SCAN_load)) return 0;
+    if (r->x1 > (int)z->s->img_x || r->y1 > (int)z->s->img_y) {
+        return stbi__err("bad region", "Region outside image");
+    }
+    region_blocks(z, r);
+    
+    int m = stbi__get_marker(z);
+    while (!stbi__EOI(m)) {
+        if (stbi__SOS(m)) {
+            if (!stbi__process_scan_header(z)) return 0;
+            if (z->progressive) {
+                if (!stbi__parse_entropy_coded_data(z)) return 0;
+            } else {
+                int res = parse_region_scan(z, r);
+                if (res == 0) return 0;
+                if (res == 2) {
+                    // Varredura com todos os componentes: nada mais a ler
+                    if (z->scan_n == z->s->img_n) return 1;
+                    while (skip_to_restart(z)) {
+                    }
+                }
+            }
+            if (z->marker == STBI__MARKER_none) z->marker = stbi__skip_jpeg_junk_at_end(z);
+            m = stbi__get_marker(z);
+            if (STBI__RESTART(m)) m = stbi__get_marker(z);
+        } else if (stbi__DNL(m)) {
+            int len = stbi__get16be(z->s);
+            stbi__uint32 lines = stbi__get16be(z->s);
+            if (len != 4) return stbi__err("bad DNL len", "Corrupt JPEG");
+            if (lines != z->s->img_y) return stbi__err("bad DNL height", "Corrupt JPEG");
+            m = stbi__get_marker(z);
+        } else {
+            if (!stbi__process_marker(z, m)) return 1;
+            m = stbi__get_marker(z);
+        }
+    }
+    if (z->progressive) stbi__jpeg_finish(z);
+    return 1;
+}
+
+// Reamostragem e cor só das linhas e colunas da região. A interpolação
+// de croma começa uma amostra antes e termina uma depois, para que as
+// bordas artificiais caiam fora da região
+static stbi_uc* convert_region(stbi__jpeg *z, const region_t *r, int *comp) {
+    int img_n = z->s->img_n;
+    if (img_n != 1 && img_n != 3) {
+        stbi__err("unsupported color space", "JPEG CMYK/YCCK");
+        return NULL;
+    }
+    int is_rgb = img_n == 3 && (z->rgb == 3 || (z->app14_color_transform == 0 && !z->jfif));
+    int width = r->x1 - r->x0, height = r->y1 - r->y0;
+    
+    stbi__resample res_comp[3];
+    int first[3];               // Primeira amostra de croma reamostrada
+    for (int k = 0; k < img_n; k++) {
+        stbi__resample *rs = &res_comp[k];
+        
+        z->img_comp[k].linebuf = (stbi_uc*)stbi__malloc(z->s->img_x + 3);
+        if (!z->img_comp[k].linebuf) {
+            stbi__err("outofmem", "Out of memory");
+            return NULL;
+        }
+        
+        rs->hs    = z->img_h_max / z->img_comp[k].h;
+        rs->vs    = z->img_v_max / z->img_comp[k].v;
+        rs->ystep = rs->vs >> 1;
+        rs->ypos  = 0;
+        rs->line0 = rs->line1 = z->img_comp[k].data;
+        
+        int lores = (z->s->img_x + rs->hs - 1) / rs->hs;
+        int last = (r->x1 - 1) / rs->hs + 2;
+        first[k] = r->x0 / rs->hs - 1;
+        if (first[k] < 0) first[k] = 0;
+        if (last > lores) last = lores;
+        rs->w_lores = last - first[k];
+        
+        if      (rs->hs == 1 && rs->vs == 1) rs->resample = resample_row_1;
+        else if (rs->hs == 1 && rs->vs == 2) rs->resample = stbi__resample_row_v_2;
+        else if (rs->hs == 2 && rs->vs == 1) rs->resample = stbi__resample_row_h_2;
+        else if (rs->hs == 2 && rs->vs == 2) rs->resample = z->resample_row_hv_2_kernel;
+        else                                 rs->resample = stbi__resample_row_generic;
+    }
+    
+    // +1: os kernels de cor do stb escrevem out[3] mesmo com passo 3
+    stbi_uc *output = (stbi_uc*)stbi__malloc_mad3(img_n, width, height, 1);
+    if (!output) {
+        stbi__err("outofmem", "Out of memory");
+        return NULL;
+    }
+    
+    // As linhas acima da região só avançam o estado da reamostragem
+    for (int j = 0; j < r->y1; j++) {
+        int emit = j >= r->y0;
+        stbi_uc *coutput[3];
+        for (int k = 0; k < img_n; k++) {
+            stbi__resample *rs = &res_comp[k];
+            if (emit) {
+                int y_bot = rs->ystep >= (rs->vs >> 1);
+                stbi_uc *row = rs->resample(z->img_comp[k].linebuf,
+                                            (y_bot ? rs->line1 : rs->line0) + first[k],
+                                            (y_bot ? rs->line0 : rs->line1) + first[k],
+                                            rs->w_lores, rs->hs);
+                coutput[k] = row + (r->x0 - first[k] * rs->hs);
+            }
+            if (++rs->ystep >= rs->vs) {
+                rs->ystep = 0;
+                rs->line0 = rs->line1;
+                if (++rs->ypos < z->img_comp[k].y) rs->line1 += z->img_comp[k].w2;
+            }
+        }
+        if (!emit) continue;
+        
+        stbi_uc *out = output + (size_t)img_n * width * (j - r->y0);
+        if (img_n == 1) {
+            memcpy(out, coutput[0], width);
+        } else if (is_rgb) {
+            for (int i = 0; i < width; i++) {
+                out[0] = coutput[0][i];
+                out[1] = coutput[1][i];
+                out[2] = coutput[2][i];
+                out += 3;
+            }
+        } else {
+            z->YCbCr_to_RGB_kernel(out, coutput[0], coutput[1], coutput[2], width, 3);
+        }
+    }
+    
+    *comp = img_n;
+    return output;
+}
+
+// ============================================================
+// API
+// ============================================================
+
+static stbi_uc* load_scaled(stbi__context *s, int scale, int *width, int *height, int *channels) {
+    if (scale != 2 && scale != 4 && scale != 8) return NULL;
+    if (!stbi__jpeg_test(s)) return NULL;
+    
+    stbi__jpeg *z = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+    if (!z) return NULL;
+    memset(z, 0, sizeof(stbi__jpeg));
+    z->s = s;
+    stbi__setup_jpeg(z);
+    z->idct_block_kernel = idct_scaled_block;
+    z->s->img_n = 0;    // stbi__cleanup_jpeg seguro se o cabeçalho falhar
+    
+    active_jpeg = z;
+    scaled_block = 8 / scale;
+    
+    stbi_uc *output = NULL;
+    if (stbi__decode_jpeg_image(z)) {
+        output = convert_scaled(z, scale, width, height, channels);
+    }
+    
+    stbi__cleanup_jpeg(z);
+    active_jpeg = NULL;
+    STBI_FREE(z);
+    return output;
+}
+
+unsigned char* jpeg_load_scaled(const char *filename, int scale,
+                                int *width, int *height, int *channels) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return NULL;
+    
+    stbi__context s;
+    stbi__start_file(&s, f);
+    unsigned char *data = load_scaled(&s, scale, width, height, channels);
+    fclose(f);
+    return data;
+}
+
+unsigned char* jpeg_load_scaled_from_memory(const unsigned char *buffer, size_t len, int scale,
+                                            int *width, int *height, int *channels) {
+    if (len > INT_MAX) return NULL;
+    
+    stbi__context s;
+    stbi__start_mem(&s, buffer, (int)len);
+    return load_scaled(&s, scale, width, height, channels);
+}
+
+static stbi_uc* load_region(stbi__context *s, int x, int y, int width, int height, int *channels) {
+    if (x < 0 || y < 0 || width < 1 || height < 1) return NULL;
+    if (!stbi__jpeg_test(s)) return NULL;
+    
+    stbi__jpeg *z = (stbi__jpeg*)stbi__malloc(sizeof(stbi__jpeg));
+    if (!z) return NULL;
+    memset(z, 0, sizeof(stbi__jpeg));
+    z->s = s;
+    stbi__setup_jpeg(z);
+    region_idct = z->idct_block_kernel;
+    z->idct_block_kernel = idct_region_block;
+    z->s->img_n = 0;
+    
+    region_t region = { .x0 = x, .y0 = y, .x1 = x + width, .y1 = y + height };
+    active_jpeg = z;
+    active_region = &region;
+    
+    stbi_uc *output = NULL;
+    if (decode_region(z, &region)) {
+        output = convert_region(z, &region, channels);
+    }
+    
+    stbi__cleanup_jpeg(z);
+    active_jpeg = NULL;
+    active_region = NULL;
+    STBI_FREE(z);
+    return output;
+}
+
+unsigned char* jpeg_load_region(const char *filename, int x, int y, int width, int height,
+                                int *channels) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return NULL;
+    
+    stbi__context s;
+    stbi__start_file(&s, f);
+    unsigned char *data = load_region(&s, x, y, width, height, channels);
+    fclose(f);
+    return data;
+}
+
+unsigned char* jpeg_load_region_from_memory(const unsigned char *buffer, size_t len,
+                                            int x, int y, int width, int height, int *channels) {
+    if (len > INT_MAX) return NULL;
+    
+    stbi__context s;
+    stbi__start_mem(&s, buffer, (int)len);
+    return load_region(&s, x, y, width, height, channels);
+}
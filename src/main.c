@@ -2,16 +2,41 @@
 #include "ipc_manager.h"
 #include "sync_manager.h"
 #include "worker.h"
+#include "ingest.h"
+#include "config.h"
+#include "daemon.h"
+#include "server.h"
+#include "filters.h"
+#include "histogram.h"
+#include "trace.h"
+#include "perf_counters.h"
+#include "event_log.h"
+#include "metrics.h"
+#include "image_encode.h"
+#include <poll.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <math.h>
 
-// Lista de imagens encontradas
-static char image_files[MAX_IMAGES][MAX_FILENAME];
+// Tarefas despachadas (o total só é conhecido ao fim da varredura)
 static int num_images = 0;
 
+// Serializa o despacho quando há várias threads de varredura
+static pthread_mutex_t dispatch_lock = PTHREAD_MUTEX_INITIALIZER;
+
 // PIDs dos workers
-static pid_t worker_pids[NUM_WORKERS];
+static pid_t worker_pids[MAX_WORKERS];
+
+// Leitor dos anéis de log dos workers
+static volatile int log_stop = 0;
+
+// Canal de eventos de conclusão das tarefas da API
+static int done_sock[2] = {-1, -1};
 
-// Pipe para receber logs dos workers
-static int log_pipe[2];
+// Progresso: eventfd notificado pelos workers e pidfds para detectar
+// um worker que saia sem avisar (-1 = sem pidfd, -2 = já saiu)
+static int progress_fd = -1;
+static int worker_pidfds[MAX_WORKERS];
 
 // Recursos IPC globais para cleanup
 static mqd_t g_mq = (mqd_t)-1;
@@ -25,7 +50,7 @@ void signal_handler(int sig) {
     printf("\n[COORDENADOR] Interrompido. Limpando recursos...\n");
     
     // Envia sinal de término para workers
-    for (int i = 0; i < NUM_WORKERS; i++) {
+    for (int i = 0; i < g_config.num_workers; i++) {
         if (worker_pids[i] > 0) {
             kill(worker_pids[i], SIGTERM);
         }
@@ -38,35 +63,134 @@ void signal_handler(int sig) {
     exit(1);
 }
 
-// Lê lista de imagens do diretório
-int scan_images_directory(void) {
-    DIR *dir = opendir(INPUT_DIR);
-    if (!dir) {
-        LOG_ERROR("Não foi possível abrir diretório: %s", INPUT_DIR);
-        return -1;
+// pidfd do worker (Linux >= 5.3); -1 se indisponível
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    return -1;
+#endif
+}
+
+// Worker terminou sem ser recolhido (WNOWAIT mantém o status para o waitpid)
+static int worker_exited(int i) {
+    siginfo_t info = { .si_pid = 0 };
+    return waitid(P_PID, worker_pids[i], &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+           info.si_pid == worker_pids[i];
+}
+
+// Aguarda (futex) até count workers estarem prontos para consumir a
+// fila. Falha se os que faltam saírem antes disso
+static int wait_workers_ready(unsigned int count) {
+    while (1) {
+        unsigned int ready = __atomic_load_n(&g_stats->workers_ready, __ATOMIC_ACQUIRE);
+        if (ready >= count) return 0;
+        
+        unsigned int alive = 0;
+        for (int i = 0; i < g_config.num_workers; i++) {
+            if (!worker_exited(i)) alive++;
+        }
+        if (ready + alive < count) return -1;
+        
+        // O timeout só serve para notar um worker que morreu na partida
+        futex_wait(&g_stats->workers_ready, ready, 1000);
+    }
+}
+
+// Tempo (ms) desde a criação dos workers até o primeiro/último ficar pronto
+static void workers_ready_times(const shared_stats_t *stats, double *first_ms, double *last_ms) {
+    uint64_t first = 0, last = 0;
+    for (int i = 0; i < g_config.num_workers; i++) {
+        uint64_t t = __atomic_load_n(&stats->workers[i].ready_ns, __ATOMIC_RELAXED);
+        if (t == 0) continue;
+        if (first == 0 || t < first) first = t;
+        if (t > last) last = t;
+    }
+    *first_ms = first ? (first - stats->spawn_ns) / 1e6 : 0;
+    *last_ms = last ? (last - stats->spawn_ns) / 1e6 : 0;
+}
+
+// Bloqueia até um worker concluir uma imagem ou sair. Sem CPU enquanto
+// ocioso; só sem pidfd há um timeout, para notar um worker que morreu
+static void wait_for_progress(void) {
+    struct pollfd fds[MAX_WORKERS + 1];
+    int owner[MAX_WORKERS + 1];
+    int n = 0, need_timeout = 0;
+    
+    fds[n] = (struct pollfd){ .fd = progress_fd, .events = POLLIN };
+    owner[n++] = -1;
+    for (int i = 0; i < g_config.num_workers; i++) {
+        if (worker_pidfds[i] >= 0) {
+            fds[n] = (struct pollfd){ .fd = worker_pidfds[i], .events = POLLIN };
+            owner[n++] = i;
+        } else if (worker_pidfds[i] == -1) {
+            need_timeout = 1;
+        }
     }
     
-    struct dirent *entry;
-    num_images = 0;
+    int ready = poll(fds, n, need_timeout ? 1000 : -1);
+    if (ready <= 0) {
+        if (ready == -1 && errno != EINTR) perror("poll (progresso)");
+        for (int i = 0; i < g_config.num_workers; i++) {
+            if (worker_pidfds[i] == -1 && worker_exited(i)) worker_pidfds[i] = -2;
+        }
+        return;
+    }
     
-    while ((entry = readdir(dir)) != NULL && num_images < MAX_IMAGES) {
-        // Ignora . e ..
-        if (entry->d_name[0] == '.') continue;
-        
-        // Verifica extensão
-        const char *ext = strrchr(entry->d_name, '.');
-        if (!ext) continue;
-        
-        if (strcasecmp(ext, ".jpg") == 0 || strcasecmp(ext, ".jpeg") == 0 ||
-            strcasecmp(ext, ".png") == 0 || strcasecmp(ext, ".bmp") == 0) {
-            strncpy(image_files[num_images], entry->d_name, MAX_FILENAME - 1);
-            image_files[num_images][MAX_FILENAME - 1] = '\0';
-            num_images++;
+    for (int k = 0; k < n; k++) {
+        if (!fds[k].revents) continue;
+        if (owner[k] < 0) {
+            // Zera o contador; o estado real vem da memória compartilhada
+            uint64_t count;
+            if (read(progress_fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+                perror("read (progresso)");
+            }
+        } else {
+            close(worker_pidfds[owner[k]]);
+            worker_pidfds[owner[k]] = -2;
         }
     }
+}
+
+// Callback da varredura: envia a tarefa assim que a imagem é encontrada
+static int dispatch_task(const char *name, void *user) {
+    (void)user;
+    
+    // mq_send bloqueia com a fila cheia: a varredura acompanha os workers.
+    // O id vem do mesmo contador da API de tarefas (-s): trace e registros
+    // de log nunca misturam imagens das duas origens
+    pthread_mutex_lock(&dispatch_lock);
+    int task_id = stats_next_task_id(g_stats);
+    trace_buffer_t *trace = trace_coordinator_buffer();
+    uint64_t dispatch_ns = trace ? monotonic_ns() : 0;
+    if (send_task(g_mq, name, task_id, g_config.filter_mask) != 0) {
+        pthread_mutex_unlock(&dispatch_lock);
+        LOG_ERROR("Falha ao enviar tarefa: %s", name);
+        return 0;
+    }
+    if (trace) {
+        trace_record(trace, TRACE_DISPATCH, 0, task_id, dispatch_ns, monotonic_ns());
+    }
+    num_images++;
+    stats_count_task(g_stats);
+    pthread_mutex_unlock(&dispatch_lock);
     
-    closedir(dir);
-    return num_images;
+    return 0;
+}
+
+// Escolhe a forma de ingestão conforme as opções
+static long run_ingestion(void) {
+    if (g_config.list_file) {
+        LOG_COORD("Lendo lista de arquivos: %s",
+                  strcmp(g_config.list_file, "-") == 0 ? "stdin" : g_config.list_file);
+        return ingest_file_list(g_config.list_file, g_config.list_delim, dispatch_task, NULL);
+    }
+    if (g_config.recursive) {
+        LOG_COORD("Varredura recursiva de %s/ com %d threads", INPUT_DIR, g_config.num_walkers);
+        return ingest_tree_parallel(INPUT_DIR, g_config.num_walkers, dispatch_task, NULL);
+    }
+    return ingest_directory_stream(INPUT_DIR, dispatch_task, NULL);
 }
 
 // Imprime barra de progresso
@@ -92,44 +216,285 @@ void print_header(void) {
     printf("════════════════════════════════════════════════════════════\n");
 }
 
-// Imprime estatísticas finais
-void print_statistics(shared_stats_t *stats) {
+// Uma linha da tabela de latências: p50/p90/p99/máx em ms
+static void print_latency_row(const char *label, const latency_hist_t *h) {
+    if (h->count == 0) return;
+    print_label(label, 24);
+    printf(" %8.2f %8.2f %8.2f %8.2f\n",
+           hist_percentile(h, 50) / 1000.0, hist_percentile(h, 90) / 1000.0,
+           hist_percentile(h, 99) / 1000.0, h->max_us / 1000.0);
+}
+
+// Soma os histogramas de todos os workers e imprime por etapa
+static void print_latency_report(shared_stats_t *stats) {
+    static worker_latency_t merged;
+    stats_merge_latency(stats, &merged);
+    if (merged.decode.count == 0) return;
+    
+    print_label("Latência (ms)", 24);
+    printf("      p50      p90      p99      máx\n");
+    print_latency_row("decodificação", &merged.decode);
+    for (int f = 0; f < NUM_THREADS; f++) {
+        char label[64];
+        snprintf(label, sizeof(label), "%s: filtro", get_filter_name(f));
+        print_latency_row(label, &merged.filter[f]);
+        snprintf(label, sizeof(label), "%s: codificação", get_filter_name(f));
+        print_latency_row(label, &merged.encode[f]);
+        snprintf(label, sizeof(label), "%s: gravação", get_filter_name(f));
+        print_latency_row(label, &merged.write[f]);
+    }
+    print_latency_row("total por imagem", &merged.total);
+    printf("════════════════════════════════════════════════════════════\n");
+}
+
+// Valor por pixel, ou n/d se o contador não existe nesta máquina
+static void print_per_pixel(const perf_totals_t *t, int counter, int width, int decimals) {
+    if (t->missing & (1u << counter)) {
+        printf(" %*s", width, "n/d");
+    } else {
+        printf(" %*.*f", width, decimals, (double)t->values[counter] / t->pixels);
+    }
+}
+
+// Contadores de hardware (-p) somados por filtro
+static void print_perf_report(shared_stats_t *stats) {
+    if (!g_config.perf) return;
+    
+    perf_totals_t merged[NUM_THREADS];
+    memset(merged, 0, sizeof(merged));
+    for (int w = 0; w < stats->num_workers; w++) {
+        for (int f = 0; f < NUM_THREADS; f++) {
+            const perf_totals_t *t = &stats->perf[w][f];
+            merged[f].samples += t->samples;
+            merged[f].pixels += t->pixels;
+            merged[f].missing |= t->missing;
+            for (int c = 0; c < PERF_NUM_COUNTERS; c++) {
+                merged[f].values[c] += t->values[c];
+            }
+        }
+    }
+    
+    print_label("Por pixel de entrada", 24);
+    printf("   ciclos    instr    IPC  LLC miss  desvios\n");
+    for (int f = 0; f < NUM_THREADS; f++) {
+        const perf_totals_t *t = &merged[f];
+        if (t->samples == 0 || t->pixels == 0) continue;
+        
+        print_label(get_filter_name(f), 24);
+        print_per_pixel(t, PERF_CYCLES, 8, 2);
+        print_per_pixel(t, PERF_INSTRUCTIONS, 8, 2);
+        if (t->missing & (1u << PERF_INSTRUCTIONS) || t->values[PERF_CYCLES] == 0) {
+            printf(" %6s", "n/d");
+        } else {
+            printf(" %6.2f", (double)t->values[PERF_INSTRUCTIONS] / t->values[PERF_CYCLES]);
+        }
+        print_per_pixel(t, PERF_LLC_MISSES, 9, 4);
+        print_per_pixel(t, PERF_BRANCH_MISSES, 8, 4);
+        printf("\n");
+    }
+    printf("════════════════════════════════════════════════════════════\n");
+}
+
+static double timeval_s(struct timeval tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// CPU e memória de pico (getrusage; os workers já foram coletados por waitpid)
+static void print_cpu_usage(const shared_stats_t *stats) {
+    struct rusage self, children;
+    if (getrusage(RUSAGE_SELF, &self) == -1 || getrusage(RUSAGE_CHILDREN, &children) == -1) {
+        perror("getrusage");
+        return;
+    }
+    
+    double workers_cpu = timeval_s(children.ru_utime) + timeval_s(children.ru_stime);
+    double coord_cpu = timeval_s(self.ru_utime) + timeval_s(self.ru_stime);
+    printf("  Workers:               %d\n", stats->num_workers);
+    printf("  CPU dos workers:       %.2fs (usuário %.2fs, sistema %.2fs)\n", workers_cpu,
+           timeval_s(children.ru_utime), timeval_s(children.ru_stime));
+    printf("  CPU do coordenador:    %.2fs\n", coord_cpu);
+    if (stats->total_processing_time > 0) {
+        printf("  Núcleos ocupados:      %.2f\n",
+               (workers_cpu + coord_cpu) / stats->total_processing_time);
+    }
+    printf("  RSS máximo:            %ld KB (maior worker), %ld KB (coordenador)\n",
+           children.ru_maxrss, self.ru_maxrss);
+}
+
+static double mb(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+// Memória por worker: maior reserva estimada, RSS real e esperas (-M)
+static void print_memory_report(const shared_stats_t *stats) {
+    uint64_t deferred = 0, wait_us = 0;
+    print_label("Memória (MB)", 24);
+    printf("   reserva  RSS fim  RSS pico  adiadas\n");
+    for (int w = 0; w < stats->num_workers; w++) {
+        const worker_stats_t *ws = &stats->workers[w];
+        char label[32];
+        snprintf(label, sizeof(label), "worker %d", w);
+        print_label(label, 24);
+        printf(" %9.1f %8.1f %9.1f %8llu\n", mb(ws->mem_reserved_peak), mb(ws->rss_bytes),
+               mb(ws->rss_peak_bytes), (unsigned long long)ws->mem_deferred);
+        deferred += ws->mem_deferred;
+        wait_us += ws->mem_wait_us;
+    }
+    printf("  Pico reservado:        %.1f MB", mb(stats->mem_reserved_peak));
+    if (stats->mem_budget > 0) {
+        printf(" de %.1f MB; %llu tarefa(s) adiada(s), %.2fs de espera",
+               mb(stats->mem_budget), (unsigned long long)deferred, wait_us / 1e6);
+    }
+    printf("\n════════════════════════════════════════════════════════════\n");
+}
+
+// Codificação por perfil (-Q / profile=): custo e tamanho por pixel de saída
+static void print_encode_report(const shared_stats_t *stats) {
+    encode_totals_t merged[ENCODE_STAT_SLOTS * NUM_THREADS];
+    int count = stats_collect_encode(stats, merged, ENCODE_STAT_SLOTS * NUM_THREADS);
+    if (count == 0) return;
+    
+    print_label("Codificação", 24);
+    printf("   saídas  ns/pixel  bytes/pixel\n");
+    for (int i = 0; i < count; i++) {
+        const encode_totals_t *t = &merged[i];
+        if (t->pixels == 0) continue;
+        
+        char label[64];
+        describe_encode_key(t->key, label, sizeof(label));
+        print_label(label, 24);
+        printf(" %8llu %9.2f %12.3f\n", (unsigned long long)t->outputs,
+               (double)t->ns / t->pixels, (double)t->bytes / t->pixels);
+    }
+    printf("════════════════════════════════════════════════════════════\n");
+}
+
+// Imagens reprovadas pela verificação (-V) em todos os workers
+static uint64_t verify_failures(const shared_stats_t *stats) {
+    uint64_t failed = 0;
+    for (int w = 0; w < stats->num_workers; w++) {
+        for (int f = 0; f < NUM_THREADS; f++) {
+            failed += stats->verify[w][f].failed;
+        }
+    }
+    return failed;
+}
+
+// Verificação (-V) somada por filtro: erro máximo, médio e PSNR
+static void print_verify_report(shared_stats_t *stats) {
+    if (!g_config.verify) return;
+    
+    verify_totals_t merged[NUM_THREADS];
+    memset(merged, 0, sizeof(merged));
+    for (int w = 0; w < stats->num_workers; w++) {
+        for (int f = 0; f < NUM_THREADS; f++) {
+            const verify_totals_t *v = &stats->verify[w][f];
+            merged[f].frames += v->frames;
+            merged[f].failed += v->failed;
+            merged[f].values += v->values;
+            merged[f].sum_abs += v->sum_abs;
+            merged[f].sum_sq += v->sum_sq;
+            if (v->max_abs > merged[f].max_abs) merged[f].max_abs = v->max_abs;
+        }
+    }
+    
+    print_label("Verificação", 24);
+    printf(" imagens  máx   média     PSNR  falhas\n");
+    for (int f = 0; f < NUM_THREADS; f++) {
+        const verify_totals_t *v = &merged[f];
+        if (v->frames == 0) continue;
+        
+        print_label(get_filter_name(f), 24);
+        double mse = (double)v->sum_sq / v->values;
+        printf(" %7llu %4d %7.4f", (unsigned long long)v->frames, v->max_abs,
+               (double)v->sum_abs / v->values);
+        if (mse == 0) printf(" %8s", "inf");
+        else printf(" %5.2f dB", 10.0 * log10(255.0 * 255.0 / mse));
+        printf(" %7llu\n", (unsigned long long)v->failed);
+    }
+    uint64_t failed = verify_failures(stats);
+    if (failed > 0) {
+        printf("  VERIFICAÇÃO FALHOU: %llu imagem(ns) acima da tolerância (%d)\n",
+               (unsigned long long)failed, g_config.verify_tolerance);
+    }
+    printf("════════════════════════════════════════════════════════════\n");
+}
+
+// Imprime estatísticas finais (workers_failed: saíram com erro, ex. pacote
+// não fechado)
+void print_statistics(shared_stats_t *stats, int workers_failed) {
+    stats_totals_t totals;
+    stats_collect(stats, &totals);
+    
     printf("\n\n");
     printf("════════════════════════════════════════════════════════════\n");
     printf("                    ESTATÍSTICAS FINAIS\n");
     printf("════════════════════════════════════════════════════════════\n");
     printf("  Total de imagens:      %d\n", stats->total_images);
-    printf("  Processadas:           %d\n", stats->processed_images);
-    printf("  Falhas:                %d\n", stats->failed_images);
+    printf("  Processadas:           %d\n", totals.processed_images);
+    printf("  Falhas:                %d\n", totals.failed_images);
     printf("  Tempo total:           %.2fs\n", stats->total_processing_time);
-    if (stats->processed_images > 0) {
+    print_cpu_usage(stats);
+    double first_ready_ms, last_ready_ms;
+    workers_ready_times(stats, &first_ready_ms, &last_ready_ms);
+    printf("  Workers prontos em:    %.2f ms (primeiro), %.2f ms (todos)\n",
+           first_ready_ms, last_ready_ms);
+    if (totals.processed_images > 0) {
         printf("  Tempo médio/imagem:    %.2fs\n", 
-               stats->total_processing_time / stats->processed_images);
+               stats->total_processing_time / totals.processed_images);
+    }
+    if (totals.scaled_decodes > 0) {
+        printf("  Decodificação reduzida: %llu JPEG(s) em 1/2 (só resize)\n",
+               (unsigned long long)totals.scaled_decodes);
+    }
+    if (totals.region_decodes > 0) {
+        printf("  Decodificação parcial: %llu JPEG(s) só na região (só crop)\n",
+               (unsigned long long)totals.region_decodes);
     }
     printf("════════════════════════════════════════════════════════════\n");
-    printf("  Resultados salvos em: %s/\n", OUTPUT_DIR);
+    print_latency_report(stats);
+    print_memory_report(stats);
+    print_encode_report(stats);
+    print_perf_report(stats);
+    print_verify_report(stats);
+    if (g_config.pack_prefix && workers_failed) {
+        printf("  Pacotes incompletos:   %d (%s-*.pack; imagens contadas como falhas)\n",
+               workers_failed, g_config.pack_prefix);
+    } else if (g_config.pack_prefix) {
+        printf("  Resultados empacotados em: %s-*.pack (image_unpack extrai)\n", g_config.pack_prefix);
+    } else {
+        printf("  Resultados salvos em: %s/\n", OUTPUT_DIR);
+    }
     printf("════════════════════════════════════════════════════════════\n\n");
 }
 
-// Thread para ler logs do pipe
+// Thread que esvazia os anéis de log dos workers e formata o texto.
+// Dorme no futex do canal quando não há registros; o timeout só cobre
+// contagem de descartes, que não acorda o leitor
 void* log_reader_thread(void *arg) {
     (void)arg;
-    char buffer[512];
-    ssize_t n;
+    log_channel_t *ch = &g_stats->log;
     
-    while ((n = read(log_pipe[0], buffer, sizeof(buffer) - 1)) > 0) {
-        buffer[n] = '\0';
-        // Logs já vêm formatados dos workers
-        // (não imprimimos aqui para não poluir a saída)
+    while (!log_stop) {
+        if (log_drain(ch, g_config.verbosity) == 0) {
+            log_wait(ch, 1000);
+        }
     }
     
+    // Registros publicados antes do encerramento
+    log_drain(ch, g_config.verbosity);
     return NULL;
 }
 
-int main(void) {
+int main(int argc, char *argv[]) {
     struct timespec start_time, end_time;
     clock_gettime(CLOCK_MONOTONIC, &start_time);
     
+    int parsed = parse_args(argc, argv, &g_config);
+    if (parsed != 0) {
+        return parsed > 0 ? 0 : 1;
+    }
+    
     print_header();
     
     // Configura handler de sinais
@@ -159,67 +524,80 @@ int main(void) {
         cleanup_ipc_coordinator(g_mq, NULL, -1);
         return 1;
     }
-    
-    // Inicializa mutex e cond na memória compartilhada
-    if (init_shared_mutex(&g_stats->mutex, &g_stats->mutex_attr) != 0) {
-        LOG_ERROR("Falha ao inicializar mutex");
-        cleanup_ipc_coordinator(g_mq, g_stats, g_shm_fd);
-        return 1;
-    }
-    
-    if (init_shared_cond(&g_stats->cond_finished, &g_stats->cond_attr) != 0) {
-        LOG_ERROR("Falha ao inicializar variável de condição");
-        cleanup_ipc_coordinator(g_mq, g_stats, g_shm_fd);
-        return 1;
+    g_stats->num_workers = g_config.num_workers;
+    g_stats->mem_budget = g_config.mem_budget;
+    if (g_config.mem_budget > 0) {
+        LOG_SETUP("Orçamento de memória dos workers: %.1f MB",
+                  g_config.mem_budget / (1024.0 * 1024.0));
     }
     
     // Cria semáforo para controle de I/O
-    LOG_SETUP("Criando semáforo de I/O (limite: %d)", NUM_WORKERS);
-    g_io_sem = create_semaphore(SEM_IO_NAME, NUM_WORKERS);
+    LOG_SETUP("Criando semáforo de I/O (limite: %d)", g_config.num_workers);
+    g_io_sem = create_semaphore(SEM_IO_NAME, g_config.num_workers);
     if (!g_io_sem) {
         LOG_ERROR("Falha ao criar semáforo");
         cleanup_ipc_coordinator(g_mq, g_stats, g_shm_fd);
         return 1;
     }
     
-    // Cria pipe para logs
-    if (create_pipe(log_pipe) != 0) {
-        LOG_ERROR("Falha ao criar pipe");
+    // Cria canal de conclusão (usado pela API de tarefas)
+    if (create_done_channel(done_sock) != 0) {
+        LOG_ERROR("Falha ao criar canal de conclusão");
         cleanup_sync(g_io_sem);
         cleanup_ipc_coordinator(g_mq, g_stats, g_shm_fd);
         return 1;
     }
     
-    // ============================================================
-    // BUSCA DE IMAGENS
-    // ============================================================
+    // Canal de progresso (eventfd) herdado pelos workers
+    progress_fd = create_progress_channel();
+    if (progress_fd == -1) {
+        LOG_ERROR("Falha ao criar canal de progresso");
+        cleanup_sync(g_io_sem);
+        cleanup_ipc_coordinator(g_mq, g_stats, g_shm_fd);
+        return 1;
+    }
     
-    int found = scan_images_directory();
-    if (found <= 0) {
-        LOG_ERROR("Nenhuma imagem encontrada em %s/", INPUT_DIR);
-        LOG_ERROR("Coloque imagens JPG ou PNG na pasta %s/", INPUT_DIR);
+    // Linha do tempo (-t): região anônima herdada pelos workers no fork
+    if (g_config.trace_file && trace_init(g_config.trace_events, g_config.num_workers) != 0) {
+        LOG_ERROR("Falha ao criar buffers de trace");
         cleanup_sync(g_io_sem);
         cleanup_ipc_coordinator(g_mq, g_stats, g_shm_fd);
         return 1;
     }
     
-    LOG_SETUP("Encontradas %d imagens em %s/", num_images, INPUT_DIR);
+    // Contadores de hardware (-p): sem PMU ou sem permissão, segue sem eles
+    if (g_config.perf) {
+        int err = perf_probe();
+        if (err != 0) {
+            LOG_ERROR("Contadores de hardware indisponíveis (%s): -p ignorado", perf_strerror(err));
+            g_config.perf = 0;
+        }
+    }
     
-    // Inicializa estatísticas
-    g_stats->total_images = num_images;
-    g_stats->processed_images = 0;
-    g_stats->failed_images = 0;
-    g_stats->total_processing_time = 0;
-    g_stats->workers_active = 0;
-    g_stats->workers_done = 0;
+    // Kernels dos filtros (-K): escolhidos aqui e herdados no fork
+    select_filter_kernels(g_config.kernel_set);
+    set_encode_threads(g_config.encode_threads);
+    if (g_config.encode_threads > 1) {
+        LOG_SETUP("Codificação JPEG em até %d faixas paralelas por saída", g_config.encode_threads);
+    }
+    if (g_config.verify) {
+        LOG_SETUP("Verificação: kernels %s comparados com %s (tolerância: %d)",
+                  get_filter_kernels(g_config.kernel_set)->name,
+                  get_filter_kernels(g_config.kernel_set == KERNELS_FAST ?
+                                     KERNELS_REFERENCE : KERNELS_FAST)->name,
+                  g_config.verify_tolerance);
+    }
+    
+    // Estatísticas começam zeradas (create_shared_memory)
     
     // ============================================================
     // CRIAÇÃO DOS WORKERS (FORK)
     // ============================================================
     
-    LOG_COORD("Iniciando %d workers...", NUM_WORKERS);
+    LOG_COORD("Iniciando %d workers...", g_config.num_workers);
+    g_stats->spawn_ns = monotonic_ns();
     
-    for (int i = 0; i < NUM_WORKERS; i++) {
+    for (int i = 0; i < g_config.num_workers; i++) {
         pid_t pid = fork();
         
         if (pid == -1) {
@@ -236,37 +614,77 @@ int main(void) {
         
         if (pid == 0) {
             // Processo filho (worker)
-            close(log_pipe[0]);  // Fecha leitura
-            worker_main(i, log_pipe[1]);
+            close(done_sock[0]);
+            worker_main(i, done_sock[1], progress_fd);
             // worker_main chama exit()
         }
         
         // Processo pai
         worker_pids[i] = pid;
+        worker_pidfds[i] = open_pidfd(pid);
     }
     
-    // Fecha escrita do pipe no pai
-    close(log_pipe[1]);
+    close(done_sock[1]);
+    
+    // Modo serviço: sinais de término vão para o laço de eventos
+    // (bloqueados antes de criar qualquer thread do coordenador)
+    if (g_config.daemon) {
+        if (daemon_block_signals() != 0 || daemon_init() != 0 ||
+            (g_config.socket_path &&
+             server_init(daemon_epoll_fd(), g_config.socket_path, g_stats, done_sock[0],
+                         progress_fd) != 0)) {
+            LOG_ERROR("Falha ao iniciar modo serviço");
+            g_config.daemon = 0;
+            signal_handler(SIGTERM);
+        }
+    }
     
-    // Cria thread para ler logs (não bloqueia)
+    // Thread que formata os logs dos workers (eles nunca esperam por ela)
     pthread_t log_thread;
     pthread_create(&log_thread, NULL, log_reader_thread, NULL);
     
+    // Exportador de métricas (-e): só lê a memória compartilhada
+    if (g_config.metrics_file &&
+        metrics_start(g_config.metrics_file, g_config.metrics_interval_ms, g_stats, g_mq) == 0) {
+        LOG_SETUP("Métricas em %s (a cada %d ms)", g_config.metrics_file,
+                  g_config.metrics_interval_ms);
+    }
+    
     // ============================================================
-    // PRODUTOR: ENVIA TAREFAS PARA FILA
+    // PRODUTOR: VARREDURA EM STREAMING E ENVIO DE TAREFAS
     // ============================================================
     
-    // Pequena pausa para workers iniciarem
-    usleep(100000);
-    
-    for (int i = 0; i < num_images; i++) {
-        if (send_task(g_mq, image_files[i], i) != 0) {
-            LOG_ERROR("Falha ao enviar tarefa: %s", image_files[i]);
+    // O despacho começa assim que a fila tem um consumidor
+    if (wait_workers_ready(1) != 0) {
+        LOG_ERROR("Nenhum worker ficou pronto");
+        signal_handler(SIGTERM);
+    }
+    double first_ready_ms, last_ready_ms;
+    workers_ready_times(g_stats, &first_ready_ms, &last_ready_ms);
+    LOG_COORD("Primeiro worker pronto em %.2f ms", first_ready_ms);
+    
+    // Tarefas são enviadas à medida que cada lote do diretório é lido
+    long found = run_ingestion();
+    if (g_config.daemon) {
+        LOG_SETUP("Varredura inicial: %d imagens em %s/", num_images, INPUT_DIR);
+        
+        // Workers permanecem ativos; novas imagens são despachadas na hora
+        if (daemon_run(dispatch_task, NULL) != 0) {
+            LOG_ERROR("Modo serviço encerrado com erro");
         }
+        if (g_config.socket_path) {
+            server_drain();
+        }
+        daemon_shutdown();
+    } else if (found <= 0) {
+        LOG_ERROR("Nenhuma imagem encontrada em %s/", INPUT_DIR);
+        LOG_ERROR("Coloque imagens JPG ou PNG na pasta %s/", INPUT_DIR);
+    } else {
+        LOG_SETUP("Encontradas %d imagens em %s/", num_images, INPUT_DIR);
     }
     
     // Envia sinais de término para cada worker
-    for (int i = 0; i < NUM_WORKERS; i++) {
+    for (int i = 0; i < g_config.num_workers; i++) {
         send_terminate(g_mq);
     }
     
@@ -274,27 +692,34 @@ int main(void) {
     // MONITORAMENTO DE PROGRESSO
     // ============================================================
     
+    // Orientado a eventos: cada imagem concluída acorda o coordenador
+    // pelo eventfd (ler o estado antes de dormir evita perder avisos)
     int last_processed = 0;
     while (1) {
-        mutex_lock(&g_stats->mutex);
-        
-        int processed = g_stats->processed_images + g_stats->failed_images;
-        int done = g_stats->workers_done;
-        
-        mutex_unlock(&g_stats->mutex);
+        // Soma os blocos dos workers sem trava
+        stats_totals_t totals;
+        stats_collect(g_stats, &totals);
+        int processed = totals.processed_images + totals.failed_images;
         
         // Atualiza barra de progresso
         if (processed != last_processed) {
-            print_progress(processed, num_images);
+            print_progress(processed, g_stats->total_images);
             last_processed = processed;
         }
         
-        // Todos workers terminaram
-        if (done >= NUM_WORKERS) {
+        // Todos workers terminaram (ou saíram sem avisar)
+        int finished = 0;
+        for (int i = 0; i < g_config.num_workers; i++) {
+            if (__atomic_load_n(&g_stats->workers[i].done, __ATOMIC_ACQUIRE) ||
+                worker_pidfds[i] == -2) {
+                finished++;
+            }
+        }
+        if (finished >= g_config.num_workers) {
             break;
         }
         
-        usleep(100000);  // 100ms
+        wait_for_progress();
     }
     
     // ============================================================
@@ -303,12 +728,15 @@ int main(void) {
     
     LOG_COORD("Aguardando workers finalizarem...");
     
-    for (int i = 0; i < NUM_WORKERS; i++) {
+    int workers_failed = 0;
+    for (int i = 0; i < g_config.num_workers; i++) {
         int status;
         waitpid(worker_pids[i], &status, 0);
         
-        if (WIFEXITED(status)) {
-            // Worker terminou normalmente
+        if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+            // Ex.: não conseguiu fechar o pacote (-P); já contou as falhas
+            LOG_ERROR("Worker %d saiu com status %d", i, WEXITSTATUS(status));
+            workers_failed++;
         } else if (WIFSIGNALED(status)) {
             LOG_ERROR("Worker %d terminado por sinal %d", i, WTERMSIG(status));
         }
@@ -316,9 +744,33 @@ int main(void) {
     
     LOG_COORD("Todos os workers finalizaram");
     
-    // Fecha pipe de leitura
-    close(log_pipe[0]);
-    pthread_cancel(log_thread);
+    // Os buffers de trace estão completos: nenhum worker escreve mais
+    uint32_t trace_dropped = 0;
+    if (g_config.trace_file && trace_write_json(g_config.trace_file, worker_pids, &trace_dropped) == 0) {
+        LOG_COORD("Trace gravado em %s", g_config.trace_file);
+        if (trace_dropped > 0) {
+            LOG_ERROR("Trace: %u eventos descartados (buffers de %d eventos por thread; aumente -N)",
+                      trace_dropped, g_config.trace_events);
+        }
+    }
+    trace_shutdown();
+    
+    for (int i = 0; i < g_config.num_workers; i++) {
+        if (worker_pidfds[i] >= 0) close(worker_pidfds[i]);
+    }
+    close(progress_fd);
+    
+    // Imagens em memória da API só podem ser liberadas agora
+    if (g_config.socket_path) {
+        server_shutdown();
+    }
+    close(done_sock[0]);
+    
+    metrics_stop();
+    
+    // Workers encerrados: o leitor esvazia os anéis e termina
+    log_stop = 1;
+    log_wake(&g_stats->log);
     pthread_join(log_thread, NULL);
     
     // ============================================================
@@ -329,16 +781,20 @@ int main(void) {
     double total_time = get_time_diff(start_time, end_time);
     g_stats->total_processing_time = total_time;
     
-    print_statistics(g_stats);
+    if (g_stats->total_images > 0) {
+        print_statistics(g_stats, workers_failed);
+    }
     
     // ============================================================
     // LIMPEZA
     // ============================================================
     
-    destroy_mutex(&g_stats->mutex, &g_stats->mutex_attr);
-    destroy_cond(&g_stats->cond_finished, &g_stats->cond_attr);
+    // Com -V, divergência acima da tolerância é erro
+    int verify_failed = g_config.verify && verify_failures(g_stats) > 0;
+    
     cleanup_sync(g_io_sem);
     cleanup_ipc_coordinator(g_mq, g_stats, g_shm_fd);
     
-    return 0;
+    if (verify_failed || workers_failed) return 1;
+    return (num_images > 0 || g_config.daemon) ? 0 : 1;
 }
@@ -0,0 +1,133 @@
+#include "mem_budget.h"
+#include "filters.h"
+#include "sync_manager.h"
+#include <sys/resource.h>
+
+// ============================================================
+// ESTIMATIVA
+// ============================================================
+
+uint64_t mem_estimate(int width, int height, int channels, int filter_mask, int verify,
+                      int encode_threads) {
+    uint64_t frame = (uint64_t)width * height * channels;
+    
+    // Decodificação: o stb_image mantém planos por componente além do quadro
+    uint64_t decode = 2 * frame;
+    
+    // Filtros em paralelo: o quadro e, por saída, o buffer do filtro, o
+    // codificado (limitado pelo tamanho bruto), as faixas da codificação
+    // paralela (-E) e a cópia da verificação (-V)
+    uint64_t filters = frame;
+    int copies = 2 + (encode_threads > 1) + (verify != 0);
+    for (int f = 0; f < NUM_THREADS; f++) {
+        if (!(filter_mask & (1 << f))) continue;
+        
+        uint64_t out = frame;
+        if (f == FILTER_RESIZE) {
+            int out_w, out_h;
+            resize_dimensions(width, height, &out_w, &out_h);
+            out = (uint64_t)out_w * out_h * channels;
+        }
+        filters += out * copies;
+    }
+    
+    return decode > filters ? decode : filters;
+}
+
+// ============================================================
+// ORÇAMENTO COMPARTILHADO
+// ============================================================
+
+static void update_max(uint64_t *max, uint64_t value) {
+    uint64_t cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while (value > cur &&
+           !__atomic_compare_exchange_n(max, &cur, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+uint64_t mem_reserve(shared_stats_t *stats, int worker_id, uint64_t bytes) {
+    uint64_t budget = stats->mem_budget;
+    uint64_t wait_start = 0;
+    
+    while (1) {
+        // seq antes do uso: uma liberação entre os dois faz o futex_wait
+        // voltar na hora, sem perder o aviso
+        unsigned int seq = __atomic_load_n(&stats->mem_seq, __ATOMIC_ACQUIRE);
+        uint64_t used = __atomic_load_n(&stats->mem_reserved, __ATOMIC_RELAXED);
+        
+        if (budget == 0 || used == 0 || used + bytes <= budget) {
+            if (__atomic_compare_exchange_n(&stats->mem_reserved, &used, used + bytes, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                update_max(&stats->mem_reserved_peak, used + bytes);
+                break;
+            }
+            continue;
+        }
+        
+        if (wait_start == 0) wait_start = monotonic_ns();
+        futex_wait(&stats->mem_seq, seq, 1000);
+    }
+    
+    worker_stats_t *ws = &stats->workers[worker_id];
+    __atomic_store_n(&ws->mem_reserved, bytes, __ATOMIC_RELAXED);
+    if (bytes > ws->mem_reserved_peak) {
+        __atomic_store_n(&ws->mem_reserved_peak, bytes, __ATOMIC_RELAXED);
+    }
+    if (wait_start == 0) return 0;
+    
+    uint64_t waited = monotonic_ns() - wait_start;
+    __atomic_fetch_add(&ws->mem_deferred, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ws->mem_wait_us, waited / 1000, __ATOMIC_RELAXED);
+    return waited;
+}
+
+void mem_release(shared_stats_t *stats, int worker_id, uint64_t bytes) {
+    __atomic_store_n(&stats->workers[worker_id].mem_reserved, 0, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&stats->mem_reserved, bytes, __ATOMIC_ACQ_REL);
+    
+    // Acorda quem espera; sem orçamento ninguém dorme no futex
+    if (stats->mem_budget != 0) {
+        __atomic_add_fetch(&stats->mem_seq, 1, __ATOMIC_RELEASE);
+        futex_wake_all(&stats->mem_seq);
+    }
+}
+
+// ============================================================
+// USO REAL
+// ============================================================
+
+void mem_sample_rss(worker_stats_t *ws) {
+    // statm: tamanho total e residente, em páginas
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f) {
+        unsigned long size, resident;
+        if (fscanf(f, "%lu %lu", &size, &resident) == 2) {
+            __atomic_store_n(&ws->rss_bytes, (uint64_t)resident * sysconf(_SC_PAGESIZE),
+                             __ATOMIC_RELAXED);
+        }
+        fclose(f);
+    }
+    
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        __atomic_store_n(&ws->rss_peak_bytes, (uint64_t)ru.ru_maxrss * 1024, __ATOMIC_RELAXED);
+    }
+}
+
+uint64_t parse_mem_size(const char *text) {
+    char *end;
+    errno = 0;
+    double value = strtod(text, &end);
+    if (errno != 0 || end == text || value <= 0) return 0;
+    
+    switch (*end) {
+        case 'k': case 'K': value *= 1024.0; end++; break;
+        case 'm': case 'M': value *= 1024.0 * 1024; end++; break;
+        case 'g': case 'G': value *= 1024.0 * 1024 * 1024; end++; break;
+        default: break;
+    }
+    if (*end == 'B' || *end == 'b') end++;
+    // !(value < 2^64) também recusa NaN e infinito, que não cabem no inteiro
+    if (*end != '\0' || value < 1 || !(value < 18446744073709551616.0)) return 0;
+    return (uint64_t)value;
+}
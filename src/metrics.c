@@ -0,0 +1,285 @@
+#include "metrics.h"
+#include "histogram.h"
+#include "ipc_manager.h"
+#include "filters.h"
+#include "image_encode.h"
+
+#define METRIC_PREFIX "image_processor_"
+
+static struct {
+    const char *path;
+    char *tmp_path;
+    int interval_ms;
+    shared_stats_t *stats;
+    mqd_t mq;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stop;
+    int running;
+} exporter;
+
+// Limites dos buckets (s): a resolução fina fica nos histogramas internos
+static const double latency_bounds[] = {
+    0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+    0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+};
+
+// ============================================================
+// FORMATAÇÃO
+// ============================================================
+
+// Valor de label: escapa \, " e quebra de linha
+static void write_label_value(FILE *f, const char *value) {
+    for (const char *p = value; *p; p++) {
+        if (*p == '\\' || *p == '"') {
+            fputc('\\', f);
+            fputc(*p, f);
+        } else if (*p == '\n') {
+            fputs("\\n", f);
+        } else {
+            fputc(*p, f);
+        }
+    }
+}
+
+static void write_header(FILE *f, const char *name, const char *type, const char *help) {
+    fprintf(f, "# HELP " METRIC_PREFIX "%s %s\n", name, help);
+    fprintf(f, "# TYPE " METRIC_PREFIX "%s %s\n", name, type);
+}
+
+// Histograma com labels já formatados (ex.: stage="decode")
+static void write_histogram(FILE *f, const char *labels, const latency_hist_t *h) {
+    // +Inf e _count saem da mesma cópia dos buckets: ficam consistentes
+    // mesmo com o worker gravando durante a leitura
+    uint64_t total = hist_count_at_most(h, UINT64_MAX);
+    
+    for (size_t i = 0; i < sizeof(latency_bounds) / sizeof(latency_bounds[0]); i++) {
+        uint64_t count = hist_count_at_most(h, (uint64_t)(latency_bounds[i] * 1e6));
+        fprintf(f, METRIC_PREFIX "stage_latency_seconds_bucket{%s,le=\"%g\"} %llu\n",
+                labels, latency_bounds[i], (unsigned long long)count);
+    }
+    fprintf(f, METRIC_PREFIX "stage_latency_seconds_bucket{%s,le=\"+Inf\"} %llu\n",
+            labels, (unsigned long long)total);
+    fprintf(f, METRIC_PREFIX "stage_latency_seconds_sum{%s} %.6f\n", labels, h->sum_us / 1e6);
+    fprintf(f, METRIC_PREFIX "stage_latency_seconds_count{%s} %llu\n",
+            labels, (unsigned long long)total);
+}
+
+static void write_latency(FILE *f, const shared_stats_t *stats) {
+    // Cópia somada dos workers (leituras relaxadas, sem trava)
+    static worker_latency_t merged;
+    stats_merge_latency(stats, &merged);
+    
+    write_header(f, "stage_latency_seconds", "histogram", "Latência por etapa do processamento");
+    write_histogram(f, "stage=\"decode\"", &merged.decode);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        char labels[96];
+        snprintf(labels, sizeof(labels), "stage=\"filter\",filter=\"%s\"", get_filter_name(i));
+        write_histogram(f, labels, &merged.filter[i]);
+        snprintf(labels, sizeof(labels), "stage=\"encode\",filter=\"%s\"", get_filter_name(i));
+        write_histogram(f, labels, &merged.encode[i]);
+        snprintf(labels, sizeof(labels), "stage=\"write\",filter=\"%s\"", get_filter_name(i));
+        write_histogram(f, labels, &merged.write[i]);
+    }
+    write_histogram(f, "stage=\"total\"", &merged.total);
+}
+
+static void write_metrics(FILE *f) {
+    const shared_stats_t *stats = exporter.stats;
+    
+    write_header(f, "tasks_dispatched_total", "counter", "Tarefas enviadas à fila");
+    fprintf(f, METRIC_PREFIX "tasks_dispatched_total %d\n",
+            __atomic_load_n(&stats->total_images, __ATOMIC_RELAXED));
+    
+    struct mq_attr attr;
+    if (mq_getattr(exporter.mq, &attr) == 0) {
+        write_header(f, "queue_depth", "gauge", "Tarefas aguardando na fila de mensagens");
+        fprintf(f, METRIC_PREFIX "queue_depth %ld\n", attr.mq_curmsgs);
+    }
+    
+    uint64_t spawn_ns = __atomic_load_n(&stats->spawn_ns, __ATOMIC_RELAXED);
+    write_header(f, "uptime_seconds", "gauge", "Tempo desde a criação dos workers");
+    fprintf(f, METRIC_PREFIX "uptime_seconds %.3f\n", (monotonic_ns() - spawn_ns) / 1e9);
+    
+    write_header(f, "memory_reserved_bytes", "gauge", "Memória estimada reservada por todos os workers");
+    fprintf(f, METRIC_PREFIX "memory_reserved_bytes %llu\n",
+            (unsigned long long)__atomic_load_n(&stats->mem_reserved, __ATOMIC_RELAXED));
+    if (stats->mem_budget > 0) {
+        write_header(f, "memory_budget_bytes", "gauge", "Orçamento de memória dos workers (-M)");
+        fprintf(f, METRIC_PREFIX "memory_budget_bytes %llu\n", (unsigned long long)stats->mem_budget);
+    }
+    
+    // Por worker: cada bloco tem seu próprio escritor, lido sem trava
+    write_header(f, "images_processed_total", "counter", "Imagens processadas com sucesso");
+    for (int w = 0; w < stats->num_workers; w++) {
+        fprintf(f, METRIC_PREFIX "images_processed_total{worker=\"%d\"} %llu\n", w,
+                (unsigned long long)__atomic_load_n(&stats->workers[w].processed, __ATOMIC_RELAXED));
+    }
+    write_header(f, "images_failed_total", "counter", "Imagens com falha");
+    for (int w = 0; w < stats->num_workers; w++) {
+        fprintf(f, METRIC_PREFIX "images_failed_total{worker=\"%d\"} %llu\n", w,
+                (unsigned long long)__atomic_load_n(&stats->workers[w].failed, __ATOMIC_RELAXED));
+    }
+    write_header(f, "worker_busy_seconds_total", "counter", "Tempo gasto processando imagens");
+    for (int w = 0; w < stats->num_workers; w++) {
+        fprintf(f, METRIC_PREFIX "worker_busy_seconds_total{worker=\"%d\"} %.6f\n", w,
+                __atomic_load_n(&stats->workers[w].busy_us, __ATOMIC_RELAXED) / 1e6);
+    }
+    write_header(f, "worker_active", "gauge", "1 enquanto o worker consome a fila");
+    for (int w = 0; w < stats->num_workers; w++) {
+        fprintf(f, METRIC_PREFIX "worker_active{worker=\"%d\"} %d\n", w,
+                __atomic_load_n(&stats->workers[w].active, __ATOMIC_RELAXED));
+    }
+    // O nome do arquivo não vira rótulo: cada arquivo criaria uma série nova
+    write_header(f, "worker_busy", "gauge", "1 enquanto o worker processa uma imagem");
+    for (int w = 0; w < stats->num_workers; w++) {
+        char name[MAX_FILENAME];
+        stats_get_current_file(&stats->workers[w], name);
+        fprintf(f, METRIC_PREFIX "worker_busy{worker=\"%d\"} %d\n", w,
+                name[0] != '\0' && strcmp(name, "idle") != 0);
+    }
+    write_header(f, "worker_memory_reserved_bytes", "gauge", "Reserva estimada da tarefa atual");
+    for (int w = 0; w < stats->num_workers; w++) {
+        fprintf(f, METRIC_PREFIX "worker_memory_reserved_bytes{worker=\"%d\"} %llu\n", w,
+                (unsigned long long)__atomic_load_n(&stats->workers[w].mem_reserved, __ATOMIC_RELAXED));
+    }
+    write_header(f, "worker_rss_bytes", "gauge", "RSS do worker após a última tarefa");
+    for (int w = 0; w < stats->num_workers; w++) {
+        fprintf(f, METRIC_PREFIX "worker_rss_bytes{worker=\"%d\"} %llu\n", w,
+                (unsigned long long)__atomic_load_n(&stats->workers[w].rss_bytes, __ATOMIC_RELAXED));
+    }
+    write_header(f, "worker_rss_peak_bytes", "gauge", "Pico de RSS do worker");
+    for (int w = 0; w < stats->num_workers; w++) {
+        fprintf(f, METRIC_PREFIX "worker_rss_peak_bytes{worker=\"%d\"} %llu\n", w,
+                (unsigned long long)__atomic_load_n(&stats->workers[w].rss_peak_bytes, __ATOMIC_RELAXED));
+    }
+    write_header(f, "tasks_deferred_total", "counter", "Tarefas adiadas pelo orçamento de memória");
+    for (int w = 0; w < stats->num_workers; w++) {
+        fprintf(f, METRIC_PREFIX "tasks_deferred_total{worker=\"%d\"} %llu\n", w,
+                (unsigned long long)__atomic_load_n(&stats->workers[w].mem_deferred, __ATOMIC_RELAXED));
+    }
+    write_header(f, "log_records_dropped_total", "counter", "Registros de log descartados com o anel cheio");
+    for (int w = 0; w < stats->num_workers; w++) {
+        fprintf(f, METRIC_PREFIX "log_records_dropped_total{worker=\"%d\"} %llu\n", w,
+                (unsigned long long)__atomic_load_n(&stats->log.rings[w].dropped, __ATOMIC_RELAXED));
+    }
+    
+    // Por perfil de codificação: somas de todos os workers e filtros
+    encode_totals_t encode[ENCODE_STAT_SLOTS * NUM_THREADS];
+    int profiles = stats_collect_encode(stats, encode, ENCODE_STAT_SLOTS * NUM_THREADS);
+    static const struct { const char *name, *help; } encode_metrics[] = {
+        { "encode_outputs_total", "Saídas codificadas por perfil" },
+        { "encode_pixels_total", "Pixels codificados por perfil" },
+        { "encode_bytes_total", "Bytes codificados por perfil" },
+        { "encode_seconds_total", "Tempo de codificação por perfil" },
+    };
+    for (int m = 0; m < 4 && profiles > 0; m++) {
+        write_header(f, encode_metrics[m].name, "counter", encode_metrics[m].help);
+        for (int i = 0; i < profiles; i++) {
+            char label[64];
+            describe_encode_key(encode[i].key, label, sizeof(label));
+            fprintf(f, METRIC_PREFIX "%s{profile=\"", encode_metrics[m].name);
+            write_label_value(f, label);
+            fputs("\"} ", f);
+            if (m == 0) fprintf(f, "%llu\n", (unsigned long long)encode[i].outputs);
+            else if (m == 1) fprintf(f, "%llu\n", (unsigned long long)encode[i].pixels);
+            else if (m == 2) fprintf(f, "%llu\n", (unsigned long long)encode[i].bytes);
+            else fprintf(f, "%.6f\n", encode[i].ns / 1e9);
+        }
+    }
+    
+    write_latency(f, stats);
+}
+
+// Grava em ARQ.tmp e renomeia por cima de ARQ
+static int export_once(void) {
+    FILE *f = fopen(exporter.tmp_path, "w");
+    if (!f) {
+        LOG_ERROR("Métricas: falha ao criar %s: %s", exporter.tmp_path, strerror(errno));
+        return -1;
+    }
+    
+    write_metrics(f);
+    if (fclose(f) != 0 || rename(exporter.tmp_path, exporter.path) == -1) {
+        LOG_ERROR("Métricas: falha ao gravar %s: %s", exporter.path, strerror(errno));
+        unlink(exporter.tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+// ============================================================
+// THREAD DO EXPORTADOR
+// ============================================================
+
+static void* exporter_thread(void *arg) {
+    (void)arg;
+    
+    pthread_mutex_lock(&exporter.lock);
+    while (!exporter.stop) {
+        pthread_mutex_unlock(&exporter.lock);
+        export_once();
+        pthread_mutex_lock(&exporter.lock);
+        
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += exporter.interval_ms / 1000;
+        deadline.tv_nsec += (exporter.interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (!exporter.stop &&
+               pthread_cond_timedwait(&exporter.cond, &exporter.lock, &deadline) != ETIMEDOUT) {
+        }
+    }
+    pthread_mutex_unlock(&exporter.lock);
+    
+    return NULL;
+}
+
+int metrics_start(const char *path, int interval_ms, shared_stats_t *stats, mqd_t mq) {
+    exporter.path = path;
+    exporter.interval_ms = interval_ms > 0 ? interval_ms : 1000;
+    exporter.stats = stats;
+    exporter.mq = mq;
+    exporter.stop = 0;
+    if (asprintf(&exporter.tmp_path, "%s.tmp", path) == -1) {
+        exporter.tmp_path = NULL;
+        return -1;
+    }
+    
+    // Prazo do timedwait em CLOCK_MONOTONIC (imune a ajustes do relógio)
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&exporter.cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&exporter.lock, NULL);
+    
+    if (pthread_create(&exporter.thread, NULL, exporter_thread, NULL) != 0) {
+        LOG_ERROR("Métricas: falha ao criar thread");
+        free(exporter.tmp_path);
+        exporter.tmp_path = NULL;
+        return -1;
+    }
+    exporter.running = 1;
+    return 0;
+}
+
+void metrics_stop(void) {
+    if (!exporter.running) return;
+    
+    pthread_mutex_lock(&exporter.lock);
+    exporter.stop = 1;
+    pthread_cond_signal(&exporter.cond);
+    pthread_mutex_unlock(&exporter.lock);
+    pthread_join(exporter.thread, NULL);
+    exporter.running = 0;
+    
+    // Retrato final, com os contadores já completos
+    export_once();
+    free(exporter.tmp_path);
+    exporter.tmp_path = NULL;
+}
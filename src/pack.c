@@ -0,0 +1,243 @@
+#include "pack.h"
+#include "deflate.h"
+
+static const char pack_magic[8] = { 'I', 'M', 'G', 'P', 'A', 'C', 'K', '1' };
+static const char pack_end_magic[8] = { 'I', 'M', 'G', 'P', 'K', 'E', 'N', 'D' };
+
+#define INDEX_RECORD_SIZE   22          // Registro do índice sem o nome
+
+struct pack_writer {
+    int fd;
+    pthread_mutex_t lock;
+    unsigned char *buf;                 // Dados ainda não gravados
+    size_t used;
+    uint64_t offset;                    // Deslocamento do próximo dado no arquivo
+    unsigned char *index;               // Índice serializado, gravado no fim
+    size_t index_len;
+    size_t index_cap;
+    uint32_t count;
+    int failed;                         // Escrita falhou: o pacote não será fechado
+};
+
+static inline void put16le(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static inline void put32le(unsigned char *p, uint32_t v) {
+    put16le(p, v);
+    put16le(p + 2, v >> 16);
+}
+
+static inline void put64le(unsigned char *p, uint64_t v) {
+    put32le(p, (uint32_t)v);
+    put32le(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint32_t get32le(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t get64le(const unsigned char *p) {
+    return (uint64_t)get32le(p) | (uint64_t)get32le(p + 4) << 32;
+}
+
+static int write_full(int fd, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char*)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// ============================================================
+// ESCRITA
+// ============================================================
+
+pack_writer_t* pack_create(const char *path) {
+    pack_writer_t *pack = (pack_writer_t*)calloc(1, sizeof(pack_writer_t));
+    if (!pack) return NULL;
+    pack->buf = (unsigned char*)malloc(PACK_BUFFER_SIZE);
+    pack->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (!pack->buf || pack->fd == -1) {
+        int err = errno;
+        if (pack->fd != -1) close(pack->fd);
+        free(pack->buf);
+        free(pack);
+        errno = err;
+        return NULL;
+    }
+    
+    pthread_mutex_init(&pack->lock, NULL);
+    memcpy(pack->buf, pack_magic, PACK_HEADER_SIZE);
+    pack->used = PACK_HEADER_SIZE;
+    pack->offset = PACK_HEADER_SIZE;
+    return pack;
+}
+
+static int flush_buffer(pack_writer_t *pack) {
+    int result = write_full(pack->fd, pack->buf, pack->used);
+    pack->used = 0;
+    return result;
+}
+
+static int index_add(pack_writer_t *pack, uint64_t offset, uint64_t length, uint32_t crc,
+                     const char *name, size_t name_len) {
+    size_t need = pack->index_len + INDEX_RECORD_SIZE + name_len;
+    if (need > pack->index_cap) {
+        size_t cap = pack->index_cap ? pack->index_cap * 2 : 64 * 1024;
+        while (cap < need) cap *= 2;
+        unsigned char *grown = (unsigned char*)realloc(pack->index, cap);
+        if (!grown) return -1;
+        pack->index = grown;
+        pack->index_cap = cap;
+    }
+    
+    unsigned char *r = pack->index + pack->index_len;
+    put64le(r, offset);
+    put64le(r + 8, length);
+    put32le(r + 16, crc);
+    put16le(r + 20, (uint32_t)name_len);
+    memcpy(r + INDEX_RECORD_SIZE, name, name_len);
+    pack->index_len = need;
+    pack->count++;
+    return 0;
+}
+
+int pack_append(pack_writer_t *pack, const char *name, const struct iovec *iov, int iovcnt) {
+    size_t name_len = strlen(name);
+    if (name_len == 0 || name_len > PACK_MAX_NAME) return -1;
+    
+    // Checksum fora da trava: as threads de filtro só disputam a cópia
+    uint32_t crc = 0;
+    uint64_t length = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        crc = crc32_update(crc, (const unsigned char*)iov[i].iov_base, iov[i].iov_len);
+        length += iov[i].iov_len;
+    }
+    
+    pthread_mutex_lock(&pack->lock);
+    uint64_t offset = pack->offset;
+    int result = pack->failed ? -1 : 0;
+    if (result == 0 && pack->used + length > PACK_BUFFER_SIZE) {
+        result = flush_buffer(pack);
+    }
+    for (int i = 0; i < iovcnt && result == 0; i++) {
+        // Blocos maiores que o buffer vão direto (o buffer já está vazio)
+        if (length >= PACK_BUFFER_SIZE) {
+            result = write_full(pack->fd, iov[i].iov_base, iov[i].iov_len);
+        } else {
+            memcpy(pack->buf + pack->used, iov[i].iov_base, iov[i].iov_len);
+            pack->used += iov[i].iov_len;
+        }
+    }
+    if (result == 0) result = index_add(pack, offset, length, crc, name, name_len);
+    
+    // Uma falha no meio deixa o arquivo inconsistente com o índice
+    if (result == 0) pack->offset += length;
+    else pack->failed = 1;
+    pthread_mutex_unlock(&pack->lock);
+    return result;
+}
+
+int pack_close(pack_writer_t *pack, uint32_t *entries) {
+    unsigned char trailer[PACK_TRAILER_SIZE];
+    put64le(trailer, pack->offset);
+    put32le(trailer + 8, pack->count);
+    put32le(trailer + 12, crc32_update(0, pack->index, pack->index_len));
+    memcpy(trailer + 16, pack_end_magic, sizeof(pack_end_magic));
+    
+    int result = pack->failed ? -1 : flush_buffer(pack);
+    if (result == 0) result = write_full(pack->fd, pack->index, pack->index_len);
+    if (result == 0) result = write_full(pack->fd, trailer, sizeof(trailer));
+    if (close(pack->fd) == -1) result = -1;
+    if (entries) *entries = pack->count;
+    
+    pthread_mutex_destroy(&pack->lock);
+    free(pack->index);
+    free(pack->buf);
+    free(pack);
+    return result;
+}
+
+// ============================================================
+// LEITURA
+// ============================================================
+
+static int read_full(int fd, void *data, size_t len, uint64_t offset) {
+    unsigned char *p = (unsigned char*)data;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return 0;
+}
+
+pack_entry_t* pack_read_index(int fd, uint64_t size, uint32_t *count) {
+    unsigned char header[PACK_HEADER_SIZE], trailer[PACK_TRAILER_SIZE];
+    if (size < PACK_HEADER_SIZE + PACK_TRAILER_SIZE ||
+        read_full(fd, header, sizeof(header), 0) != 0 ||
+        read_full(fd, trailer, sizeof(trailer), size - PACK_TRAILER_SIZE) != 0 ||
+        memcmp(header, pack_magic, sizeof(pack_magic)) != 0 ||
+        memcmp(trailer + 16, pack_end_magic, sizeof(pack_end_magic)) != 0) {
+        return NULL;
+    }
+    
+    uint64_t index_offset = get64le(trailer);
+    uint32_t n = get32le(trailer + 8);
+    if (index_offset < PACK_HEADER_SIZE || index_offset > size - PACK_TRAILER_SIZE) return NULL;
+    size_t index_len = (size_t)(size - PACK_TRAILER_SIZE - index_offset);
+    if ((uint64_t)n * INDEX_RECORD_SIZE > index_len) return NULL;
+    
+    // Entradas e nomes (com '\0') num bloco só
+    unsigned char *index = (unsigned char*)malloc(index_len ? index_len : 1);
+    pack_entry_t *entries = (pack_entry_t*)malloc((size_t)n * sizeof(pack_entry_t) + index_len + n + 1);
+    if (!index || !entries || read_full(fd, index, index_len, index_offset) != 0 ||
+        crc32_update(0, index, index_len) != get32le(trailer + 12)) {
+        free(index);
+        free(entries);
+        return NULL;
+    }
+    
+    char *names = (char*)(entries + n);
+    const unsigned char *r = index, *end = index + index_len;
+    int valid = 1;
+    for (uint32_t i = 0; i < n && valid; i++) {
+        size_t name_len = end - r >= INDEX_RECORD_SIZE ? (size_t)(r[20] | r[21] << 8) : 0;
+        valid = name_len > 0 && (size_t)(end - r) - INDEX_RECORD_SIZE >= name_len &&
+                !memchr(r + INDEX_RECORD_SIZE, '\0', name_len);
+        if (!valid) break;
+        
+        pack_entry_t *e = &entries[i];
+        e->offset = get64le(r);
+        e->length = get64le(r + 8);
+        e->crc = get32le(r + 16);
+        e->name = names;
+        memcpy(names, r + INDEX_RECORD_SIZE, name_len);
+        names[name_len] = '\0';
+        names += name_len + 1;
+        r += INDEX_RECORD_SIZE + name_len;
+        
+        // Os dados ficam entre o cabeçalho e o índice
+        valid = e->offset >= PACK_HEADER_SIZE && e->offset <= index_offset &&
+                e->length <= index_offset - e->offset;
+    }
+    free(index);
+    
+    if (!valid || r != end) {
+        free(entries);
+        return NULL;
+    }
+    *count = n;
+    return entries;
+}
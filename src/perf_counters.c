@@ -0,0 +1,133 @@
+#include "perf_counters.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counter_defs[PERF_NUM_COUNTERS] = {
+    [PERF_CYCLES]        = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    [PERF_INSTRUCTIONS]  = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    [PERF_LLC_MISSES]    = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    [PERF_BRANCH_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+
+// Formato de leitura com PERF_FORMAT_GROUP | ID | TOTAL_TIME_*
+typedef struct {
+    uint64_t nr;
+    uint64_t time_enabled;
+    uint64_t time_running;
+    struct {
+        uint64_t value;
+        uint64_t id;
+    } values[PERF_NUM_COUNTERS];
+} group_read_t;
+
+static int open_counter(int counter, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counter_defs[counter].type;
+    attr.config = counter_defs[counter].config;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // Só código de usuário: funciona com perf_event_paranoid <= 2
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    
+    // pid 0, cpu -1: apenas a thread chamadora, em qualquer CPU
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+}
+
+int perf_probe(void) {
+    int fd = open_counter(PERF_CYCLES, -1);
+    if (fd == -1) return errno;
+    close(fd);
+    return 0;
+}
+
+int perf_group_open(perf_group_t *g) {
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        g->fds[i] = -1;
+        g->ids[i] = 0;
+    }
+    
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        g->fds[i] = open_counter(i, i == PERF_CYCLES ? -1 : g->fds[PERF_CYCLES]);
+        if (g->fds[i] == -1) {
+            if (i == PERF_CYCLES) return -1;
+            continue;       // Ex.: LLC sem suporte numa VM
+        }
+        if (ioctl(g->fds[i], PERF_EVENT_IOC_ID, &g->ids[i]) == -1) {
+            close(g->fds[i]);
+            g->fds[i] = -1;
+            if (i == PERF_CYCLES) return -1;
+        }
+    }
+    return 0;
+}
+
+void perf_group_close(perf_group_t *g) {
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (g->fds[i] != -1) {
+            close(g->fds[i]);
+            g->fds[i] = -1;
+        }
+    }
+}
+
+int perf_group_read(const perf_group_t *g, perf_sample_t *sample) {
+    group_read_t buf;
+    ssize_t n = read(g->fds[PERF_CYCLES], &buf, sizeof(buf));
+    if (n < (ssize_t)offsetof(group_read_t, values)) return -1;
+    
+    memset(sample, 0, sizeof(*sample));
+    sample->time_enabled = buf.time_enabled;
+    sample->time_running = buf.time_running;
+    
+    // A ordem no grupo segue a abertura, mas os ids dispensam suposições
+    for (uint64_t k = 0; k < buf.nr && k < PERF_NUM_COUNTERS; k++) {
+        for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+            if (g->fds[i] != -1 && g->ids[i] == buf.values[k].id) {
+                sample->values[i] = buf.values[k].value;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+void perf_accumulate(perf_totals_t *totals, const perf_group_t *g,
+                     const perf_sample_t *before, const perf_sample_t *after,
+                     uint64_t pixels) {
+    uint64_t enabled = after->time_enabled - before->time_enabled;
+    uint64_t running = after->time_running - before->time_running;
+    if (running == 0) return;   // Grupo não chegou a ser agendado na PMU
+    
+    for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (g->fds[i] == -1) {
+            totals->missing |= 1u << i;
+            continue;
+        }
+        uint64_t delta = after->values[i] - before->values[i];
+        if (running < enabled) {
+            delta = (uint64_t)((double)delta * enabled / running);
+        }
+        totals->values[i] += delta;
+    }
+    totals->samples++;
+    totals->pixels += pixels;
+}
+
+const char* perf_strerror(int err) {
+    switch (err) {
+        case EACCES:
+        case EPERM:  return "sem permissão; veja /proc/sys/kernel/perf_event_paranoid";
+        case ENOENT:
+        case ENODEV:
+        case EOPNOTSUPP: return "PMU ausente, comum em VMs e contêineres";
+        case ENOSYS: return "kernel sem perf_event_open";
+        default:     return strerror(err);
+    }
+}
@@ -0,0 +1,219 @@
+#include "qoi.h"
+
+#define QOI_OP_INDEX    0x00            // 00iiiiii: cor da posição i do índice
+#define QOI_OP_DIFF     0x40            // 01rrggbb: diferenças -2..1 por canal
+#define QOI_OP_LUMA     0x80            // 10gggggg rrrrbbbb: dg -32..31, dr/db relativos a dg
+#define QOI_OP_RUN      0xc0            // 11nnnnnn: repete o pixel anterior n + 1 vezes
+#define QOI_OP_RGB      0xfe
+#define QOI_OP_RGBA     0xff
+#define QOI_MASK_2      0xc0
+#define QOI_MAX_RUN     62              // 63 e 64 colidiriam com RGB/RGBA
+#define QOI_MAX_PIXELS  400000000u      // Limite da especificação
+
+static const unsigned char qoi_end[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+typedef union {
+    struct { unsigned char r, g, b, a; } c;
+    uint32_t v;
+} qoi_pixel_t;
+
+static inline int qoi_hash(qoi_pixel_t px) {
+    return (px.c.r * 3 + px.c.g * 5 + px.c.b * 7 + px.c.a * 11) & 63;
+}
+
+static inline void put32be(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static inline uint32_t get32be(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// ============================================================
+// CODIFICAÇÃO
+// ============================================================
+
+static inline qoi_pixel_t load_pixel(const unsigned char *p, int channels) {
+    qoi_pixel_t px;
+    switch (channels) {
+        case 1:  px.c.r = px.c.g = px.c.b = p[0]; px.c.a = 255; break;
+        case 2:  px.c.r = px.c.g = px.c.b = p[0]; px.c.a = p[1]; break;
+        case 3:  px.c.r = p[0]; px.c.g = p[1]; px.c.b = p[2]; px.c.a = 255; break;
+        default: px.c.r = p[0]; px.c.g = p[1]; px.c.b = p[2]; px.c.a = p[3]; break;
+    }
+    return px;
+}
+
+unsigned char* qoi_encode(const unsigned char *data, int width, int height, int channels,
+                          size_t *out_len) {
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4) return NULL;
+    size_t pixels = (size_t)width * height;
+    if (pixels > QOI_MAX_PIXELS) return NULL;
+    
+    // Pior caso: um byte de operação mais os canais em todo pixel
+    int out_channels = channels == 1 || channels == 3 ? 3 : 4;
+    size_t cap = QOI_HEADER_SIZE + pixels * (out_channels + 1) + sizeof(qoi_end);
+    unsigned char *out = (unsigned char*)malloc(cap), *o = out;
+    if (!out) return NULL;
+    
+    memcpy(o, "qoif", 4);
+    put32be(o + 4, (uint32_t)width);
+    put32be(o + 8, (uint32_t)height);
+    o[12] = (unsigned char)out_channels;
+    o[13] = 0;                          // sRGB com alfa linear
+    o += QOI_HEADER_SIZE;
+    
+    qoi_pixel_t index[64];
+    memset(index, 0, sizeof(index));
+    qoi_pixel_t prev = { .c = { 0, 0, 0, 255 } };
+    int run = 0;
+    
+    const unsigned char *p = data;
+    for (size_t i = 0; i < pixels; i++, p += channels) {
+        qoi_pixel_t px = load_pixel(p, channels);
+        
+        if (px.v == prev.v) {
+            run++;
+            if (run == QOI_MAX_RUN || i == pixels - 1) {
+                *o++ = (unsigned char)(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            *o++ = (unsigned char)(QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+        
+        int h = qoi_hash(px);
+        if (index[h].v == px.v) {
+            *o++ = (unsigned char)(QOI_OP_INDEX | h);
+        } else if (px.c.a == prev.c.a) {
+            index[h] = px;
+            // Diferenças com a volta de 8 bits da especificação
+            signed char vr = (signed char)(px.c.r - prev.c.r);
+            signed char vg = (signed char)(px.c.g - prev.c.g);
+            signed char vb = (signed char)(px.c.b - prev.c.b);
+            signed char vg_r = (signed char)(vr - vg);
+            signed char vg_b = (signed char)(vb - vg);
+            
+            if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                *o++ = (unsigned char)(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+            } else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8) {
+                *o++ = (unsigned char)(QOI_OP_LUMA | (vg + 32));
+                *o++ = (unsigned char)((vg_r + 8) << 4 | (vg_b + 8));
+            } else {
+                *o++ = QOI_OP_RGB;
+                *o++ = px.c.r;
+                *o++ = px.c.g;
+                *o++ = px.c.b;
+            }
+        } else {
+            index[h] = px;
+            *o++ = QOI_OP_RGBA;
+            *o++ = px.c.r;
+            *o++ = px.c.g;
+            *o++ = px.c.b;
+            *o++ = px.c.a;
+        }
+        prev = px;
+    }
+    
+    memcpy(o, qoi_end, sizeof(qoi_end));
+    o += sizeof(qoi_end);
+    *out_len = (size_t)(o - out);
+    return out;
+}
+
+// ============================================================
+// DECODIFICAÇÃO
+// ============================================================
+
+int qoi_info(const unsigned char *buffer, size_t len, int *width, int *height, int *channels) {
+    if (len < QOI_HEADER_SIZE || memcmp(buffer, "qoif", 4) != 0) return -1;
+    
+    uint32_t w = get32be(buffer + 4), h = get32be(buffer + 8);
+    int ch = buffer[12], colorspace = buffer[13];
+    if (w == 0 || h == 0 || (ch != 3 && ch != 4) || colorspace > 1) return -1;
+    if (w > INT_MAX || h > INT_MAX || h > QOI_MAX_PIXELS / w) return -1;
+    
+    *width = (int)w;
+    *height = (int)h;
+    *channels = ch;
+    return 0;
+}
+
+unsigned char* qoi_decode(const unsigned char *buffer, size_t len,
+                          int *width, int *height, int *channels) {
+    int w, h, ch;
+    if (qoi_info(buffer, len, &w, &h, &ch) != 0) return NULL;
+    if (len < QOI_HEADER_SIZE + sizeof(qoi_end)) return NULL;
+    
+    // Cada operação gera no máximo QOI_MAX_RUN pixels: um cabeçalho grande
+    // com poucos dados é rejeitado antes de reservar a imagem
+    size_t pixels = (size_t)w * h;
+    if ((pixels + QOI_MAX_RUN - 1) / QOI_MAX_RUN > len - QOI_HEADER_SIZE - sizeof(qoi_end)) return NULL;
+    unsigned char *out = (unsigned char*)malloc(pixels * ch), *o = out;
+    if (!out) return NULL;
+    
+    // Uma operação começa antes do marcador final; os até 4 bytes que ela
+    // lê ficam dentro dele, então basta comparar o início
+    const unsigned char *p = buffer + QOI_HEADER_SIZE;
+    const unsigned char *end = buffer + len - sizeof(qoi_end);
+    qoi_pixel_t index[64];
+    memset(index, 0, sizeof(index));
+    qoi_pixel_t px = { .c = { 0, 0, 0, 255 } };
+    int run = 0;
+    
+    for (size_t i = 0; i < pixels; i++, o += ch) {
+        if (run > 0) {
+            run--;
+        } else if (p < end) {
+            int b1 = *p++;
+            if (b1 == QOI_OP_RGB) {
+                px.c.r = p[0];
+                px.c.g = p[1];
+                px.c.b = p[2];
+                p += 3;
+            } else if (b1 == QOI_OP_RGBA) {
+                px.c.r = p[0];
+                px.c.g = p[1];
+                px.c.b = p[2];
+                px.c.a = p[3];
+                p += 4;
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+                px = index[b1];
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+                px.c.r += ((b1 >> 4) & 0x03) - 2;
+                px.c.g += ((b1 >> 2) & 0x03) - 2;
+                px.c.b += (b1 & 0x03) - 2;
+            } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+                int b2 = *p++;
+                int vg = (b1 & 0x3f) - 32;
+                px.c.r += vg - 8 + ((b2 >> 4) & 0x0f);
+                px.c.g += vg;
+                px.c.b += vg - 8 + (b2 & 0x0f);
+            } else {
+                run = b1 & 0x3f;
+            }
+            index[qoi_hash(px)] = px;
+        } else {
+            // Fluxo truncado
+            free(out);
+            return NULL;
+        }
+        
+        o[0] = px.c.r;
+        o[1] = px.c.g;
+        o[2] = px.c.b;
+        if (ch == 4) o[3] = px.c.a;
+    }
+    
+    *width = w;
+    *height = h;
+    *channels = ch;
+    return out;
+}
@@ -0,0 +1,956 @@
+#include "server.h"
+#include "daemon.h"
+#include "ipc_manager.h"
+#include "filters.h"
+#include "config.h"
+#include "image_encode.h"
+#include "ingest.h"
+#include "trace.h"
+#include <stdarg.h>
+#include <sys/un.h>
+
+// Descritores que seguem anexados a uma linha de resposta
+typedef struct {
+    size_t offset;              // Início da linha em client_t.out
+    int fds[NUM_THREADS];
+    int nfds;
+} out_fds_t;
+
+// Cliente conectado ao socket da API
+typedef struct {
+    int fd;                     // -1 = slot livre
+    unsigned int gen;           // Incrementado a cada reuso do slot
+    char *in;                   // Linha de pedido ainda incompleta
+    size_t in_len;
+    char *out;                  // Respostas ainda não enviadas
+    size_t out_len;
+    size_t out_cap;
+    int want_write;             // EPOLLOUT registrado
+    out_fds_t *out_marks;       // Em ordem de offset
+    int nmarks;
+    int marks_cap;
+    // Descritores recebidos (SCM_RIGHTS), consumidos por SUBMIT fd
+    int in_fds[CLIENT_MAX_FDS];
+    int in_nfds;
+    // Recepção de imagem enviada no próprio pedido (SUBMIT data=N)
+    size_t data_left;
+    int data_fd;                // memfd que recebe os bytes (-1 = descartar)
+    task_message_t *data_task;
+    char *data_tag;
+} client_t;
+
+// Tarefa em andamento (indexada por job_id % JOB_TABLE_SIZE)
+typedef struct {
+    int job_id;                 // 0 = livre
+    int client;
+    unsigned int client_gen;
+    int src_fd;                 // memfd da imagem (-1 = arquivo)
+    int out_memory;             // Saídas voltam como memfds (out=-)
+    char *prefix;               // Prefixo de saída, para compor o DONE
+    char ext[NUM_THREADS][8];   // Extensão das saídas de cada filtro
+} job_entry_t;
+
+// Tarefa aguardando espaço na fila de mensagens
+typedef struct pending_task {
+    struct pending_task *next;
+    uint64_t dispatch_ns;       // Início do despacho (trace)
+    task_message_t msg;
+} pending_task_t;
+
+static client_t clients[MAX_CLIENTS];
+static job_entry_t jobs[JOB_TABLE_SIZE];
+static pending_task_t *pending_head = NULL;
+static pending_task_t *pending_tail = NULL;
+
+static int ep_fd = -1;
+static int listen_fd = -1;
+static int done_fd = -1;
+static int progress_fd = -1;
+static mqd_t job_mq = (mqd_t)-1;
+static shared_stats_t *g_server_stats = NULL;
+static int next_job_id = 1;
+static char socket_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+// ============================================================
+// CODIFICAÇÃO DE VALORES (%XX)
+// ============================================================
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decodifica %XX no próprio buffer
+static void percent_decode(char *s) {
+    char *dst = s;
+    for (char *p = s; *p; p++) {
+        if (p[0] == '%' && hex_value(p[1]) >= 0 && hex_value(p[2]) >= 0) {
+            *dst++ = (char)(hex_value(p[1]) * 16 + hex_value(p[2]));
+            p += 2;
+        } else {
+            *dst++ = *p;
+        }
+    }
+    *dst = '\0';
+}
+
+// ============================================================
+// SAÍDA PARA O CLIENTE
+// ============================================================
+
+static void update_client_events(int slot, int want_write) {
+    client_t *c = &clients[slot];
+    if (c->want_write == want_write) return;
+    
+    struct epoll_event ev = {
+        .events = EPOLLIN | (want_write ? EPOLLOUT : 0),
+        .data.u64 = EV_TAG(EV_CLIENT, slot)
+    };
+    epoll_ctl(ep_fd, EPOLL_CTL_MOD, c->fd, &ev);
+    c->want_write = want_write;
+}
+
+static void close_client(int slot);
+
+// Envia o que estiver no buffer; o resto espera EPOLLOUT
+static void flush_client(int slot) {
+    client_t *c = &clients[slot];
+    size_t sent = 0;
+    
+    while (sent < c->out_len) {
+        // Descritores vão no mesmo envio do primeiro byte da sua linha,
+        // e cada envio para antes da próxima linha com descritores
+        out_fds_t *mark = c->nmarks > 0 ? &c->out_marks[0] : NULL;
+        int attach = mark && mark->offset == sent;
+        size_t end = c->out_len;
+        if (mark && !attach) end = mark->offset;
+        else if (attach && c->nmarks > 1) end = c->out_marks[1].offset;
+        
+        ssize_t n = send_with_fds(c->fd, c->out + sent, end - sent,
+                                  attach ? mark->fds : NULL, attach ? mark->nfds : 0, 0);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) break;
+            close_client(slot);
+            return;
+        }
+        sent += n;
+        
+        if (attach) {
+            // Já estão com o cliente: fecha as cópias locais
+            for (int i = 0; i < mark->nfds; i++) close(mark->fds[i]);
+            memmove(&c->out_marks[0], &c->out_marks[1], (c->nmarks - 1) * sizeof(out_fds_t));
+            c->nmarks--;
+        }
+    }
+    
+    memmove(c->out, c->out + sent, c->out_len - sent);
+    c->out_len -= sent;
+    for (int i = 0; i < c->nmarks; i++) {
+        c->out_marks[i].offset -= sent;
+    }
+    update_client_events(slot, c->out_len > 0);
+}
+
+// Enfileira uma linha de resposta; fds (se houver) seguem anexados a
+// ela e passam a pertencer ao cliente, mesmo em caso de erro
+static void queue_reply(int slot, const int *fds, int nfds, const char *fmt, va_list ap) {
+    client_t *c = &clients[slot];
+    if (c->fd == -1) {
+        for (int i = 0; i < nfds; i++) close(fds[i]);
+        return;
+    }
+    
+    char line[MAX_REQUEST_LINE];
+    int len = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+    if (len > (int)sizeof(line) - 2) len = sizeof(line) - 2;
+    if (len >= 0) line[len++] = '\n';
+    
+    int ok = len > 0;
+    if (ok && c->out_len + len > c->out_cap) {
+        size_t cap = c->out_cap ? c->out_cap * 2 : 4096;
+        while (cap < c->out_len + len) cap *= 2;
+        char *buf = (char*)realloc(c->out, cap);
+        if (buf) {
+            c->out = buf;
+            c->out_cap = cap;
+        } else {
+            ok = 0;
+        }
+    }
+    if (ok && nfds > 0 && c->nmarks == c->marks_cap) {
+        int cap = c->marks_cap ? c->marks_cap * 2 : 8;
+        out_fds_t *marks = (out_fds_t*)realloc(c->out_marks, cap * sizeof(out_fds_t));
+        if (marks) {
+            c->out_marks = marks;
+            c->marks_cap = cap;
+        } else {
+            ok = 0;
+        }
+    }
+    if (!ok) {
+        for (int i = 0; i < nfds; i++) close(fds[i]);
+        if (len > 0) close_client(slot);
+        return;
+    }
+    
+    if (nfds > 0) {
+        out_fds_t *mark = &c->out_marks[c->nmarks++];
+        mark->offset = c->out_len;
+        mark->nfds = nfds;
+        memcpy(mark->fds, fds, nfds * sizeof(int));
+    }
+    memcpy(c->out + c->out_len, line, len);
+    c->out_len += len;
+    
+    flush_client(slot);
+}
+
+static void reply(int slot, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void reply_fds(int slot, const int *fds, int nfds, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void reply(int slot, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    queue_reply(slot, NULL, 0, fmt, ap);
+    va_end(ap);
+}
+
+static void reply_fds(int slot, const int *fds, int nfds, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    queue_reply(slot, fds, nfds, fmt, ap);
+    va_end(ap);
+}
+
+// ============================================================
+// CLIENTES
+// ============================================================
+
+static void discard_inline(client_t *c) {
+    if (c->data_fd != -1) close(c->data_fd);
+    free(c->data_task);
+    free(c->data_tag);
+    c->data_fd = -1;
+    c->data_task = NULL;
+    c->data_tag = NULL;
+    c->data_left = 0;
+}
+
+static void close_client(int slot) {
+    client_t *c = &clients[slot];
+    if (c->fd == -1) return;
+    
+    epoll_ctl(ep_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    discard_inline(c);
+    free(c->in);
+    free(c->out);
+    for (int i = 0; i < c->nmarks; i++) {
+        for (int j = 0; j < c->out_marks[i].nfds; j++) close(c->out_marks[i].fds[j]);
+    }
+    free(c->out_marks);
+    for (int i = 0; i < c->in_nfds; i++) close(c->in_fds[i]);
+    
+    // Tarefas já despachadas continuam; seus eventos serão descartados
+    unsigned int gen = c->gen + 1;
+    memset(c, 0, sizeof(*c));
+    c->fd = -1;
+    c->data_fd = -1;
+    c->gen = gen;
+}
+
+static void accept_clients(void) {
+    while (1) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) perror("accept4");
+            return;
+        }
+        
+        int slot = -1;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd == -1) {
+                slot = i;
+                break;
+            }
+        }
+        
+        client_t *c = slot >= 0 ? &clients[slot] : NULL;
+        if (c) c->in = (char*)malloc(MAX_REQUEST_LINE + 1);
+        if (!c || !c->in) {
+            static const char busy[] = "ERROR busy\n";
+            send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL);
+            close(fd);
+            continue;
+        }
+        
+        c->fd = fd;
+        c->in_len = 0;
+        c->want_write = 0;
+        c->data_fd = -1;
+        
+        struct epoll_event ev = {
+            .events = EPOLLIN,
+            .data.u64 = EV_TAG(EV_CLIENT, slot)
+        };
+        if (epoll_ctl(ep_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            perror("epoll_ctl (cliente)");
+            close_client(slot);
+        }
+    }
+}
+
+// ============================================================
+// TAREFAS
+// ============================================================
+
+// Ocupa uma entrada da tabela de tarefas. Retorna o job_id ou -1.
+static int register_job(int slot, const task_message_t *task, int src_fd) {
+    int job_id = next_job_id;
+    job_entry_t *job = &jobs[job_id % JOB_TABLE_SIZE];
+    if (job->job_id != 0) return -1;
+    
+    job->prefix = strdup(task_output_prefix(task));
+    if (!job->prefix) return -1;
+    
+    job->job_id = job_id;
+    job->client = slot;
+    job->client_gen = clients[slot].gen;
+    job->src_fd = src_fd;
+    job->out_memory = (task->flags & TASK_OUT_MEMORY) != 0;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        snprintf(job->ext[i], sizeof(job->ext[i]), "%s", task_output_ext(task, i));
+    }
+    
+    next_job_id = next_job_id == INT_MAX ? 1 : next_job_id + 1;
+    return job_id;
+}
+
+static void release_job(job_entry_t *job) {
+    if (job->src_fd != -1) close(job->src_fd);
+    free(job->prefix);
+    memset(job, 0, sizeof(*job));
+    job->src_fd = -1;
+}
+
+// Envia para a fila sem bloquear; se estiver cheia, guarda para depois.
+// Retorna -1 se a tarefa não pôde ser guardada (sem memória)
+static int dispatch_job(task_message_t *task) {
+    task->task_id = stats_next_task_id(g_server_stats);
+    
+    // O despacho (-t) vai até a tarefa entrar na fila; se ficar pendente,
+    // termina em server_flush_pending. Este laço é o único escritor do
+    // buffer do coordenador depois da varredura inicial
+    trace_buffer_t *trace = trace_coordinator_buffer();
+    uint64_t dispatch_ns = trace ? monotonic_ns() : 0;
+    if (!pending_head && send_task_message(job_mq, task) == 0) {
+        trace_record(trace, TRACE_DISPATCH, 0, task->task_id, dispatch_ns, monotonic_ns());
+        stats_count_task(g_server_stats);
+        return 0;
+    }
+    
+    pending_task_t *p = (pending_task_t*)malloc(sizeof(pending_task_t));
+    if (!p) {
+        LOG_ERROR("Falha ao enfileirar tarefa %d", task->job_id);
+        return -1;
+    }
+    memcpy(&p->msg, task, sizeof(*task));
+    p->dispatch_ns = dispatch_ns;
+    p->next = NULL;
+    if (pending_tail) pending_tail->next = p;
+    else pending_head = p;
+    pending_tail = p;
+    stats_count_task(g_server_stats);
+    return 0;
+}
+
+// Registra a tarefa e a despacha, respondendo ao cliente
+static void submit_task(int slot, task_message_t *task, int src_fd, const char *tag) {
+    int job_id = register_job(slot, task, src_fd);
+    if (job_id < 0) {
+        if (src_fd != -1) close(src_fd);
+        reply(slot, "ERROR busy");
+        return;
+    }
+    
+    task->job_id = job_id;
+    task->src_fd = src_fd;
+    // Despacha antes de responder: um pedido aceito sempre terá DONE
+    // (o DONE só é lido por este mesmo laço, depois da resposta)
+    if (dispatch_job(task) != 0) {
+        release_job(&jobs[job_id % JOB_TABLE_SIZE]);
+        reply(slot, "ERROR no-memory");
+        return;
+    }
+    reply(slot, "ACCEPTED %d%s%s", job_id, tag ? " " : "", tag ? tag : "");
+}
+
+// Monta a mensagem da tarefa a partir das opções do pedido
+static task_message_t* build_task(const char *input, const char *name, const char *out_dir,
+                                  int mask, const char *fmt) {
+    // Nome base: último componente, sem extensão
+    const char *base = strrchr(name, '/');
+    base = base ? base + 1 : name;
+    
+    char *prefix = NULL;
+    if (asprintf(&prefix, "%s/%s", out_dir, base) == -1) return NULL;
+    remove_extension(prefix);
+    
+    size_t in_len = strlen(input);
+    size_t pre_len = strlen(prefix);
+    if (in_len + pre_len + 2 > MAX_TASK_PATH) {
+        free(prefix);
+        return NULL;
+    }
+    
+    task_message_t *task = (task_message_t*)malloc(sizeof(task_message_t));
+    if (!task) {
+        free(prefix);
+        return NULL;
+    }
+    init_task_message(task, 0);
+    task->filter_mask = mask;
+    snprintf(task->out_ext, sizeof(task->out_ext), "%s", fmt);
+    memcpy(task->filename, input, in_len + 1);
+    memcpy(task->filename + in_len + 1, prefix, pre_len + 1);
+    
+    free(prefix);
+    return task;
+}
+
+// Retira o descritor mais antigo recebido do cliente (-1 = nenhum)
+static int take_client_fd(client_t *c) {
+    if (c->in_nfds == 0) return -1;
+    int fd = c->in_fds[0];
+    memmove(&c->in_fds[0], &c->in_fds[1], (c->in_nfds - 1) * sizeof(int));
+    c->in_nfds--;
+    return fd;
+}
+
+// Aceita como imagem de entrada apenas arquivos regulares (memfd) legíveis
+static const char* check_input_fd(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) return "bad-fd";
+    if (st.st_size <= 0 || st.st_size > (off_t)MAX_INLINE_BYTES) return "bad-data-length";
+    
+    // O worker reabre o fd via /proc: não pode ganhar leitura que o
+    // cliente não tinha
+    int mode = fcntl(fd, F_GETFL) & O_ACCMODE;
+    if (mode != O_RDONLY && mode != O_RDWR) return "bad-fd";
+    return NULL;
+}
+
+static void handle_submit(int slot, char *args) {
+    client_t *c = &clients[slot];
+    const char *path = NULL, *name = NULL, *out = NULL, *fmt = "jpg", *tag = NULL;
+    const char *filters = NULL, *crop = NULL, *profile = NULL;
+    long long data_len = -1;
+    int use_fd = 0;
+    const char *error = NULL;
+    
+    // Todos os argumentos são lidos antes de responder a um erro: o
+    // descritor (fd) ou os bytes (data=N) do pedido ainda precisam ser consumidos
+    char *save = NULL;
+    for (char *tok = strtok_r(args, " ", &save); tok; tok = strtok_r(NULL, " ", &save)) {
+        if (strcmp(tok, "fd") == 0) {
+            use_fd = 1;
+            continue;
+        }
+        char *eq = strchr(tok, '=');
+        if (!eq) {
+            if (!error) error = "bad-argument";
+            continue;
+        }
+        *eq = '\0';
+        char *value = eq + 1;
+        percent_decode(value);
+        
+        if (strcmp(tok, "path") == 0) path = value;
+        else if (strcmp(tok, "data") == 0) data_len = atoll(value);
+        else if (strcmp(tok, "name") == 0) name = value;
+        else if (strcmp(tok, "filters") == 0) filters = value;
+        else if (strcmp(tok, "out") == 0) out = value;
+        else if (strcmp(tok, "fmt") == 0) fmt = value;
+        else if (strcmp(tok, "crop") == 0) crop = value;
+        else if (strcmp(tok, "profile") == 0) profile = value;
+        else if (strcmp(tok, "tag") == 0) tag = value;
+        else if (!error) error = "unknown-key";
+    }
+    
+    // Tamanho inválido: o cliente enviará bytes que não podemos
+    // distinguir de pedidos, então a conexão é encerrada
+    if (data_len == 0 || data_len > (long long)MAX_INLINE_BYTES) {
+        reply(slot, "ERROR bad-data-length");
+        flush_client(slot);
+        close_client(slot);
+        return;
+    }
+    
+    int src_fd = -1;
+    if (use_fd) {
+        src_fd = take_client_fd(c);
+        if (src_fd == -1 && !error) error = "missing-fd";
+        if (src_fd != -1 && !error) error = check_input_fd(src_fd);
+    }
+    
+    int mask = filters ? parse_filter_list(filters) : FILTER_ALL_MASK;
+    int out_memory = out && strcmp(out, "-") == 0;
+    // Qualquer processo com acesso ao socket envia pedidos: entrada só
+    // dentro de INPUT_DIR e saída só dentro de OUTPUT_DIR
+    if (path && !error && (path[0] == '/' || !is_safe_relative_path(path))) error = "bad-path";
+    if (out && !out_memory && !error && (out[0] == '/' || !is_safe_relative_path(out))) error = "bad-out";
+    crop_spec_t crop_spec = { 0 };
+    if (crop && !error && parse_crop_spec(crop, &crop_spec) != 0) error = "bad-crop";
+    // Filtros sem perfil no pedido ficam zerados e usam o -Q do servidor
+    encode_profile_t profiles[NUM_THREADS] = { 0 };
+    if (profile && !error && parse_encode_profiles(profile, profiles) != 0) error = "bad-profile";
+    if (!error && (path != NULL) + (data_len > 0) + use_fd != 1) error = "need-path-data-or-fd";
+    else if (!error && mask <= 0) error = "bad-filters";
+    else if (!error && parse_output_format(fmt) < 0) error = "bad-format";
+    
+    task_message_t *task = NULL;
+    if (!error) {
+        const char *label = path ? path : (name ? name : "inline");
+        char *out_dir = NULL;
+        if (out && !out_memory && asprintf(&out_dir, "%s/%s", OUTPUT_DIR, out) == -1) out_dir = NULL;
+        if (out && !out_memory && !out_dir) {
+            error = "no-memory";
+        } else {
+            task = build_task(label, label, out_memory ? "." : (out_dir ? out_dir : OUTPUT_DIR), mask, fmt);
+            if (!task) error = "path-too-long";
+        }
+        free(out_dir);
+        if (task) {
+            if (out_memory) task->flags |= TASK_OUT_MEMORY;
+            task->crop = crop_spec;
+            memcpy(task->profiles, profiles, sizeof(profiles));
+        }
+    }
+    
+    if (data_len <= 0) {
+        if (error) {
+            if (src_fd != -1) close(src_fd);
+            reply(slot, "ERROR %s", error);
+        } else {
+            submit_task(slot, task, src_fd, tag);
+        }
+        free(task);
+        return;
+    }
+    
+    // Imagem inline: os próximos data_len bytes vão para um memfd
+    c->data_left = (size_t)data_len;
+    c->data_task = task;
+    c->data_tag = (!error && tag) ? strdup(tag) : NULL;
+    c->data_fd = -1;
+    if (!error) {
+        c->data_fd = memfd_create("img_job", MFD_CLOEXEC);
+        if (c->data_fd == -1) {
+            perror("memfd_create");
+            error = "no-memory";
+        }
+    }
+    if (error) {
+        reply(slot, "ERROR %s", error);
+        free(c->data_task);
+        c->data_task = NULL;
+    }
+}
+
+static void handle_line(int slot, char *line) {
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == '\r') line[--len] = '\0';
+    if (len == 0) return;
+    
+    char *args = strchr(line, ' ');
+    if (args) *args++ = '\0';
+    else args = line + len;
+    
+    if (strcmp(line, "PING") == 0) {
+        reply(slot, "PONG");
+    } else if (strcmp(line, "SUBMIT") == 0) {
+        handle_submit(slot, args);
+    } else {
+        reply(slot, "ERROR unknown-command %s", line);
+    }
+}
+
+// Bytes de uma imagem inline chegaram por completo
+static void finish_inline(int slot) {
+    client_t *c = &clients[slot];
+    if (c->data_task && c->data_fd != -1) {
+        int fd = c->data_fd;
+        c->data_fd = -1;    // Passa a pertencer à tarefa
+        submit_task(slot, c->data_task, fd, c->data_tag);
+    }
+    discard_inline(c);
+}
+
+// Consome bytes recebidos: linhas de pedido ou dados de imagem inline
+static int consume_input(int slot, const char *buf, size_t n) {
+    client_t *c = &clients[slot];
+    size_t pos = 0;
+    
+    while (pos < n && c->fd != -1) {
+        if (c->data_left > 0) {
+            size_t chunk = n - pos < c->data_left ? n - pos : c->data_left;
+            if (c->data_fd != -1) {
+                ssize_t w = write(c->data_fd, buf + pos, chunk);
+                if (w != (ssize_t)chunk) {
+                    reply(slot, "ERROR no-memory");
+                    close(c->data_fd);
+                    c->data_fd = -1;
+                }
+            }
+            pos += chunk;
+            c->data_left -= chunk;
+            if (c->data_left == 0) finish_inline(slot);
+            continue;
+        }
+        
+        const char *nl = memchr(buf + pos, '\n', n - pos);
+        size_t take = nl ? (size_t)(nl - (buf + pos)) : n - pos;
+        if (c->in_len + take > MAX_REQUEST_LINE) {
+            reply(slot, "ERROR line-too-long");
+            return -1;
+        }
+        memcpy(c->in + c->in_len, buf + pos, take);
+        c->in_len += take;
+        pos += take;
+        
+        if (nl) {
+            pos++;
+            c->in[c->in_len] = '\0';
+            c->in_len = 0;
+            handle_line(slot, c->in);
+        }
+    }
+    
+    return 0;
+}
+
+static void read_client(int slot) {
+    char buf[64 * 1024];
+    int fds[MAX_PASSED_FDS];
+    int nfds;
+    
+    while (clients[slot].fd != -1) {
+        client_t *c = &clients[slot];
+        ssize_t n = recv_with_fds(c->fd, buf, sizeof(buf), fds, &nfds, 0);
+        
+        // Descritores ficam na fila do cliente até um SUBMIT fd
+        for (int i = 0; i < nfds; i++) {
+            if (c->in_nfds < CLIENT_MAX_FDS) {
+                c->in_fds[c->in_nfds++] = fds[i];
+            } else {
+                close(fds[i]);
+                n = -2;
+            }
+        }
+        if (n == -2) {
+            reply(slot, "ERROR too-many-fds");
+            flush_client(slot);
+            close_client(slot);
+            return;
+        }
+        
+        if (n == 0) {
+            close_client(slot);
+            return;
+        }
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) close_client(slot);
+            return;
+        }
+        if (consume_input(slot, buf, n) != 0) {
+            flush_client(slot);
+            close_client(slot);
+            return;
+        }
+    }
+}
+
+// ============================================================
+// EVENTOS DE CONCLUSÃO
+// ============================================================
+
+// Acrescenta um campo de saída à linha do DONE, com %XX onde preciso
+static int append_output(char *line, int len, int cap, const char *value) {
+    if (len < cap - 1) line[len++] = ' ';
+    for (const char *p = value; *p && len < cap - 4; p++) {
+        if (*p == ' ' || *p == '%' || (unsigned char)*p < 0x20) {
+            len += snprintf(line + len, cap - len, "%%%02X", (unsigned char)*p);
+        } else {
+            line[len++] = *p;
+        }
+    }
+    line[len] = '\0';
+    return len;
+}
+
+// fds: memfds das saídas (out=-), na ordem dos filtros
+static void handle_done(const job_done_t *done, int *fds, int nfds) {
+    job_entry_t *job = &jobs[done->job_id % JOB_TABLE_SIZE];
+    if (job->job_id != done->job_id || !job->out_memory) {
+        for (int i = 0; i < nfds; i++) close(fds[i]);
+        if (job->job_id != done->job_id) return;
+        nfds = 0;
+    }
+    
+    client_t *c = &clients[job->client];
+    if (c->fd != -1 && c->gen == job->client_gen) {
+        // DONE <id> ok|fail <ms> <saídas>
+        char line[MAX_REQUEST_LINE];
+        int len = snprintf(line, sizeof(line), "DONE %d %s %.1f", done->job_id,
+                           done->status == 0 ? "ok" : "fail", done->elapsed * 1000.0);
+        
+        int fd_index = 0;
+        for (int i = 0; i < NUM_THREADS; i++) {
+            if (!(done->output_mask & (1 << i))) continue;
+            
+            char output[MAX_TASK_PATH + 32];
+            if (job->out_memory) {
+                // Saída em memória: o memfd correspondente segue anexado
+                if (fd_index++ >= nfds) continue;
+                snprintf(output, sizeof(output), "fd:%s.%s", get_filter_name(i), job->ext[i]);
+            } else {
+                snprintf(output, sizeof(output), "%s_%s.%s", job->prefix, get_filter_name(i), job->ext[i]);
+            }
+            len = append_output(line, len, sizeof(line), output);
+        }
+        reply_fds(job->client, fds, nfds, "%s", line);
+    } else {
+        for (int i = 0; i < nfds; i++) close(fds[i]);
+    }
+    
+    release_job(job);
+}
+
+static void read_done_events(void) {
+    job_done_t done;
+    int fds[MAX_PASSED_FDS];
+    int nfds;
+    
+    while (1) {
+        ssize_t n = recv_with_fds(done_fd, &done, sizeof(done), fds, &nfds, MSG_DONTWAIT);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) perror("recv (conclusão)");
+            return;
+        }
+        if (n != sizeof(done) || nfds > NUM_THREADS) {
+            for (int i = 0; i < nfds; i++) close(fds[i]);
+            continue;
+        }
+        handle_done(&done, fds, nfds);
+    }
+}
+
+// ============================================================
+// INTERFACE COM O LAÇO DE EVENTOS
+// ============================================================
+
+// Só remove um socket abandonado (connect recusado) no caminho de -s;
+// arquivo comum ou serviço ainda escutando é erro, nada é apagado
+static int remove_stale_socket(const struct sockaddr_un *addr) {
+    struct stat st;
+    if (lstat(addr->sun_path, &st) == -1) {
+        if (errno == ENOENT) return 0;
+        LOG_ERROR("%s: %s", addr->sun_path, strerror(errno));
+        return -1;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        LOG_ERROR("%s já existe e não é um socket; escolha outro caminho para -s", addr->sun_path);
+        return -1;
+    }
+    
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe == -1) {
+        perror("socket");
+        return -1;
+    }
+    int rc = connect(probe, (const struct sockaddr*)addr, sizeof(*addr));
+    int err = errno;
+    close(probe);
+    if (rc == 0) {
+        LOG_ERROR("%s já está em uso por outro serviço", addr->sun_path);
+        return -1;
+    }
+    if (err != ECONNREFUSED) {
+        LOG_ERROR("%s: %s", addr->sun_path, strerror(err));
+        return -1;
+    }
+    
+    if (unlink(addr->sun_path) == -1 && errno != ENOENT) {
+        LOG_ERROR("Falha ao remover socket antigo %s: %s", addr->sun_path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int server_init(int epoll_fd, const char *path, shared_stats_t *stats, int done_sock,
+                int progress) {
+    ep_fd = epoll_fd;
+    done_fd = done_sock;
+    progress_fd = progress;
+    g_server_stats = stats;
+    
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+        clients[i].data_fd = -1;
+    }
+    for (int i = 0; i < JOB_TABLE_SIZE; i++) {
+        jobs[i].src_fd = -1;
+    }
+    
+    // Descritor próprio, não bloqueante: o laço de eventos nunca espera a fila
+    job_mq = mq_open(QUEUE_NAME, O_WRONLY | O_NONBLOCK);
+    if (job_mq == (mqd_t)-1) {
+        perror("mq_open (API)");
+        return -1;
+    }
+    
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        LOG_ERROR("Caminho do socket longo demais: %s", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    strcpy(socket_path, path);
+    
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        perror("socket");
+        return -1;
+    }
+    
+    if (remove_stale_socket(&addr) != 0) {
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        LOG_ERROR("Falha ao escutar em %s: %s", path, strerror(errno));
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+    // Só o dono do serviço conecta (antes do listen nada é aceito)
+    if (chmod(path, 0600) == -1 || listen(listen_fd, SOMAXCONN) == -1) {
+        LOG_ERROR("Falha ao escutar em %s: %s", path, strerror(errno));
+        unlink(path);
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+    
+    struct epoll_event ev = { .events = EPOLLIN };
+    ev.data.u64 = EV_TAG(EV_LISTEN, 0);
+    epoll_ctl(ep_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.data.u64 = EV_TAG(EV_DONE, 0);
+    epoll_ctl(ep_fd, EPOLL_CTL_ADD, done_fd, &ev);
+    ev.data.u64 = EV_TAG(EV_PROGRESS, 0);
+    epoll_ctl(ep_fd, EPOLL_CTL_ADD, progress_fd, &ev);
+    
+    LOG_SETUP("API de tarefas em %s", path);
+    return 0;
+}
+
+void server_handle_event(const struct epoll_event *ev) {
+    int type = EV_TYPE(ev->data.u64);
+    int id = EV_ID(ev->data.u64);
+    
+    switch (type) {
+        case EV_LISTEN:
+            accept_clients();
+            break;
+        case EV_DONE:
+            read_done_events();
+            break;
+        case EV_PROGRESS: {
+            // Um worker concluiu uma imagem e vai tirar a próxima da fila:
+            // há espaço para as tarefas pendentes. O contador só é zerado
+            uint64_t count;
+            if (read(progress_fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+                perror("read (progresso)");
+            }
+            server_flush_pending();
+            break;
+        }
+        case EV_CLIENT:
+            if (ev->events & (EPOLLERR | EPOLLHUP)) {
+                // Ainda lê o que houver antes de fechar
+                read_client(id);
+                close_client(id);
+                break;
+            }
+            if (ev->events & EPOLLIN) read_client(id);
+            if ((ev->events & EPOLLOUT) && clients[id].fd != -1) flush_client(id);
+            break;
+    }
+}
+
+void server_flush_pending(void) {
+    while (pending_head) {
+        if (send_task_message(job_mq, &pending_head->msg) != 0) {
+            // Fila cheia: o próximo aviso de progresso tenta de novo
+            return;
+        }
+        trace_buffer_t *trace = trace_coordinator_buffer();
+        if (trace) {
+            trace_record(trace, TRACE_DISPATCH, 0, pending_head->msg.task_id,
+                         pending_head->dispatch_ns, monotonic_ns());
+        }
+        pending_task_t *next = pending_head->next;
+        free(pending_head);
+        pending_head = next;
+    }
+    pending_tail = NULL;
+}
+
+void server_drain(void) {
+    if (listen_fd != -1) {
+        epoll_ctl(ep_fd, EPOLL_CTL_DEL, listen_fd, NULL);
+        close(listen_fd);
+        unlink(socket_path);
+        listen_fd = -1;
+    }
+    
+    // Tarefas já aceitas ainda vão para a fila (agora de forma bloqueante)
+    if (job_mq != (mqd_t)-1 && pending_head) {
+        struct mq_attr attr = { .mq_flags = 0 };
+        mq_setattr(job_mq, &attr, NULL);
+        server_flush_pending();
+    }
+}
+
+void server_shutdown(void) {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd != -1) close_client(i);
+    }
+    for (int i = 0; i < JOB_TABLE_SIZE; i++) {
+        if (jobs[i].job_id != 0) release_job(&jobs[i]);
+    }
+    while (pending_head) {
+        pending_task_t *next = pending_head->next;
+        free(pending_head);
+        pending_head = next;
+    }
+    pending_tail = NULL;
+    
+    if (listen_fd != -1) {
+        close(listen_fd);
+        unlink(socket_path);
+        listen_fd = -1;
+    }
+    if (job_mq != (mqd_t)-1) {
+        mq_close(job_mq);
+        job_mq = (mqd_t)-1;
+    }
+}
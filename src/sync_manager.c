@@ -1,4 +1,6 @@
 #include "sync_manager.h"
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
 // ============================================================
 // SEMÁFOROS POSIX NOMEADOS
@@ -49,85 +51,28 @@ void sem_release(sem_t *sem) {
 }
 
 // ============================================================
-// MUTEX PARA MEMÓRIA COMPARTILHADA
+// FUTEX EM MEMÓRIA COMPARTILHADA
 // ============================================================
 
-int init_shared_mutex(pthread_mutex_t *mutex, pthread_mutexattr_t *attr) {
-    // Configura mutex para funcionar entre processos
-    if (pthread_mutexattr_init(attr) != 0) {
-        perror("pthread_mutexattr_init");
+// Sem FUTEX_PRIVATE_FLAG: a palavra é compartilhada entre processos
+int futex_wait(unsigned int *addr, unsigned int expected, int timeout_ms) {
+    struct timespec ts = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_nsec = (long)(timeout_ms % 1000) * 1000000
+    };
+    long ret = syscall(SYS_futex, addr, FUTEX_WAIT, expected,
+                       timeout_ms >= 0 ? &ts : NULL, NULL, 0);
+    if (ret == -1 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+        perror("futex (wait)");
         return -1;
     }
-    
-    if (pthread_mutexattr_setpshared(attr, PTHREAD_PROCESS_SHARED) != 0) {
-        perror("pthread_mutexattr_setpshared");
-        pthread_mutexattr_destroy(attr);
-        return -1;
-    }
-    
-    if (pthread_mutex_init(mutex, attr) != 0) {
-        perror("pthread_mutex_init");
-        pthread_mutexattr_destroy(attr);
-        return -1;
-    }
-    
     return 0;
 }
 
-void destroy_mutex(pthread_mutex_t *mutex, pthread_mutexattr_t *attr) {
-    pthread_mutex_destroy(mutex);
-    pthread_mutexattr_destroy(attr);
-}
-
-void mutex_lock(pthread_mutex_t *mutex) {
-    pthread_mutex_lock(mutex);
-}
-
-void mutex_unlock(pthread_mutex_t *mutex) {
-    pthread_mutex_unlock(mutex);
-}
-
-// ============================================================
-// VARIÁVEIS DE CONDIÇÃO PARA MEMÓRIA COMPARTILHADA
-// ============================================================
-
-int init_shared_cond(pthread_cond_t *cond, pthread_condattr_t *attr) {
-    // Configura cond para funcionar entre processos
-    if (pthread_condattr_init(attr) != 0) {
-        perror("pthread_condattr_init");
-        return -1;
+void futex_wake_all(unsigned int *addr) {
+    if (syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0) == -1) {
+        perror("futex (wake)");
     }
-    
-    if (pthread_condattr_setpshared(attr, PTHREAD_PROCESS_SHARED) != 0) {
-        perror("pthread_condattr_setpshared");
-        pthread_condattr_destroy(attr);
-        return -1;
-    }
-    
-    if (pthread_cond_init(cond, attr) != 0) {
-        perror("pthread_cond_init");
-        pthread_condattr_destroy(attr);
-        return -1;
-    }
-    
-    return 0;
-}
-
-void destroy_cond(pthread_cond_t *cond, pthread_condattr_t *attr) {
-    pthread_cond_destroy(cond);
-    pthread_condattr_destroy(attr);
-}
-
-void cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
-    pthread_cond_wait(cond, mutex);
-}
-
-void cond_signal(pthread_cond_t *cond) {
-    pthread_cond_signal(cond);
-}
-
-void cond_broadcast(pthread_cond_t *cond) {
-    pthread_cond_broadcast(cond);
 }
 
 // ============================================================
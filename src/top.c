@@ -0,0 +1,255 @@
+// image_top - Painel ao vivo do image_processor (outro terminal)
+//
+// Mapeia a memória compartilhada de estatísticas só para leitura: não
+// escreve nada e não usa travas, então não custa nada aos workers.
+
+#include "common.h"
+#include "ipc_manager.h"
+#include "histogram.h"
+#include "filters.h"
+#include <getopt.h>
+#include <poll.h>
+#include <termios.h>
+
+#define MB  (1024.0 * 1024.0)
+
+static struct termios saved_tty;
+static int tty_raw = 0;
+
+static void print_top_usage(const char *prog) {
+    printf("Uso: %s [opções]\n", prog);
+    printf("  -i, --interval MS     Intervalo de atualização (padrão: 1000)\n");
+    printf("  -1, --once            Imprime um único quadro e sai\n");
+    printf("  -h, --help            Mostra esta ajuda\n");
+    printf("Tecla q (ou Ctrl+C) encerra.\n");
+}
+
+// Mapeamento somente leitura do segmento do coordenador
+static const shared_stats_t* attach_stats(void) {
+    int fd = shm_open(SHM_NAME, O_RDONLY, 0);
+    if (fd == -1) {
+        LOG_ERROR("%s: %s (o image_processor está em execução?)", SHM_NAME, strerror(errno));
+        return NULL;
+    }
+    
+    void *mem = mmap(NULL, sizeof(shared_stats_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    return (const shared_stats_t*)mem;
+}
+
+// Terminal sem eco e sem buffer de linha, para ler 'q' sem Enter
+static void tty_enter(void) {
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_tty) == -1) return;
+    
+    struct termios raw = saved_tty;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0) tty_raw = 1;
+    printf("\033[?25l");    // Esconde o cursor
+}
+
+static void tty_leave(void) {
+    if (tty_raw) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_tty);
+        printf("\033[?25h");
+    }
+    tty_raw = 0;
+    printf("\n");
+    fflush(stdout);
+}
+
+// O handler só marca: o terminal é restaurado no laço principal
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+// ============================================================
+// QUADRO
+// ============================================================
+
+// Retrato dos contadores usados para as taxas
+typedef struct {
+    uint64_t ns;
+    uint64_t processed[MAX_WORKERS];
+    uint64_t decoded_bytes;
+} sample_t;
+
+static void take_sample(const shared_stats_t *stats, sample_t *s) {
+    s->ns = monotonic_ns();
+    s->decoded_bytes = 0;
+    for (int w = 0; w < stats->num_workers; w++) {
+        const worker_stats_t *ws = &stats->workers[w];
+        s->processed[w] = __atomic_load_n(&ws->processed, __ATOMIC_RELAXED) +
+                          __atomic_load_n(&ws->failed, __ATOMIC_RELAXED);
+        s->decoded_bytes += __atomic_load_n(&ws->decoded_bytes, __ATOMIC_RELAXED);
+    }
+}
+
+static void print_latency_line(const char *label, const latency_hist_t *h) {
+    print_label(label, 24);
+    if (h->count == 0) {
+        printf(" %8s %8s %8s\n", "-", "-", "-");
+        return;
+    }
+    printf(" %8.2f %8.2f %8.2f\n", hist_percentile(h, 50) / 1000.0,
+           hist_percentile(h, 99) / 1000.0, h->max_us / 1000.0);
+}
+
+static void draw(const shared_stats_t *stats, mqd_t mq, const sample_t *prev, const sample_t *cur,
+                 int clear) {
+    stats_totals_t totals;
+    stats_collect(stats, &totals);
+    double dt = (cur->ns - prev->ns) / 1e9;
+    
+    uint64_t spawn_ns = __atomic_load_n(&stats->spawn_ns, __ATOMIC_RELAXED);
+    long queued = -1;
+    struct mq_attr attr;
+    if (mq != (mqd_t)-1 && mq_getattr(mq, &attr) == 0) queued = attr.mq_curmsgs;
+    
+    uint64_t done_now = 0, done_before = 0;
+    for (int w = 0; w < stats->num_workers; w++) {
+        done_now += cur->processed[w];
+        done_before += prev->processed[w];
+    }
+    
+    if (clear) printf("\033[H\033[2J");
+    printf("image_top — %s    tempo: %.1fs    workers ativos: %d/%d\n", SHM_NAME,
+           spawn_ns ? (cur->ns - spawn_ns) / 1e9 : 0.0, totals.workers_active, stats->num_workers);
+    printf("Tarefas: %d    processadas: %d    falhas: %d    na fila: ",
+           __atomic_load_n(&stats->total_images, __ATOMIC_RELAXED),
+           totals.processed_images, totals.failed_images);
+    if (queued >= 0) printf("%ld\n", queued);
+    else printf("?\n");
+    printf("Taxa: %.1f img/s    decodificado: %.1f MB/s\n",
+           dt > 0 ? (done_now - done_before) / dt : 0.0,
+           dt > 0 ? (cur->decoded_bytes - prev->decoded_bytes) / dt / MB : 0.0);
+    printf("Memória reservada: %.1f MB", __atomic_load_n(&stats->mem_reserved, __ATOMIC_RELAXED) / MB);
+    if (stats->mem_budget > 0) printf(" de %.1f MB", stats->mem_budget / MB);
+    printf("    pico: %.1f MB\n\n", __atomic_load_n(&stats->mem_reserved_peak, __ATOMIC_RELAXED) / MB);
+    
+    printf("  WORKER  ESTADO      IMAGENS  FALHAS   IMG/S  RESERVA   RSS MB  ARQUIVO\n");
+    for (int w = 0; w < stats->num_workers; w++) {
+        const worker_stats_t *ws = &stats->workers[w];
+        char file[MAX_FILENAME];
+        stats_get_current_file(ws, file);
+        
+        const char *state = __atomic_load_n(&ws->done, __ATOMIC_RELAXED) ? "encerrado" :
+                            __atomic_load_n(&ws->active, __ATOMIC_RELAXED) ? "ativo" : "iniciando";
+        printf("  %6d  %-10s %8llu %7llu %7.1f %8.1f %8.1f  %s\n", w, state,
+               (unsigned long long)__atomic_load_n(&ws->processed, __ATOMIC_RELAXED),
+               (unsigned long long)__atomic_load_n(&ws->failed, __ATOMIC_RELAXED),
+               dt > 0 ? (cur->processed[w] - prev->processed[w]) / dt : 0.0,
+               __atomic_load_n(&ws->mem_reserved, __ATOMIC_RELAXED) / MB,
+               __atomic_load_n(&ws->rss_bytes, __ATOMIC_RELAXED) / MB, file);
+    }
+    
+    // Histogramas somados (cópia local; leituras relaxadas)
+    static worker_latency_t merged;
+    stats_merge_latency(stats, &merged);
+    
+    printf("\n");
+    print_label("Latência (ms)", 24);
+    printf("      p50      p99      máx\n");
+    print_latency_line("decodificação", &merged.decode);
+    for (int f = 0; f < NUM_THREADS; f++) {
+        char label[64];
+        snprintf(label, sizeof(label), "%s: filtro", get_filter_name(f));
+        print_latency_line(label, &merged.filter[f]);
+    }
+    for (int f = 0; f < NUM_THREADS; f++) {
+        char label[64];
+        snprintf(label, sizeof(label), "%s: codificação", get_filter_name(f));
+        print_latency_line(label, &merged.encode[f]);
+    }
+    print_latency_line("total por imagem", &merged.total);
+    fflush(stdout);
+}
+
+// ============================================================
+// MAIN
+// ============================================================
+
+int main(int argc, char *argv[]) {
+    int interval_ms = 1000, once = 0;
+    
+    static const struct option long_opts[] = {
+        {"interval", required_argument, NULL, 'i'},
+        {"once",     no_argument,       NULL, '1'},
+        {"help",     no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:1h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'i':
+                interval_ms = atoi(optarg);
+                if (interval_ms < 50) interval_ms = 50;
+                break;
+            case '1': once = 1; break;
+            case 'h': print_top_usage(argv[0]); return 0;
+            default:  print_top_usage(argv[0]); return 1;
+        }
+    }
+    
+    const shared_stats_t *stats = attach_stats();
+    if (!stats) return 1;
+    
+    // Fila só para consultar a profundidade (nunca recebe)
+    mqd_t mq = mq_open(QUEUE_NAME, O_RDONLY | O_NONBLOCK);
+    
+    sample_t prev, cur;
+    take_sample(stats, &prev);
+    if (once) {
+        // Uma janela curta para as taxas
+        usleep(interval_ms < 500 ? interval_ms * 1000 : 500000);
+        take_sample(stats, &cur);
+        draw(stats, mq, &prev, &cur, 0);
+        return 0;
+    }
+    
+    // Sem SA_RESTART: o sinal interrompe o poll e o laço sai na hora
+    struct sigaction sa = { .sa_handler = on_signal };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    tty_enter();
+    
+    while (!stop_requested) {
+        struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+        int ready = poll(&pfd, tty_raw ? 1 : 0, interval_ms);
+        if (stop_requested) break;
+        if (ready > 0) {
+            char c;
+            if (read(STDIN_FILENO, &c, 1) == 1 && (c == 'q' || c == 'Q')) break;
+            continue;
+        }
+        
+        take_sample(stats, &cur);
+        draw(stats, mq, &prev, &cur, 1);
+        prev = cur;
+        
+        // Lote terminado: todos os workers encerraram
+        int done = 0;
+        for (int w = 0; w < stats->num_workers; w++) {
+            done += __atomic_load_n(&stats->workers[w].done, __ATOMIC_RELAXED);
+        }
+        if (done == stats->num_workers) {
+            printf("\nTodos os workers encerraram.");
+            break;
+        }
+    }
+    
+    tty_leave();
+    if (mq != (mqd_t)-1) mq_close(mq);
+    munmap((void*)stats, sizeof(shared_stats_t));
+    return 0;
+}
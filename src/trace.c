@@ -0,0 +1,142 @@
+#include "trace.h"
+#include "filters.h"
+
+trace_shm_t *g_trace = NULL;
+
+// Cabeçalho e buffers alinhados à linha de cache (um escritor por buffer)
+#define ALIGN_CACHE(n)  (((n) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1))
+
+static const char *const event_names[TRACE_NUM_EVENTS] = {
+    [TRACE_DISPATCH]   = "despacho",
+    [TRACE_QUEUE_WAIT] = "espera na fila",
+    [TRACE_IO_WAIT]    = "espera de I/O",
+    [TRACE_MEM_WAIT]   = "espera de memória",
+    [TRACE_DECODE]     = "decodificação",
+    [TRACE_IMAGE]      = "imagem",
+    [TRACE_FILTER]     = "filtro",
+    [TRACE_ENCODE]     = "codificação",
+    [TRACE_WRITE]      = "gravação",
+};
+
+static trace_buffer_t* buffer_at(int index) {
+    return (trace_buffer_t*)((char*)g_trace + ALIGN_CACHE(sizeof(trace_shm_t)) + (size_t)index * g_trace->buffer_size);
+}
+
+int trace_init(int events_per_thread, int num_workers) {
+    // Só os buffers desta execução, do tamanho pedido (-N)
+    size_t buffer_size = ALIGN_CACHE(sizeof(trace_buffer_t) + (size_t)events_per_thread * sizeof(trace_event_t));
+    int num_buffers = 1 + num_workers * TRACE_SLOTS;
+    size_t map_size = ALIGN_CACHE(sizeof(trace_shm_t)) + (size_t)num_buffers * buffer_size;
+    
+    // Mapeamento anônimo compartilhado: os workers o herdam no fork e
+    // nada fica em /dev/shm. As páginas só são ocupadas quando escritas
+    void *mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap (trace)");
+        return -1;
+    }
+    
+    g_trace = (trace_shm_t*)mem;
+    g_trace->origin_ns = monotonic_ns();
+    g_trace->buffer_size = buffer_size;
+    g_trace->map_size = map_size;
+    g_trace->num_workers = num_workers;
+    for (int i = 0; i < num_buffers; i++) {
+        buffer_at(i)->capacity = (uint32_t)events_per_thread;
+    }
+    return 0;
+}
+
+trace_buffer_t* trace_coordinator_buffer(void) {
+    return g_trace ? buffer_at(0) : NULL;
+}
+
+trace_buffer_t* trace_worker_buffer(int worker_id, int slot) {
+    return g_trace ? buffer_at(1 + worker_id * TRACE_SLOTS + slot) : NULL;
+}
+
+// ============================================================
+// EXPORTAÇÃO (formato JSON do Chrome trace)
+// ============================================================
+
+static void write_metadata(FILE *f, int *first, int pid, int tid, const char *kind, const char *name) {
+    fprintf(f, "%s\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\",\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",", pid, tid, kind, name);
+    *first = 0;
+}
+
+static void write_buffer(FILE *f, int *first, const trace_buffer_t *buf, int pid, int tid) {
+    uint32_t count = __atomic_load_n(&buf->count, __ATOMIC_ACQUIRE);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        const trace_event_t *ev = &buf->events[i];
+        if (ev->id >= TRACE_NUM_EVENTS) continue;
+        
+        // Eventos "X" (completos): início e duração em µs
+        const char *name = ev->id == TRACE_FILTER ? get_filter_name(ev->arg) : event_names[ev->id];
+        double ts = ev->start_ns >= g_trace->origin_ns ? (ev->start_ns - g_trace->origin_ns) / 1e3 : 0;
+        double dur = ev->end_ns >= ev->start_ns ? (ev->end_ns - ev->start_ns) / 1e3 : 0;
+        
+        fprintf(f, "%s\n{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"tarefa\":%d", *first ? "" : ",", pid, tid, name, ts, dur, ev->task_id);
+        if (ev->id == TRACE_ENCODE || ev->id == TRACE_WRITE) {
+            fprintf(f, ",\"filtro\":\"%s\"", get_filter_name(ev->arg));
+        }
+        fputs("}}", f);
+        *first = 0;
+    }
+}
+
+int trace_write_json(const char *path, const pid_t *worker_pids, uint32_t *dropped) {
+    *dropped = 0;
+    if (!g_trace) return 0;
+    
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        LOG_ERROR("Falha ao criar %s: %s", path, strerror(errno));
+        return -1;
+    }
+    
+    // Descartes somados antes, para irem também no próprio arquivo
+    int num_buffers = 1 + g_trace->num_workers * TRACE_SLOTS;
+    for (int i = 0; i < num_buffers; i++) {
+        *dropped += buffer_at(i)->dropped;
+    }
+    
+    // pid 0 = coordenador, pid 1 + i = worker i; tid 1 + filtro nos workers
+    int first = 1;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"eventos_por_thread\":%u,"
+            "\"eventos_descartados\":%u},\"traceEvents\":[", buffer_at(0)->capacity, *dropped);
+    
+    write_metadata(f, &first, 0, 0, "process_name", "coordenador");
+    write_buffer(f, &first, trace_coordinator_buffer(), 0, 0);
+    
+    for (int w = 0; w < g_trace->num_workers; w++) {
+        char name[64];
+        snprintf(name, sizeof(name), "worker %d (PID %d)", w, (int)worker_pids[w]);
+        write_metadata(f, &first, w + 1, 0, "process_name", name);
+        write_metadata(f, &first, w + 1, 0, "thread_name", "principal");
+        for (int t = 0; t < NUM_THREADS; t++) {
+            write_metadata(f, &first, w + 1, t + 1, "thread_name", get_filter_name(t));
+        }
+        
+        for (int slot = 0; slot < TRACE_SLOTS; slot++) {
+            write_buffer(f, &first, trace_worker_buffer(w, slot), w + 1, slot);
+        }
+    }
+    
+    fputs("\n]}\n", f);
+    if (fclose(f) != 0) {
+        LOG_ERROR("Falha ao gravar %s", path);
+        return -1;
+    }
+    return 0;
+}
+
+void trace_shutdown(void) {
+    if (g_trace) {
+        munmap(g_trace, g_trace->map_size);
+        g_trace = NULL;
+    }
+}
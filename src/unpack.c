@@ -0,0 +1,156 @@
+// image_unpack - Lista, confere e extrai pacotes de saída (image_processor -P)
+//
+// Lê o índice do fim de cada pacote; os dados são mapeados e gravados
+// direto do mapeamento, conferindo o CRC-32 de cada entrada.
+
+#include "common.h"
+#include "pack.h"
+#include "deflate.h"
+#include "fs_util.h"
+#include <getopt.h>
+
+typedef enum {
+    MODE_LIST,
+    MODE_TEST,
+    MODE_EXTRACT
+} unpack_mode_t;
+
+static void print_unpack_usage(const char *prog) {
+    printf("Uso: %s [opções] PACOTE...\n", prog);
+    printf("  -l, --list            Lista as entradas: tamanho, CRC-32 e nome (padrão)\n");
+    printf("  -t, --test            Confere o CRC-32 de cada entrada\n");
+    printf("  -x, --extract         Extrai as entradas (CRC-32 conferido)\n");
+    printf("  -C, --dir DIR         Diretório de destino da extração (padrão: .)\n");
+    printf("  -n, --name PREFIXO    Só as entradas cujo nome começa com PREFIXO\n");
+    printf("  -h, --help            Mostra esta ajuda\n");
+}
+
+// Nomes vêm do arquivo: nada absoluto nem com ".." sai do destino
+static int safe_name(const char *name) {
+    if (name[0] == '/') return 0;
+    for (const char *p = name; *p; ) {
+        size_t len = strcspn(p, "/");
+        if (len == 0 || (len == 2 && p[0] == '.' && p[1] == '.')) return 0;
+        p += len;
+        if (*p == '/') p++;
+    }
+    return 1;
+}
+
+static int extract_entry(const char *dir, const pack_entry_t *e, const unsigned char *data) {
+    char *path = NULL;
+    if (asprintf(&path, "%s/%s", dir, e->name) == -1) return -1;
+    
+    int result = make_parent_dirs(path);
+    int fd = result == 0 ? open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    const unsigned char *p = data;
+    size_t left = e->length;
+    while (fd != -1 && left > 0) {
+        ssize_t n = write(fd, p, left);
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1) break;
+        p += n;
+        left -= n;
+    }
+    result = fd != -1 && left == 0 ? 0 : -1;
+    if (fd != -1 && close(fd) == -1) result = -1;
+    if (result != 0) LOG_ERROR("%s: %s", path, strerror(errno));
+    free(path);
+    return result;
+}
+
+// Processa um pacote; retorna o número de entradas com erro (-1 = ilegível)
+static int unpack_file(const char *path, unpack_mode_t mode, const char *dir, const char *prefix) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        LOG_ERROR("%s: %s", path, strerror(errno));
+        if (fd != -1) close(fd);
+        return -1;
+    }
+    
+    uint32_t count = 0;
+    pack_entry_t *entries = pack_read_index(fd, (uint64_t)st.st_size, &count);
+    unsigned char *map = NULL;
+    if (entries && mode != MODE_LIST && st.st_size > 0) {
+        map = (unsigned char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) map = NULL;
+    }
+    close(fd);
+    if (!entries || (mode != MODE_LIST && !map)) {
+        LOG_ERROR("%s: pacote inválido ou incompleto (sem índice)", path);
+        free(entries);
+        return -1;
+    }
+    
+    int errors = 0;
+    uint32_t selected = 0;
+    uint64_t bytes = 0;
+    size_t prefix_len = prefix ? strlen(prefix) : 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const pack_entry_t *e = &entries[i];
+        if (prefix && strncmp(e->name, prefix, prefix_len) != 0) continue;
+        selected++;
+        bytes += e->length;
+        
+        if (mode == MODE_LIST) {
+            printf("%12llu  %08x  %s\n", (unsigned long long)e->length, e->crc, e->name);
+            continue;
+        }
+        
+        const unsigned char *data = map + e->offset;
+        if (crc32_update(0, data, e->length) != e->crc) {
+            LOG_ERROR("%s: %s: CRC-32 não confere", path, e->name);
+            errors++;
+        } else if (mode == MODE_EXTRACT && !safe_name(e->name)) {
+            LOG_ERROR("%s: nome recusado: %s", path, e->name);
+            errors++;
+        } else if (mode == MODE_EXTRACT && extract_entry(dir, e, data) != 0) {
+            errors++;
+        }
+    }
+    
+    printf("%s: %u entrada(s), %.1f MB%s\n", path, selected, bytes / (1024.0 * 1024.0),
+           mode == MODE_LIST ? "" : errors ? ", com erros" : ", ok");
+    if (map) munmap(map, st.st_size);
+    free(entries);
+    return errors;
+}
+
+int main(int argc, char *argv[]) {
+    unpack_mode_t mode = MODE_LIST;
+    const char *dir = ".", *prefix = NULL;
+    
+    static const struct option long_opts[] = {
+        {"list",    no_argument,       NULL, 'l'},
+        {"test",    no_argument,       NULL, 't'},
+        {"extract", no_argument,       NULL, 'x'},
+        {"dir",     required_argument, NULL, 'C'},
+        {"name",    required_argument, NULL, 'n'},
+        {"help",    no_argument,       NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    
+    int opt;
+    while ((opt = getopt_long(argc, argv, "ltxC:n:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'l': mode = MODE_LIST; break;
+            case 't': mode = MODE_TEST; break;
+            case 'x': mode = MODE_EXTRACT; break;
+            case 'C': dir = optarg; break;
+            case 'n': prefix = optarg; break;
+            case 'h': print_unpack_usage(argv[0]); return 0;
+            default:  print_unpack_usage(argv[0]); return 1;
+        }
+    }
+    if (optind >= argc) {
+        print_unpack_usage(argv[0]);
+        return 1;
+    }
+    
+    int failed = 0;
+    for (int i = optind; i < argc; i++) {
+        if (unpack_file(argv[i], mode, dir, prefix) != 0) failed = 1;
+    }
+    return failed;
+}
@@ -2,103 +2,491 @@
 #include "filters.h"
 #include "ipc_manager.h"
 #include "sync_manager.h"
+#include "histogram.h"
+#include "trace.h"
+#include "perf_counters.h"
+#include "config.h"
+#include "event_log.h"
+#include "mem_budget.h"
+#include "jpeg_decode.h"
+#include "pack.h"
+#include "fs_util.h"
 
-// Envia log para o coordenador via pipe
-void send_log(int pipe_fd, int worker_id, const char *message) {
-    char buffer[512];
-    snprintf(buffer, sizeof(buffer), "[WORKER %d] %s\n", worker_id, message);
-    write(pipe_fd, buffer, strlen(buffer));
+// Registra um evento no anel de log do worker (formatado pelo coordenador)
+static void worker_log(worker_context_t *ctx, int event, int task_id, const char *name,
+                       int64_t arg0, int64_t arg1) {
+    log_emit(&ctx->stats->log, ctx->worker_id, event, task_id, name, arg0, arg1);
 }
 
-// Atualiza estatísticas na memória compartilhada
-void update_stats(shared_stats_t *stats, int success, double elapsed_time) {
-    mutex_lock(&stats->mutex);
+// Atualiza os contadores do worker na memória compartilhada. Só este
+// processo escreve no bloco: sem trava, apenas atomics relaxados
+void update_stats(worker_stats_t *ws, int success, double elapsed_time) {
+    __atomic_fetch_add(success ? &ws->processed : &ws->failed, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ws->busy_us, (uint64_t)(elapsed_time * 1e6), __ATOMIC_RELAXED);
+}
+
+// ============================================================
+// POOL DE THREADS DE FILTRO
+// ============================================================
+
+// Uma thread por filtro, na ordem FILTER_GRAYSCALE, FILTER_BLUR, FILTER_RESIZE, FILTER_CROP
+static void* (*const filter_funcs[NUM_THREADS])(void*) = {
+    thread_grayscale, thread_blur, thread_resize, thread_crop
+};
+
+// Cada worker é um processo: um único pool por processo
+static filter_pool_t worker_pool;
+
+static void* pool_thread(void *arg) {
+    thread_args_t *targs = (thread_args_t*)arg;
+    filter_pool_t *pool = &worker_pool;
+    unsigned long seen = 0;
     
-    if (success) {
-        stats->processed_images++;
-    } else {
-        stats->failed_images++;
+    // Contadores por thread (-p): o grupo mede só esta thread
+    perf_group_t perf;
+    if (g_config.perf) {
+        if (perf_group_open(&perf) == 0) {
+            targs->perf = &perf;
+        } else {
+            LOG_ERROR("Worker %d: contadores indisponíveis para %s: %s", targs->worker_id,
+                      get_filter_name(targs->filter_type), perf_strerror(errno));
+        }
     }
-    stats->total_processing_time += elapsed_time;
     
-    // Sinaliza que uma imagem foi processada
-    cond_signal(&stats->cond_finished);
+    while (1) {
+        // Aguarda uma nova imagem (ou o encerramento)
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->shutdown) {
+            pthread_cond_wait(&pool->start_cond, &pool->lock);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        
+        if (targs->output_file) {
+            filter_funcs[targs->thread_id](targs);
+        } else {
+            targs->success = 0;
+        }
+        
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) {
+            pthread_cond_signal(&pool->done_cond);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    
+    if (targs->perf) {
+        targs->perf = NULL;
+        perf_group_close(&perf);
+    }
+    free(targs->scratch);
+    free(targs->verify_scratch);
+    free(targs->encoded);
+    return NULL;
+}
+
+// Cria as threads de filtro uma única vez, na inicialização do worker
+static filter_pool_t* pool_start(int worker_id) {
+    filter_pool_t *pool = &worker_pool;
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
     
-    mutex_unlock(&stats->mutex);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pool->args[i].thread_id = i;
+        pool->args[i].filter_type = i;
+        pool->args[i].worker_id = worker_id;
+        pool->args[i].output_fd = -1;
+        pool->args[i].trace = trace_worker_buffer(worker_id, i + 1);
+        
+        if (pthread_create(&pool->threads[i], NULL, pool_thread, &pool->args[i]) != 0) {
+            LOG_ERROR("Worker %d: Falha ao criar thread %d", worker_id, i);
+            // Encerra as que já foram criadas
+            pthread_mutex_lock(&pool->lock);
+            pool->shutdown = 1;
+            pthread_cond_broadcast(&pool->start_cond);
+            pthread_mutex_unlock(&pool->lock);
+            for (int j = 0; j < i; j++) {
+                pthread_join(pool->threads[j], NULL);
+            }
+            return NULL;
+        }
+    }
+    
+    return pool;
+}
+
+// Libera as threads para a imagem atual e aguarda todas terminarem
+static void pool_run(filter_pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->pending = NUM_THREADS;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start_cond);
+    while (pool->pending > 0) {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_stop(filter_pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->start_cond);
+    pthread_mutex_unlock(&pool->lock);
+    
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->start_cond);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+// ============================================================
+// PROCESSAMENTO
+// ============================================================
+
+// Mapeia a imagem que o coordenador mantém em memória (memfd),
+// reabrindo o descritor dele via /proc
+static void* map_coordinator_fd(int src_fd, size_t *len) {
+    char proc_path[64];
+    snprintf(proc_path, sizeof(proc_path), "/proc/%d/fd/%d", (int)getppid(), src_fd);
+    
+    int fd = open(proc_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        LOG_ERROR("Falha ao abrir %s: %s", proc_path, strerror(errno));
+        return NULL;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size <= 0) {
+        LOG_ERROR("Imagem em memória vazia ou inválida (fd %d)", src_fd);
+        close(fd);
+        return NULL;
+    }
+    
+    void *buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (buf == MAP_FAILED) {
+        perror("mmap (entrada)");
+        return NULL;
+    }
+    *len = st.st_size;
+    return buf;
+}
+
+// Reserva a memória estimada da tarefa antes da decodificação. Sem espaço
+// no orçamento (-M), a tarefa fica adiada aqui. Com o cabeçalho ilegível
+// nada é reservado: a decodificação falha logo em seguida
+static void admit_task(worker_context_t *ctx, const task_message_t *task,
+                       int have_info, int width, int height, int channels) {
+    if (!have_info) return;
+    
+    uint64_t bytes = mem_estimate(width, height, channels, task->filter_mask, g_config.verify,
+                                  g_config.encode_threads);
+    uint64_t wait_start = ctx->trace ? monotonic_ns() : 0;
+    uint64_t waited = mem_reserve(ctx->stats, ctx->worker_id, bytes);
+    ctx->mem_reserved = bytes;
+    
+    if (waited > 0) {
+        trace_record(ctx->trace, TRACE_MEM_WAIT, 0, task->task_id, wait_start, monotonic_ns());
+        worker_log(ctx, LOG_EV_MEM_DEFERRED, task->task_id, task->filename,
+                   (int64_t)bytes, (int64_t)(waited / 1000));
+    }
+}
+
+// Só o resize pedido e -R: um JPEG pode sair da decodificação já pela
+// metade (IDCT reduzida), sem decodificar os 75% de pixels que o resize
+// descarta. Opcional porque muda a saída (média da área em vez do vizinho
+// mais próximo). Com outros filtros a imagem cheia é necessária de
+// qualquer jeito, e o resize sobre ela custa menos que uma segunda
+// passada de IDCT e cor. Com -V o resize precisa passar pelos kernels
+// comparados
+static int wants_scaled_decode(const task_message_t *task) {
+    return g_config.scaled_decode && !g_config.verify &&
+           task->filter_mask == (1 << FILTER_RESIZE);
+}
+
+// Região pedida na tarefa (crop=) ou a padrão do processo (-C)
+static const crop_spec_t* task_crop(const task_message_t *task) {
+    const crop_spec_t *spec = &task->crop;
+    return spec->width > 0 || spec->percent > 0 ? spec : &g_config.crop;
+}
+
+// Decodifica a imagem do arquivo (buf NULL) ou da memória. Só o resize:
+// JPEG reduzido a 1/2. Só o crop: JPEG decodificado só na região, que
+// vem das dimensões do cabeçalho. Nesses casos *decoded_output = 1: a
+// imagem já é a saída do filtro. Sem JPEG, cai na decodificação completa
+static unsigned char* decode_task_image(worker_context_t *ctx, const task_message_t *task,
+                                        const char *path, const unsigned char *buf, size_t len,
+                                        int have_info, int *width, int *height, int *channels,
+                                        int *decoded_output) {
+    worker_stats_t *ws = &ctx->stats->workers[ctx->worker_id];
+    unsigned char *image = NULL;
+    int x, y, w, h;
+    
+    if (wants_scaled_decode(task)) {
+        image = buf ? jpeg_load_scaled_from_memory(buf, len, 2, width, height, channels)
+                    : jpeg_load_scaled(path, 2, width, height, channels);
+        if (image) __atomic_fetch_add(&ws->scaled_decodes, 1, __ATOMIC_RELAXED);
+    } else if (g_config.partial_decode && task->filter_mask == (1 << FILTER_CROP) && have_info &&
+               crop_region(task_crop(task), *width, *height, &x, &y, &w, &h) == 0) {
+        image = buf ? jpeg_load_region_from_memory(buf, len, x, y, w, h, channels)
+                    : jpeg_load_region(path, x, y, w, h, channels);
+        if (image) {
+            *width = w;
+            *height = h;
+            __atomic_fetch_add(&ws->region_decodes, 1, __ATOMIC_RELAXED);
+        }
+    }
+    
+    *decoded_output = image != NULL;
+    if (image) return image;
+    return buf ? load_image_from_memory(buf, len, width, height, channels)
+               : load_image(path, width, height, channels);
+}
+
+// Contabiliza o resultado e, para tarefas da API, avisa o coordenador
+// (anexando os memfds de saída, se houver)
+static int finish_task(worker_context_t *ctx, const task_message_t *task,
+                       int success, int output_mask, double elapsed,
+                       const int *out_fds, int nfds) {
+    // A imagem e as saídas já foram liberadas: devolve a reserva
+    if (ctx->mem_reserved > 0) {
+        mem_release(ctx->stats, ctx->worker_id, ctx->mem_reserved);
+        ctx->mem_reserved = 0;
+    }
+    mem_sample_rss(&ctx->stats->workers[ctx->worker_id]);
+    
+    update_stats(&ctx->stats->workers[ctx->worker_id], success, elapsed);
+    notify_progress(ctx->progress_fd);
+    
+    if (task->job_id > 0) {
+        job_done_t done = {
+            .job_id = task->job_id,
+            .worker_id = ctx->worker_id,
+            .status = success ? 0 : -1,
+            .output_mask = output_mask,
+            .elapsed = elapsed
+        };
+        send_job_done(ctx->done_fd, &done, out_fds, nfds);
+    }
+    
+    return success ? 0 : -1;
+}
+
+// memfd que recebe uma saída codificada (modo TASK_OUT_MEMORY)
+static int create_output_memfd(const char *name) {
+    int fd = memfd_create(name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        perror("memfd_create (saída)");
+    }
+    return fd;
+}
+
+// Depois de escrito, o memfd é selado: quem o recebe pode mapeá-lo
+// sem risco de ver o conteúdo mudar ou encolher
+static void seal_output_memfd(int fd) {
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        perror("fcntl (F_ADD_SEALS)");
+    }
 }
 
 // Processa uma imagem: carrega, cria threads para filtros, salva
-int process_image(worker_context_t *ctx, const char *filename) {
+int process_image(worker_context_t *ctx, const task_message_t *task) {
     struct timespec start, end;
     clock_gettime(CLOCK_MONOTONIC, &start);
     
-    char input_path[MAX_PATH];
-    snprintf(input_path, sizeof(input_path), "%s/%s", INPUT_DIR, filename);
+    const char *filename = task->filename;
+    const char *out_prefix = task_output_prefix(task);
+    int width, height, channels;
+    unsigned char *image = NULL;
+    worker_latency_t *lat = &ctx->stats->latency[ctx->worker_id];
+    struct timespec decode_start, decoded;
+    int decoded_output = 0;
     
-    // Adquire semáforo para I/O (leitura)
-    sem_acquire(ctx->io_sem);
+    trace_record(ctx->trace, TRACE_QUEUE_WAIT, 0, task->task_id,
+                 task->enqueue_ns, timespec_ns(&start));
     
-    // Carrega imagem
-    int width, height, channels;
-    unsigned char *image = load_image(input_path, &width, &height, &channels);
+    if (task->src_fd >= 0) {
+        // Imagem enviada pela API: já está em memória, sem I/O de disco
+        size_t len = 0;
+        void *buf = map_coordinator_fd(task->src_fd, &len);
+        int have_info = 0;
+        if (buf) {
+            have_info = image_info_from_memory(buf, len, &width, &height, &channels) == 0;
+            admit_task(ctx, task, have_info, width, height, channels);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &decode_start);
+        if (buf) {
+            image = decode_task_image(ctx, task, NULL, buf, len, have_info,
+                                      &width, &height, &channels, &decoded_output);
+            munmap(buf, len);
+        }
+    } else {
+        // Caminhos absolutos (lista de arquivos) são usados como estão
+        char *input_path = NULL;
+        if (filename[0] == '/') {
+            input_path = strdup(filename);
+        } else if (asprintf(&input_path, "%s/%s", INPUT_DIR, filename) == -1) {
+            input_path = NULL;
+        }
+        if (!input_path) {
+            LOG_ERROR("Worker %d: Falha ao alocar caminho", ctx->worker_id);
+            return finish_task(ctx, task, 0, 0, 0, NULL, 0);
+        }
+        
+        // Admissão pelo cabeçalho, antes do semáforo: quem espera memória
+        // não segura a vez de I/O de outro worker
+        int have_info = image_info(input_path, &width, &height, &channels) == 0;
+        admit_task(ctx, task, have_info, width, height, channels);
+        
+        // Adquire semáforo para I/O (leitura)
+        uint64_t io_wait_ns = ctx->trace ? monotonic_ns() : 0;
+        sem_acquire(ctx->io_sem);
+        
+        // Carrega imagem (a espera pelo semáforo fica fora da etapa)
+        clock_gettime(CLOCK_MONOTONIC, &decode_start);
+        trace_record(ctx->trace, TRACE_IO_WAIT, 0, task->task_id,
+                     io_wait_ns, timespec_ns(&decode_start));
+        image = decode_task_image(ctx, task, input_path, NULL, 0, have_info,
+                                  &width, &height, &channels, &decoded_output);
+        
+        sem_release(ctx->io_sem);
+        free(input_path);
+    }
     
-    sem_release(ctx->io_sem);
+    clock_gettime(CLOCK_MONOTONIC, &decoded);
+    hist_record_interval(&lat->decode, &decode_start, &decoded);
+    trace_record(ctx->trace, TRACE_DECODE, 0, task->task_id,
+                 timespec_ns(&decode_start), timespec_ns(&decoded));
     
     if (!image) {
-        char log_msg[256];
-        snprintf(log_msg, sizeof(log_msg), "Falha ao carregar: %s", filename);
-        send_log(ctx->pipe_fd, ctx->worker_id, log_msg);
-        update_stats(ctx->stats, 0, 0);
-        return -1;
+        worker_log(ctx, LOG_EV_LOAD_FAILED, task->task_id, filename, 0, 0);
+        return finish_task(ctx, task, 0, 0, 0, NULL, 0);
     }
+    __atomic_fetch_add(&ctx->stats->workers[ctx->worker_id].decoded_bytes,
+                       (uint64_t)width * height * channels, __ATOMIC_RELAXED);
     
-    LOG_WORKER(ctx->worker_id, "Processando: %s (%dx%d)", filename, width, height);
+    worker_log(ctx, LOG_EV_TASK_START, task->task_id, filename, width, height);
     
-    // Prepara nome base para saída
-    char basename[MAX_FILENAME];
-    get_basename(filename, basename);
-    remove_extension(basename);
+    // Saídas em memória dispensam o nome base e os diretórios de saída
+    int out_memory = task->flags & TASK_OUT_MEMORY;
     
-    // Configura argumentos para as 3 threads
-    pthread_t threads[NUM_THREADS];
-    thread_args_t args[NUM_THREADS];
+    // Prepara nome base para saída: prefixo da API ou espelho da entrada
+    char *stem = NULL;
+    if (!out_memory) {
+        if (out_prefix[0] != '\0') {
+            stem = strdup(out_prefix);
+        } else {
+            while (*filename == '/') filename++;
+            if (asprintf(&stem, "%s/%s", OUTPUT_DIR, filename) == -1) {
+                stem = NULL;
+            } else {
+                remove_extension(stem);
+            }
+        }
+        if (!stem) {
+            free_image(image);
+            return finish_task(ctx, task, 0, 0, 0, NULL, 0);
+        }
+    }
     
-    const char *filter_names[] = {"grayscale", "blur", "resize"};
-    void* (*filter_funcs[])(void*) = {thread_grayscale, thread_blur, thread_resize};
+    // Região do crop (a decodificação por região já entregou o recorte)
+    int crop_x = 0, crop_y = 0, crop_w = width, crop_h = height;
+    if (!decoded_output && (task->filter_mask & (1 << FILTER_CROP)) &&
+        crop_region(task_crop(task), width, height, &crop_x, &crop_y, &crop_w, &crop_h) != 0) {
+        crop_w = crop_h = 0;
+    }
+    
+    // Configura argumentos para as threads do pool
+    filter_pool_t *pool = ctx->pool;
+    thread_args_t *args = pool->args;
     
     for (int i = 0; i < NUM_THREADS; i++) {
         args[i].image_data = image;
         args[i].width = width;
         args[i].height = height;
         args[i].channels = channels;
-        args[i].filter_type = i;
-        args[i].thread_id = i;
-        args[i].worker_id = ctx->worker_id;
         args[i].success = 0;
+        args[i].input_file = filename;
+        args[i].output_file = NULL;
+        args[i].output_fd = -1;
+        args[i].latency = lat;
+        args[i].task_id = task->task_id;
+        args[i].perf_totals = &ctx->stats->perf[ctx->worker_id][i];
+        args[i].verify = g_config.verify ? &ctx->stats->verify[ctx->worker_id][i] : NULL;
+        args[i].verify_tolerance = g_config.verify_tolerance;
+        args[i].encode_stats = &ctx->stats->encode[ctx->worker_id][i];
+        args[i].profile = task_profile(task, i);
+        args[i].decoded_output = decoded_output;
+        args[i].crop_x = crop_x;
+        args[i].crop_y = crop_y;
+        args[i].crop_width = crop_w;
+        args[i].crop_height = crop_h;
+        
+        // Filtros fora da máscara não geram saída
+        if (!(task->filter_mask & (1 << i))) continue;
         
-        strncpy(args[i].input_file, filename, MAX_FILENAME - 1);
-        snprintf(args[i].output_file, sizeof(args[i].output_file),
-                 "%s/%s_%s.jpg", OUTPUT_DIR, basename, filter_names[i]);
+        if (out_memory) {
+            // O nome identifica o memfd e define o formato de codificação
+            if (asprintf(&args[i].output_file, "%s.%s",
+                         get_filter_name(i), task_output_ext(task, i)) == -1) {
+                args[i].output_file = NULL;
+                continue;
+            }
+            args[i].output_fd = create_output_memfd(args[i].output_file);
+            if (args[i].output_fd == -1) {
+                free(args[i].output_file);
+                args[i].output_file = NULL;
+            }
+        } else if (asprintf(&args[i].output_file, "%s_%s.%s",
+                            stem, get_filter_name(i), task_output_ext(task, i)) == -1) {
+            args[i].output_file = NULL;
+        }
     }
     
-    // Cria as 3 threads de filtro
-    for (int i = 0; i < NUM_THREADS; i++) {
-        if (pthread_create(&threads[i], NULL, filter_funcs[i], &args[i]) != 0) {
-            LOG_ERROR("Worker %d: Falha ao criar thread %d", ctx->worker_id, i);
-        }
+    // Subdiretórios da saída (todas as saídas ficam no mesmo diretório;
+    // no pacote, o caminho é só o nome da entrada)
+    if (stem && strchr(stem, '/') && !ctx->pack && make_parent_dirs(stem) != 0) {
+        LOG_ERROR("Falha ao criar diretórios de %s: %s", stem, strerror(errno));
     }
+    free(stem);
+    
+    // Aplica os filtros em paralelo (threads já criadas)
+    pool_run(pool);
     
-    // Aguarda todas as threads terminarem
+    // Verifica resultado de cada thread
     int all_success = 1;
+    int output_mask = 0;
+    int out_fds[NUM_THREADS];
+    int nfds = 0;
     for (int i = 0; i < NUM_THREADS; i++) {
-        pthread_join(threads[i], NULL);
+        if (!(task->filter_mask & (1 << i))) continue;
+        free(args[i].output_file);
+        args[i].output_file = NULL;
         
+        worker_log(ctx, LOG_EV_FILTER, task->task_id, NULL, i, args[i].success);
         if (args[i].success) {
-            LOG_WORKER(ctx->worker_id, "  Thread %d: %s ✓", i, filter_names[i]);
+            output_mask |= 1 << i;
+            if (args[i].output_fd >= 0) {
+                seal_output_memfd(args[i].output_fd);
+                out_fds[nfds++] = args[i].output_fd;
+                args[i].output_fd = -1;
+            }
         } else {
-            LOG_WORKER(ctx->worker_id, "  Thread %d: %s ✗", i, filter_names[i]);
             all_success = 0;
         }
+        if (args[i].output_fd >= 0) {
+            close(args[i].output_fd);
+            args[i].output_fd = -1;
+        }
     }
     
     // Libera imagem original
@@ -106,23 +494,27 @@ int process_image(worker_context_t *ctx, const char *filename) {
     
     clock_gettime(CLOCK_MONOTONIC, &end);
     double elapsed = get_time_diff(start, end);
+    hist_record_interval(&lat->total, &start, &end);
+    trace_record(ctx->trace, TRACE_IMAGE, 0, task->task_id,
+                 timespec_ns(&start), timespec_ns(&end));
     
-    LOG_WORKER(ctx->worker_id, "Concluído: %s (%.2fs)", filename, elapsed);
-    
-    // Envia log via pipe
-    char log_msg[256];
-    snprintf(log_msg, sizeof(log_msg), "Processado: %s em %.2fs", filename, elapsed);
-    send_log(ctx->pipe_fd, ctx->worker_id, log_msg);
-    
-    // Atualiza estatísticas
-    update_stats(ctx->stats, all_success, elapsed);
+    worker_log(ctx, LOG_EV_TASK_DONE, task->task_id, filename,
+               (int64_t)(elapsed * 1e6), all_success);
     
-    return all_success ? 0 : -1;
+    // Atualiza estatísticas (e entrega os memfds ao coordenador)
+    int result = finish_task(ctx, task, all_success, output_mask, elapsed, out_fds, nfds);
+    for (int i = 0; i < nfds; i++) {
+        close(out_fds[i]);
+    }
+    return result;
 }
 
 // Função principal do worker
-void worker_main(int worker_id, int pipe_fd) {
-    LOG_WORKER(worker_id, "PID %d iniciado", getpid());
+void worker_main(int worker_id, int done_fd, int progress_fd) {
+    // O handler do coordenador não vale para o worker: Ctrl+C chega ao
+    // grupo inteiro, mas quem decide o encerramento é o coordenador
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, SIG_DFL);
     
     // Conecta aos recursos IPC
     mqd_t mq = open_message_queue(QUEUE_NAME);
@@ -146,20 +538,58 @@ void worker_main(int worker_id, int pipe_fd) {
         exit(1);
     }
     
+    // Threads de filtro ficam prontas antes da primeira tarefa
+    filter_pool_t *pool = pool_start(worker_id);
+    if (!pool) {
+        close_semaphore(io_sem);
+        cleanup_ipc_worker(mq, stats, shm_fd);
+        exit(1);
+    }
+    
+    // Pacote próprio (-P): as threads de filtro deste worker anexam nele
+    char *pack_path = NULL;
+    pack_writer_t *pack = NULL;
+    if (g_config.pack_prefix) {
+        if (asprintf(&pack_path, "%s-%d.pack", g_config.pack_prefix, worker_id) == -1) {
+            pack_path = NULL;
+        }
+        pack = pack_path ? pack_create(pack_path) : NULL;
+        if (!pack) {
+            LOG_ERROR("Worker %d: Falha ao criar pacote %s: %s", worker_id,
+                      pack_path ? pack_path : g_config.pack_prefix, strerror(errno));
+            pool_stop(pool);
+            close_semaphore(io_sem);
+            cleanup_ipc_worker(mq, stats, shm_fd);
+            exit(1);
+        }
+        for (int i = 0; i < NUM_THREADS; i++) {
+            pool->args[i].pack = pack;
+        }
+    }
+    
     // Contexto do worker
     worker_context_t ctx = {
         .worker_id = worker_id,
         .msg_queue = mq,
         .stats = stats,
         .io_sem = io_sem,
-        .pipe_fd = pipe_fd
+        .done_fd = done_fd,
+        .progress_fd = progress_fd,
+        .pool = pool,
+        .trace = trace_worker_buffer(worker_id, 0),
+        .pack = pack
     };
+    worker_log(&ctx, LOG_EV_STARTED, -1, NULL, getpid(), 0);
     
     // Marca como ativo
-    mutex_lock(&stats->mutex);
-    stats->workers_active++;
-    strncpy(stats->current_files[worker_id], "idle", MAX_FILENAME);
-    mutex_unlock(&stats->mutex);
+    worker_stats_t *ws = &stats->workers[worker_id];
+    __atomic_store_n(&ws->active, 1, __ATOMIC_RELAXED);
+    stats_set_current_file(ws, "idle");
+    
+    // Pronto para consumir a fila: avisa o coordenador, que aguarda no futex
+    __atomic_store_n(&ws->ready_ns, monotonic_ns(), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats->workers_ready, 1, __ATOMIC_RELEASE);
+    futex_wake_all(&stats->workers_ready);
     
     // Loop consumidor: recebe tarefas da fila
     task_message_t msg;
@@ -170,36 +600,47 @@ void worker_main(int worker_id, int pipe_fd) {
         
         // Mensagem de término
         if (msg.msg_type == MSG_TERMINATE) {
-            LOG_WORKER(worker_id, "Recebido sinal de término");
+            worker_log(&ctx, LOG_EV_TERMINATE, -1, NULL, 0, 0);
             break;
         }
         
         // Atualiza arquivo atual
-        mutex_lock(&stats->mutex);
-        strncpy(stats->current_files[worker_id], msg.filename, MAX_FILENAME);
-        mutex_unlock(&stats->mutex);
+        stats_set_current_file(ws, msg.filename);
         
         // Processa a imagem
-        process_image(&ctx, msg.filename);
+        process_image(&ctx, &msg);
         
         // Volta para idle
-        mutex_lock(&stats->mutex);
-        strncpy(stats->current_files[worker_id], "idle", MAX_FILENAME);
-        mutex_unlock(&stats->mutex);
+        stats_set_current_file(ws, "idle");
     }
     
-    // Marca como inativo
-    mutex_lock(&stats->mutex);
-    stats->workers_active--;
-    stats->workers_done++;
-    cond_signal(&stats->cond_finished);
-    mutex_unlock(&stats->mutex);
+    // O pacote fecha depois das threads de filtro e antes de publicar o
+    // término: sem índice e trailer ele é ilegível e as imagens deste
+    // worker contam como falhas
+    pool_stop(pool);
+    int status = 0;
+    if (pack && pack_close(pack, NULL) != 0) {
+        LOG_ERROR("Worker %d: Falha ao gravar pacote %s: %s", worker_id, pack_path, strerror(errno));
+        uint64_t lost = __atomic_load_n(&ws->processed, __ATOMIC_RELAXED);
+        __atomic_store_n(&ws->failed, ws->failed + lost, __ATOMIC_RELAXED);
+        __atomic_store_n(&ws->processed, 0, __ATOMIC_RELAXED);
+        status = EXIT_FAILURE;
+    }
+    free(pack_path);
+    
+    // Último registro antes de desmapear a memória compartilhada
+    worker_log(&ctx, LOG_EV_FINISHED, -1, NULL, 0, 0);
+    
+    // Marca como inativo (release: contadores já publicados)
+    __atomic_store_n(&ws->active, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ws->done, 1, __ATOMIC_RELEASE);
+    notify_progress(progress_fd);
     
     // Limpeza
     close_semaphore(io_sem);
     cleanup_ipc_worker(mq, stats, shm_fd);
-    close(pipe_fd);
+    close(done_fd);
+    close(progress_fd);
     
-    LOG_WORKER(worker_id, "Finalizado");
-    exit(0);
+    exit(status);
 }
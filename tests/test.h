@@ -0,0 +1,52 @@
+#ifndef TEST_H
+#define TEST_H
+
+// Testes unitários (make test): cada tests/test_*.c é um executável que
+// liga com os objetos do image_processor e retorna 0 se tudo passou
+
+#include "common.h"
+
+static int test_checks = 0;
+static int test_failures = 0;
+
+// Registra a falha e continua: um executável mostra todas de uma vez
+#define CHECK(cond) do {                                                    \
+    test_checks++;                                                          \
+    if (!(cond)) {                                                          \
+        fprintf(stderr, "  %s:%d: falhou: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++;                                                    \
+    }                                                                       \
+} while (0)
+
+// Destino em memória para as funções de codificação (encode_write_func)
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+} test_buffer_t;
+
+static inline void test_buffer_write(void *context, void *data, int size) {
+    test_buffer_t *b = (test_buffer_t*)context;
+    if (b->len + (size_t)size > b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 4096;
+        while (cap < b->len + (size_t)size) cap *= 2;
+        unsigned char *grown = (unsigned char*)realloc(b->data, cap);
+        if (!grown) abort();
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, (size_t)size);
+    b->len += (size_t)size;
+}
+
+// Resumo do executável; usado como valor de retorno do main
+static inline int test_summary(const char *name) {
+    if (test_failures) {
+        printf("%-16s %d de %d verificações falharam\n", name, test_failures, test_checks);
+        return 1;
+    }
+    printf("%-16s ok (%d verificações)\n", name, test_checks);
+    return 0;
+}
+
+#endif // TEST_H
@@ -0,0 +1,185 @@
+// Testes do crop: parse_crop_spec, crop_region e a decodificação JPEG só
+// da região (jpeg_decode.c), que deve ser idêntica ao recorte da imagem cheia
+
+#include "test.h"
+#include "filters.h"
+#include "jpeg_decode.h"
+#include "image_encode.h"
+
+// ============================================================
+// ESPECIFICAÇÃO E REGIÃO
+// ============================================================
+
+static void test_parse_crop_spec(void) {
+    crop_spec_t c;
+    
+    CHECK(parse_crop_spec("50%", &c) == 0);
+    CHECK(c.percent == 50 && c.x == 0 && c.y == 0);
+    CHECK(parse_crop_spec("100%", &c) == 0 && c.percent == 100);
+    CHECK(parse_crop_spec("640x480", &c) == 0);
+    CHECK(c.percent == 0 && c.width == 640 && c.height == 480 && c.x == -1 && c.y == -1);
+    CHECK(parse_crop_spec("640x480+10+20", &c) == 0);
+    CHECK(c.width == 640 && c.height == 480 && c.x == 10 && c.y == 20);
+    CHECK(parse_crop_spec("1x1+0+0", &c) == 0);
+    
+    // Rejeitados sem alterar *spec
+    static const char *const bad[] = {
+        "", "0%", "101%", "-5%", "50", "50%x", "0x480", "640x0", "640x", "x480",
+        "640x480+10", "640x480+-1+0", "640x480+1+2+3", "640x480 ", "abc"
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        crop_spec_t before = { .percent = 7 }, spec = before;
+        int rc = parse_crop_spec(bad[i], &spec);
+        if (rc == 0) fprintf(stderr, "  aceitou \"%s\"\n", bad[i]);
+        CHECK(rc != 0);
+        CHECK(memcmp(&spec, &before, sizeof(spec)) == 0);
+    }
+}
+
+static void check_region(const char *spec_text, int img_w, int img_h,
+                         int x, int y, int w, int h) {
+    crop_spec_t spec;
+    int rx = -1, ry = -1, rw = -1, rh = -1;
+    CHECK(parse_crop_spec(spec_text, &spec) == 0);
+    CHECK(crop_region(&spec, img_w, img_h, &rx, &ry, &rw, &rh) == 0);
+    if (rx != x || ry != y || rw != w || rh != h) {
+        fprintf(stderr, "  %s em %dx%d: %d,%d %dx%d (esperado %d,%d %dx%d)\n",
+                spec_text, img_w, img_h, rx, ry, rw, rh, x, y, w, h);
+    }
+    CHECK(rx == x && ry == y && rw == w && rh == h);
+}
+
+static void test_crop_region(void) {
+    // Porcentagem: centrado, arredondado para baixo, mínimo 1
+    check_region("50%", 640, 480, 160, 120, 320, 240);
+    check_region("50%", 101, 51, 25, 13, 50, 25);
+    check_region("100%", 33, 17, 0, 0, 33, 17);
+    check_region("1%", 50, 50, 24, 24, 1, 1);
+    
+    // Tamanho fixo: centrado sem deslocamento, limitado à imagem
+    check_region("100x50", 640, 480, 270, 215, 100, 50);
+    check_region("1000x1000", 640, 480, 0, 0, 640, 480);
+    check_region("640x480+0+0", 640, 480, 0, 0, 640, 480);
+    
+    // Deslocamento: corta o que passa da borda
+    check_region("100x100+600+450", 640, 480, 600, 450, 40, 30);
+    check_region("10x10+639+479", 640, 480, 639, 479, 1, 1);
+    
+    // Começa fora da imagem: região vazia
+    crop_spec_t spec;
+    int x, y, w, h;
+    CHECK(parse_crop_spec("10x10+640+0", &spec) == 0);
+    CHECK(crop_region(&spec, 640, 480, &x, &y, &w, &h) == -1);
+    CHECK(parse_crop_spec("10x10+0+480", &spec) == 0);
+    CHECK(crop_region(&spec, 640, 480, &x, &y, &w, &h) == -1);
+}
+
+// ============================================================
+// DECODIFICAÇÃO POR REGIÃO
+// ============================================================
+
+// Gradiente com ruído: detalhe em todas as frequências e croma variando
+static unsigned char* synthetic(int width, int height, int channels) {
+    unsigned char *d = (unsigned char*)malloc((size_t)width * height * channels);
+    uint32_t seed = 3;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            for (int c = 0; c < channels; c++) {
+                seed = seed * 1103515245u + 12345u;
+                int v = (x * (c + 1) * 3 + y * (3 - c) * 2) / 3 + (int)((seed >> 27) & 15);
+                d[((size_t)y * width + x) * channels + c] = (unsigned char)v;
+            }
+        }
+    }
+    return d;
+}
+
+// Compara a região decodificada com o recorte da decodificação completa
+static void check_decode_region(const char *name, const test_buffer_t *jpg,
+                                int x, int y, int w, int h) {
+    int fw, fh, fc, rc = 0;
+    unsigned char *full = load_image_from_memory(jpg->data, jpg->len, &fw, &fh, &fc);
+    unsigned char *region = jpeg_load_region_from_memory(jpg->data, jpg->len, x, y, w, h, &rc);
+    CHECK(full != NULL && region != NULL);
+    if (!full || !region) {
+        free_image(full);
+        free(region);
+        return;
+    }
+    CHECK(rc == fc);
+    
+    unsigned char *expected = (unsigned char*)malloc((size_t)w * h * fc);
+    apply_crop(full, fw, fc, x, y, w, h, expected);
+    int same = memcmp(region, expected, (size_t)w * h * fc) == 0;
+    if (!same) fprintf(stderr, "  %s: região %d,%d %dx%d difere do recorte\n", name, x, y, w, h);
+    CHECK(same);
+    
+    free(expected);
+    free(region);
+    free_image(full);
+}
+
+static void check_regions(const char *name, const test_buffer_t *jpg, int width, int height) {
+    // Cantos, bordas de MCU (8 e 16), deslocamentos ímpares, 1×1 e a imagem toda
+    const int regions[][4] = {
+        { 0, 0, width, height },
+        { 0, 0, 1, 1 },
+        { width - 1, height - 1, 1, 1 },
+        { 0, 0, 17, 9 },
+        { 15, 15, 2, 2 },
+        { 16, 8, 32, 16 },
+        { 7, 13, 101, 77 },
+        { width / 2, height / 3, width - width / 2, height / 2 },
+        { 3, height - 20, width - 6, 20 },
+    };
+    for (size_t i = 0; i < sizeof(regions) / sizeof(regions[0]); i++) {
+        check_decode_region(name, jpg, regions[i][0], regions[i][1], regions[i][2], regions[i][3]);
+    }
+}
+
+static void test_region_decode(void) {
+    const int width = 333, height = 251;
+    
+    // RGB 4:2:0 e 4:4:4, numa faixa e em faixas com RSTn; cinza
+    for (int channels = 1; channels <= 3; channels += 2) {
+        unsigned char *pixels = synthetic(width, height, channels);
+        for (int subsample = 0; subsample <= 1; subsample++) {
+            for (int threads = 1; threads <= 4; threads += 3) {
+                encode_profile_t profile = ENCODE_PROFILE_DEFAULT;
+                profile.jpeg_subsample = (signed char)subsample;
+                test_buffer_t jpg = { 0 };
+                CHECK(encode_jpeg(test_buffer_write, &jpg, width, height, channels, pixels,
+                                  &profile, threads) == 0);
+                
+                char name[64];
+                snprintf(name, sizeof(name), "%d canais, %s, %d faixa(s)", channels,
+                         subsample ? "4:2:0" : "4:4:4", threads);
+                check_regions(name, &jpg, width, height);
+                free(jpg.data);
+            }
+        }
+        free(pixels);
+    }
+    
+    // Fotografia real
+    FILE *f = fopen(INPUT_DIR "/sample_1.jpg", "rb");
+    CHECK(f != NULL);
+    if (!f) return;
+    test_buffer_t jpg = { 0 };
+    unsigned char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) test_buffer_write(&jpg, chunk, (int)n);
+    fclose(f);
+    
+    int w, h, c;
+    CHECK(image_info_from_memory(jpg.data, jpg.len, &w, &h, &c) == 0);
+    check_regions("sample_1.jpg", &jpg, w, h);
+    free(jpg.data);
+}
+
+int main(void) {
+    test_parse_crop_spec();
+    test_crop_region();
+    test_region_decode();
+    return test_summary("crop");
+}
@@ -0,0 +1,232 @@
+// Testes do deflate (deflate.c) e do PNG rápido (image_encode.c)
+
+#include "test.h"
+#include "deflate.h"
+#include "image_encode.h"
+#include "stb_image.h"
+
+#define FIXTURE_W   256
+#define FIXTURE_H   256
+
+// Blocos lisos de 32×32 com cor diferente por canal (telas, diagramas)
+static unsigned char* flat_blocks(void) {
+    unsigned char *d = (unsigned char*)malloc(FIXTURE_W * FIXTURE_H * 3);
+    for (int y = 0; y < FIXTURE_H; y++) {
+        for (int x = 0; x < FIXTURE_W; x++) {
+            for (int c = 0; c < 3; c++) {
+                d[(y * FIXTURE_W + x) * 3 + c] = (unsigned char)((x / 32 + y / 32) * 40 + c * 70);
+            }
+        }
+    }
+    return d;
+}
+
+// Texto repetido com alguns bytes trocados (repetições a várias distâncias)
+static unsigned char* text_like(size_t len) {
+    static const char text[] = "the quick brown fox jumps over the lazy dog; ";
+    unsigned char *d = (unsigned char*)malloc(len);
+    uint32_t seed = 7;
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        d[i] = (seed >> 28) == 0 ? (unsigned char)(seed >> 20) : (unsigned char)text[i % (sizeof(text) - 1)];
+    }
+    return d;
+}
+
+static unsigned char* noise(size_t len) {
+    unsigned char *d = (unsigned char*)malloc(len);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        d[i] = (unsigned char)(seed >> 24);
+    }
+    return d;
+}
+
+static size_t deflate_size(const unsigned char *data, size_t len, int level) {
+    size_t out_len = 0;
+    unsigned char *out = deflate_zlib(data, len, level, &out_len);
+    free(out);
+    return out ? out_len : SIZE_MAX;
+}
+
+static void count_bytes(void *context, void *data, int size) {
+    (void)data;
+    *(size_t*)context += (size_t)size;
+}
+
+static size_t png_size(const unsigned char *pixels, int width, int height, int level, int filter) {
+    encode_profile_t profile = { .jpeg_quality = 90, .jpeg_subsample = 1, .png_level = (signed char)level,
+                                 .png_filter = (signed char)filter, .png_fast = 1 };
+    size_t size = 0;
+    if (encode_png(count_bytes, &size, width, height, 3, pixels, &profile) != 0) return SIZE_MAX;
+    return size;
+}
+
+// O tamanho nunca cresce com o nível
+static void check_levels_deflate(const char *name, const unsigned char *data, size_t len) {
+    size_t prev = deflate_size(data, len, 1);
+    for (int level = 2; level <= 9; level++) {
+        size_t size = deflate_size(data, len, level);
+        if (size > prev) fprintf(stderr, "  %s: nível %d = %zu > nível %d = %zu\n", name, level, size, level - 1, prev);
+        CHECK(size <= prev);
+        prev = size;
+    }
+}
+
+static void test_levels(void) {
+    unsigned char *flat = flat_blocks();
+    
+    // Caso do PNG padrão (filtro adaptativo) sobre blocos lisos
+    size_t prev = png_size(flat, FIXTURE_W, FIXTURE_H, 1, -1);
+    for (int level = 2; level <= 9; level++) {
+        size_t size = png_size(flat, FIXTURE_W, FIXTURE_H, level, -1);
+        CHECK(size <= prev);
+        prev = size;
+    }
+    
+    // Com qualquer filtro fixo, nenhum nível perde do RLE (nível 1)
+    for (int filter = 0; filter <= 4; filter++) {
+        size_t rle = png_size(flat, FIXTURE_W, FIXTURE_H, 1, filter);
+        for (int level = 2; level <= 9; level++) {
+            CHECK(png_size(flat, FIXTURE_W, FIXTURE_H, level, filter) <= rle);
+        }
+    }
+    free(flat);
+    
+    size_t len = FIXTURE_W * FIXTURE_H * 3;
+    unsigned char *text = text_like(len);
+    check_levels_deflate("texto", text, len);
+    free(text);
+    
+    unsigned char *random = noise(len);
+    check_levels_deflate("ruído", random, len);
+    free(random);
+    
+    int w, h, ch;
+    unsigned char *photo = stbi_load(INPUT_DIR "/sample_1.jpg", &w, &h, &ch, 3);
+    CHECK(photo != NULL);
+    if (photo) {
+        check_levels_deflate("foto", photo, (size_t)w * h * 3);
+        stbi_image_free(photo);
+    }
+}
+
+// ============================================================
+// IDA E VOLTA
+// ============================================================
+
+// Descomprime com o inflate do stb_image e confere bytes e Adler-32
+static void check_roundtrip(const char *name, const unsigned char *data, size_t len, int level) {
+    size_t out_len = 0;
+    unsigned char *z = deflate_zlib(data, len, level, &out_len);
+    CHECK(z != NULL && out_len >= 6);
+    if (!z) return;
+    
+    int plain_len = -1;
+    char *plain = stbi_zlib_decode_malloc((const char*)z, (int)out_len, &plain_len);
+    int same = plain && plain_len == (int)len && (len == 0 || memcmp(plain, data, len) == 0);
+    if (!same) fprintf(stderr, "  %s: nível %d não volta ao original\n", name, level);
+    CHECK(same);
+    
+    // O stb_image não confere o Adler-32 do fim do fluxo
+    uint32_t adler = (uint32_t)z[out_len - 4] << 24 | (uint32_t)z[out_len - 3] << 16 |
+                     (uint32_t)z[out_len - 2] << 8 | z[out_len - 1];
+    CHECK(adler == adler32_update(1, data, len));
+    
+    free(plain);
+    free(z);
+}
+
+static void test_roundtrip(void) {
+    // Vetores conhecidos das somas
+    CHECK(crc32_update(0, (const unsigned char*)"123456789", 9) == 0xCBF43926u);
+    CHECK(adler32_update(1, (const unsigned char*)"Wikipedia", 9) == 0x11E60398u);
+    CHECK(crc32_update(crc32_update(0, (const unsigned char*)"1234", 4), (const unsigned char*)"56789", 5) ==
+          0xCBF43926u);
+    
+    size_t len = FIXTURE_W * FIXTURE_H * 3;
+    unsigned char *text = text_like(len);
+    unsigned char *random = noise(len);
+    unsigned char *flat = flat_blocks();
+    unsigned char *zeros = (unsigned char*)calloc(1, len);
+    
+    for (int level = 1; level <= 9; level++) {
+        check_roundtrip("vazio", zeros, 0, level);
+        check_roundtrip("1 byte", text, 1, level);
+        // Em torno dos limites de comprimento (3, 258) e do hash (4 bytes)
+        check_roundtrip("3 bytes", zeros, 3, level);
+        check_roundtrip("4 bytes", zeros, 4, level);
+        check_roundtrip("258 zeros", zeros, 258, level);
+        check_roundtrip("259 zeros", zeros, 259, level);
+        check_roundtrip("zeros", zeros, len, level);
+        check_roundtrip("texto", text, len, level);
+        check_roundtrip("ruído", random, len, level);
+        check_roundtrip("blocos", flat, len, level);
+        // Janela de 32 KiB: repetições no limite da distância
+        check_roundtrip("texto 40 KiB", text, 40000, level);
+    }
+    
+    free(zeros);
+    free(flat);
+    free(random);
+    free(text);
+}
+
+// PNG rápido e stb, cada filtro e nível, de 1 a 4 canais: os pixels voltam iguais
+static void test_png_roundtrip(void) {
+    const int width = 61, height = 37;
+    unsigned char *src = noise((size_t)width * height * 4);
+    unsigned char *flat = flat_blocks();
+    
+    for (int channels = 1; channels <= 4; channels++) {
+        for (int pattern = 0; pattern < 2; pattern++) {
+            // Ruído e blocos lisos (recortados para width × height)
+            unsigned char *pixels = (unsigned char*)malloc((size_t)width * height * channels);
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width * channels; x++) {
+                    pixels[(size_t)y * width * channels + x] = pattern == 0
+                        ? src[(size_t)y * width * channels + x]
+                        : flat[((size_t)y * FIXTURE_W) * 3 + x % (FIXTURE_W * 3)];
+                }
+            }
+            
+            for (int fast = 0; fast <= 1; fast++) {
+                for (int filter = -1; filter <= 4; filter++) {
+                    for (int level = 1; level <= 9; level += 4) {
+                        encode_profile_t profile = ENCODE_PROFILE_DEFAULT;
+                        profile.png_fast = (signed char)fast;
+                        profile.png_filter = (signed char)filter;
+                        profile.png_level = (signed char)level;
+                        test_buffer_t png = { 0 };
+                        CHECK(encode_png(test_buffer_write, &png, width, height, channels, pixels,
+                                         &profile) == 0);
+                        
+                        int w, h, c;
+                        unsigned char *back = stbi_load_from_memory(png.data, (int)png.len, &w, &h, &c, 0);
+                        int same = back && w == width && h == height && c == channels &&
+                                   memcmp(back, pixels, (size_t)width * height * channels) == 0;
+                        if (!same) {
+                            fprintf(stderr, "  PNG %s, %d canais, filtro %d, nível %d não volta ao original\n",
+                                    fast ? "fast" : "stb", channels, filter, level);
+                        }
+                        CHECK(same);
+                        stbi_image_free(back);
+                        free(png.data);
+                    }
+                }
+            }
+            free(pixels);
+        }
+    }
+    
+    free(flat);
+    free(src);
+}
+
+int main(void) {
+    test_levels();
+    test_roundtrip();
+    test_png_roundtrip();
+    return test_summary("deflate");
+}
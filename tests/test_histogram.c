@@ -0,0 +1,142 @@
+// Testes dos histogramas de latência (histogram.c): faixas, percentis,
+// soma entre workers e buckets cumulativos
+
+#include "test.h"
+#include "histogram.h"
+
+// Erro relativo máximo das faixas log-lineares (1/16)
+#define MAX_REL_ERROR   (1.0 / HIST_SUB_BUCKETS)
+
+static latency_hist_t* new_hist(void) {
+    latency_hist_t *h = (latency_hist_t*)aligned_alloc(CACHE_LINE_SIZE, sizeof(latency_hist_t));
+    memset(h, 0, sizeof(*h));
+    return h;
+}
+
+static void test_record(void) {
+    latency_hist_t *h = new_hist();
+    
+    CHECK(hist_percentile(h, 50) == 0);
+    
+    hist_record(h, 5);
+    hist_record(h, 0);
+    hist_record(h, 1000);
+    CHECK(h->count == 3 && h->sum_us == 1005 && h->max_us == 1000);
+    
+    // Intervalo negativo (relógio) conta como 0
+    struct timespec a = { .tv_sec = 10, .tv_nsec = 500000000 }, b = { .tv_sec = 10, .tv_nsec = 0 };
+    hist_record_interval(h, &a, &b);
+    CHECK(h->count == 4 && h->sum_us == 1005);
+    struct timespec c = { .tv_sec = 12, .tv_nsec = 250000 };
+    hist_record_interval(h, &b, &c);
+    CHECK(h->count == 5 && h->sum_us == 1005 + 2000250);
+    free(h);
+}
+
+static void test_percentiles(void) {
+    latency_hist_t *h = new_hist();
+    
+    // Abaixo de 16 µs cada valor tem faixa própria: exato
+    for (uint64_t v = 1; v <= 10; v++) hist_record(h, v);
+    CHECK(hist_percentile(h, 10) == 1);
+    CHECK(hist_percentile(h, 50) == 5);
+    CHECK(hist_percentile(h, 51) == 6);
+    CHECK(hist_percentile(h, 100) == 10);
+    CHECK(hist_percentile(h, 0) == 1);
+    free(h);
+    
+    // 1..100000 µs: cada percentil fica no limite superior da faixa, nunca
+    // abaixo do valor exato e no máximo ~6% acima
+    h = new_hist();
+    for (uint64_t v = 1; v <= 100000; v++) hist_record(h, v);
+    const double pcts[] = { 1, 10, 25, 50, 75, 90, 99, 99.9, 100 };
+    for (size_t i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++) {
+        uint64_t exact = (uint64_t)(pcts[i] / 100.0 * 100000 + 0.5);
+        uint64_t got = hist_percentile(h, pcts[i]);
+        int ok = got >= exact && got <= exact + exact * MAX_REL_ERROR + 1;
+        if (!ok) fprintf(stderr, "  p%g = %llu (exato %llu)\n", pcts[i],
+                         (unsigned long long)got, (unsigned long long)exact);
+        CHECK(ok);
+    }
+    // O máximo limita a última faixa
+    CHECK(hist_percentile(h, 100) == 100000);
+    
+    // Percentis não decrescem
+    uint64_t prev = 0;
+    for (double p = 0; p <= 100; p += 0.5) {
+        uint64_t v = hist_percentile(h, p);
+        CHECK(v >= prev);
+        prev = v;
+    }
+    free(h);
+    
+    // Valores enormes caem na última faixa sem estourar
+    h = new_hist();
+    hist_record(h, UINT64_MAX / 2);
+    hist_record(h, 1ull << 40);
+    CHECK(hist_percentile(h, 100) == UINT64_MAX / 2);
+    CHECK(hist_percentile(h, 50) >= 1ull << 40);
+    free(h);
+}
+
+static void test_merge(void) {
+    latency_hist_t *a = new_hist(), *b = new_hist(), *all = new_hist(), *merged = new_hist();
+    
+    // Duas metades de uma distribuição somadas = a distribuição inteira
+    uint32_t seed = 5;
+    for (int i = 0; i < 20000; i++) {
+        seed = seed * 1103515245u + 12345u;
+        uint64_t v = (seed >> 8) % 50000;
+        hist_record(i & 1 ? a : b, v);
+        hist_record(all, v);
+    }
+    hist_merge(merged, a);
+    hist_merge(merged, b);
+    CHECK(merged->count == all->count);
+    CHECK(merged->sum_us == all->sum_us);
+    CHECK(merged->max_us == all->max_us);
+    CHECK(memcmp(merged->buckets, all->buckets, sizeof(all->buckets)) == 0);
+    for (int p = 0; p <= 100; p += 5) CHECK(hist_percentile(merged, p) == hist_percentile(all, p));
+    
+    // Somar um vazio não muda nada
+    latency_hist_t *empty = new_hist();
+    hist_merge(merged, empty);
+    CHECK(merged->count == all->count && merged->max_us == all->max_us);
+    free(empty);
+    
+    free(merged);
+    free(all);
+    free(b);
+    free(a);
+}
+
+static void test_count_at_most(void) {
+    latency_hist_t *h = new_hist();
+    for (uint64_t v = 0; v < 16; v++) hist_record(h, v);
+    hist_record(h, 100);
+    hist_record(h, 1000);
+    
+    CHECK(hist_count_at_most(h, 0) == 1);
+    CHECK(hist_count_at_most(h, 15) == 16);
+    // A faixa que contém o limite fica para o limite seguinte
+    CHECK(hist_count_at_most(h, 100) == 16);
+    CHECK(hist_count_at_most(h, 200) == 17);
+    CHECK(hist_count_at_most(h, 1000000) == 18);
+    
+    // Cumulativo: nunca decresce
+    uint64_t prev = 0;
+    for (uint64_t le = 1; le < 2000000; le *= 2) {
+        uint64_t n = hist_count_at_most(h, le);
+        CHECK(n >= prev && n <= h->count);
+        prev = n;
+    }
+    free(h);
+}
+
+int main(void) {
+    test_record();
+    test_percentiles();
+    test_merge();
+    test_count_at_most();
+    return test_summary("histogram");
+}
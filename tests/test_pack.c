@@ -0,0 +1,286 @@
+// Testes dos pacotes de saída (pack.c): gravação, leitura do índice e
+// rejeição de pacotes truncados ou adulterados
+
+#include "test.h"
+#include "pack.h"
+#include "deflate.h"
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#define RECORD_SIZE     22      // Registro do índice sem o nome (pack.c)
+#define NUM_THREADS_APPEND 4
+#define APPENDS_PER_THREAD 50
+
+// ============================================================
+// AUXILIARES
+// ============================================================
+
+static char tmp_dir[] = "/tmp/test_pack.XXXXXX";
+
+// Bytes num memfd, para pack_read_index
+static pack_entry_t* read_index_bytes(const unsigned char *data, size_t len, uint32_t *count) {
+    int fd = memfd_create("pack", MFD_CLOEXEC);
+    if (fd == -1) return NULL;
+    pack_entry_t *entries = NULL;
+    if (write(fd, data, len) == (ssize_t)len) entries = pack_read_index(fd, len, count);
+    close(fd);
+    return entries;
+}
+
+static unsigned char* read_file(const char *path, size_t *len) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    test_buffer_t b = { 0 };
+    unsigned char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) test_buffer_write(&b, chunk, (int)n);
+    fclose(f);
+    *len = b.len;
+    return b.data;
+}
+
+static void put_le(unsigned char *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+// Pacote montado à mão: dados, índice (já serializado) e trailer com o
+// CRC certo, para testar as validações que o CRC não cobre
+static size_t craft_pack(unsigned char *out, const unsigned char *data, size_t data_len,
+                         const unsigned char *index, size_t index_len, uint32_t count) {
+    memcpy(out, "IMGPACK1", 8);
+    memcpy(out + 8, data, data_len);
+    uint64_t index_offset = 8 + data_len;
+    memcpy(out + index_offset, index, index_len);
+    unsigned char *t = out + index_offset + index_len;
+    put_le(t, index_offset, 8);
+    put_le(t + 8, count, 4);
+    put_le(t + 12, crc32_update(0, index, index_len), 4);
+    memcpy(t + 16, "IMGPKEND", 8);
+    return index_offset + index_len + PACK_TRAILER_SIZE;
+}
+
+static size_t index_record(unsigned char *r, uint64_t offset, uint64_t length, uint32_t crc,
+                           const char *name, size_t name_len) {
+    put_le(r, offset, 8);
+    put_le(r + 8, length, 8);
+    put_le(r + 16, crc, 4);
+    put_le(r + 20, name_len, 2);
+    memcpy(r + RECORD_SIZE, name, name_len);
+    return RECORD_SIZE + name_len;
+}
+
+// ============================================================
+// GRAVAÇÃO E LEITURA
+// ============================================================
+
+typedef struct {
+    pack_writer_t *pack;
+    int thread;
+} append_arg_t;
+
+static void* append_thread(void *arg) {
+    append_arg_t *a = (append_arg_t*)arg;
+    for (int i = 0; i < APPENDS_PER_THREAD; i++) {
+        char name[64], body[256];
+        snprintf(name, sizeof(name), "t%d/saida_%03d.jpg", a->thread, i);
+        int len = snprintf(body, sizeof(body), "conteúdo %d/%d ", a->thread, i);
+        // Dois blocos: cabeçalho e corpo, como as saídas PPM
+        struct iovec iov[2] = {
+            { .iov_base = body, .iov_len = (size_t)len },
+            { .iov_base = name, .iov_len = strlen(name) }
+        };
+        if (pack_append(a->pack, name, iov, 2) != 0) return (void*)1;
+    }
+    return NULL;
+}
+
+static void test_write_read(void) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/lote.pack", tmp_dir);
+    pack_writer_t *pack = pack_create(path);
+    CHECK(pack != NULL);
+    if (!pack) return;
+    
+    // Nomes inválidos são recusados
+    struct iovec one = { .iov_base = "x", .iov_len = 1 };
+    CHECK(pack_append(pack, "", &one, 1) != 0);
+    
+    pthread_t tids[NUM_THREADS_APPEND];
+    append_arg_t args[NUM_THREADS_APPEND];
+    for (int t = 0; t < NUM_THREADS_APPEND; t++) {
+        args[t] = (append_arg_t){ .pack = pack, .thread = t };
+        CHECK(pthread_create(&tids[t], NULL, append_thread, &args[t]) == 0);
+    }
+    for (int t = 0; t < NUM_THREADS_APPEND; t++) {
+        void *rc = NULL;
+        pthread_join(tids[t], &rc);
+        CHECK(rc == NULL);
+    }
+    
+    // Uma saída vazia também é uma entrada
+    CHECK(pack_append(pack, "vazia.bin", NULL, 0) == 0);
+    uint32_t written = 0;
+    CHECK(pack_close(pack, &written) == 0);
+    CHECK(written == NUM_THREADS_APPEND * APPENDS_PER_THREAD + 1);
+    
+    size_t len = 0;
+    unsigned char *file = read_file(path, &len);
+    CHECK(file != NULL);
+    if (!file) return;
+    
+    uint32_t count = 0;
+    pack_entry_t *entries = read_index_bytes(file, len, &count);
+    CHECK(entries != NULL && count == written);
+    
+    // Cada entrada: dados dentro do arquivo, CRC certo, conteúdo esperado;
+    // cada nome aparece uma vez
+    int seen[NUM_THREADS_APPEND][APPENDS_PER_THREAD] = { { 0 } };
+    for (uint32_t i = 0; entries && i < count; i++) {
+        const pack_entry_t *e = &entries[i];
+        CHECK(e->offset >= PACK_HEADER_SIZE && e->offset + e->length <= len);
+        CHECK(crc32_update(0, file + e->offset, e->length) == e->crc);
+        
+        int t, n;
+        if (sscanf(e->name, "t%d/saida_%d.jpg", &t, &n) == 2) {
+            CHECK(t >= 0 && t < NUM_THREADS_APPEND && n >= 0 && n < APPENDS_PER_THREAD);
+            if (t >= 0 && t < NUM_THREADS_APPEND && n >= 0 && n < APPENDS_PER_THREAD) seen[t][n]++;
+            char expected[512];
+            int elen = snprintf(expected, sizeof(expected), "conteúdo %d/%d %s", t, n, e->name);
+            CHECK(e->length == (uint64_t)elen && memcmp(file + e->offset, expected, elen) == 0);
+        } else {
+            CHECK(strcmp(e->name, "vazia.bin") == 0 && e->length == 0);
+        }
+    }
+    for (int t = 0; t < NUM_THREADS_APPEND; t++) {
+        for (int n = 0; n < APPENDS_PER_THREAD; n++) CHECK(seen[t][n] == 1);
+    }
+    
+    // Um byte de dado trocado: o índice segue válido e o CRC da entrada acusa
+    if (entries && count > 0) {
+        const pack_entry_t *e = &entries[0];
+        file[e->offset] ^= 0x01;
+        CHECK(crc32_update(0, file + e->offset, e->length) != e->crc);
+        file[e->offset] ^= 0x01;
+    }
+    free(entries);
+    
+    // Todo prefixo (pacote de worker interrompido) é recusado
+    int accepted = 0;
+    for (size_t cut = 0; cut < len; cut++) {
+        pack_entry_t *part = read_index_bytes(file, cut, &count);
+        if (part) accepted++;
+        free(part);
+    }
+    CHECK(accepted == 0);
+    
+    // Qualquer byte trocado no índice ou no trailer é recusado
+    uint64_t index_offset = 0;
+    for (int i = 0; i < 8; i++) index_offset |= (uint64_t)file[len - PACK_TRAILER_SIZE + i] << (8 * i);
+    CHECK(index_offset > PACK_HEADER_SIZE && index_offset < len);
+    accepted = 0;
+    for (size_t pos = index_offset; pos < len; pos++) {
+        file[pos] ^= 0x20;
+        pack_entry_t *bad = read_index_bytes(file, len, &count);
+        if (bad) accepted++;
+        free(bad);
+        file[pos] ^= 0x20;
+    }
+    CHECK(accepted == 0);
+    
+    // Cabeçalho trocado
+    file[0] ^= 0x01;
+    entries = read_index_bytes(file, len, &count);
+    CHECK(entries == NULL);
+    free(entries);
+    
+    free(file);
+    unlink(path);
+}
+
+static void test_empty_pack(void) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/vazio.pack", tmp_dir);
+    pack_writer_t *pack = pack_create(path);
+    CHECK(pack != NULL);
+    if (!pack) return;
+    uint32_t written = 1;
+    CHECK(pack_close(pack, &written) == 0 && written == 0);
+    
+    size_t len = 0;
+    unsigned char *file = read_file(path, &len);
+    CHECK(file && len == PACK_HEADER_SIZE + PACK_TRAILER_SIZE);
+    uint32_t count = 1;
+    pack_entry_t *entries = file ? read_index_bytes(file, len, &count) : NULL;
+    CHECK(entries != NULL && count == 0);
+    free(entries);
+    free(file);
+    unlink(path);
+}
+
+// ============================================================
+// ÍNDICE COM CRC CERTO E CONTEÚDO INVÁLIDO
+// ============================================================
+
+static void check_crafted(const char *what, const unsigned char *data, size_t data_len,
+                          const unsigned char *index, size_t index_len, uint32_t count, int valid) {
+    unsigned char file[1024];
+    size_t len = craft_pack(file, data, data_len, index, index_len, count);
+    uint32_t n = 0;
+    pack_entry_t *entries = read_index_bytes(file, len, &n);
+    if ((entries != NULL) != valid) fprintf(stderr, "  %s: %s\n", what, valid ? "recusado" : "aceito");
+    CHECK((entries != NULL) == valid);
+    free(entries);
+}
+
+static void test_crafted_index(void) {
+    const unsigned char data[] = "abcdefghij";
+    const size_t data_len = 10;
+    const uint32_t crc = crc32_update(0, data, data_len);
+    unsigned char index[256];
+    size_t n;
+    
+    n = index_record(index, 8, data_len, crc, "a.jpg", 5);
+    check_crafted("entrada válida", data, data_len, index, n, 1, 1);
+    
+    // Dados fora da área entre o cabeçalho e o índice
+    n = index_record(index, 4, 4, crc, "a.jpg", 5);
+    check_crafted("deslocamento dentro do cabeçalho", data, data_len, index, n, 1, 0);
+    n = index_record(index, 8, data_len + 1, crc, "a.jpg", 5);
+    check_crafted("dados sobre o índice", data, data_len, index, n, 1, 0);
+    n = index_record(index, 8 + data_len + 1, 0, crc, "a.jpg", 5);
+    check_crafted("deslocamento além do índice", data, data_len, index, n, 1, 0);
+    n = index_record(index, 9, UINT64_MAX, crc, "a.jpg", 5);
+    check_crafted("tamanho que transborda", data, data_len, index, n, 1, 0);
+    
+    // Nomes: vazio, com '\0', maior que o índice
+    n = index_record(index, 8, data_len, crc, "", 0);
+    check_crafted("nome vazio", data, data_len, index, n, 1, 0);
+    n = index_record(index, 8, data_len, crc, "a\0b", 3);
+    check_crafted("nome com NUL", data, data_len, index, n, 1, 0);
+    n = index_record(index, 8, data_len, crc, "a.jpg", 5);
+    put_le(index + 20, 6, 2);
+    check_crafted("nome além do índice", data, data_len, index, n, 1, 0);
+    
+    // Contagem diferente dos registros presentes
+    n = index_record(index, 8, data_len, crc, "a.jpg", 5);
+    check_crafted("menos entradas que registros", data, data_len, index, n, 0, 0);
+    check_crafted("mais entradas que registros", data, data_len, index, n, 2, 0);
+    check_crafted("contagem enorme", data, data_len, index, n, UINT32_MAX, 0);
+    
+    // Bytes sobrando depois do último registro
+    n = index_record(index, 8, data_len, crc, "a.jpg", 5);
+    index[n++] = 0;
+    check_crafted("lixo após os registros", data, data_len, index, n, 1, 0);
+}
+
+int main(void) {
+    if (!mkdtemp(tmp_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    test_write_read();
+    test_empty_pack();
+    test_crafted_index();
+    rmdir(tmp_dir);
+    return test_summary("pack");
+}
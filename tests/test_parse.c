@@ -0,0 +1,183 @@
+// Testes das opções com sintaxe própria: perfis de codificação (-Q) e
+// tamanhos de memória (-M)
+
+#include "test.h"
+#include "image_encode.h"
+#include "filters.h"
+#include "mem_budget.h"
+
+// ============================================================
+// PERFIS DE CODIFICAÇÃO
+// ============================================================
+
+static int same_profile(const encode_profile_t *a, const encode_profile_t *b) {
+    return a->jpeg_quality == b->jpeg_quality && a->jpeg_subsample == b->jpeg_subsample &&
+           a->png_level == b->png_level && a->png_filter == b->png_filter &&
+           a->png_fast == b->png_fast && a->format == b->format;
+}
+
+static void check_profile(const char *text, encode_profile_t expected) {
+    encode_profile_t p;
+    int ok = parse_encode_profile(text, &p) == 0 && same_profile(&p, &expected);
+    if (!ok) fprintf(stderr, "  perfil \"%s\"\n", text);
+    CHECK(ok);
+}
+
+static void test_encode_profile(void) {
+    const encode_profile_t def = ENCODE_PROFILE_DEFAULT;
+    encode_profile_t e;
+    
+    check_profile("default", def);
+    
+    // Presets
+    e = def;
+    e.jpeg_quality = 75;
+    e.png_level = 5;
+    e.png_filter = 1;
+    check_profile("thumb", e);
+    e = def;
+    e.jpeg_quality = 95;
+    e.jpeg_subsample = 0;
+    e.png_level = 9;
+    e.png_filter = -1;
+    check_profile("archive", e);
+    
+    // Campos partem do default; o último vence; preset depois recomeça
+    e = def;
+    e.jpeg_quality = 70;
+    e.png_level = 1;
+    e.png_filter = 1;
+    check_profile("q70/z1/sub", e);
+    e = def;
+    e.jpeg_quality = 92;
+    e.jpeg_subsample = 0;
+    e.png_level = 9;
+    e.png_filter = -1;
+    check_profile("archive/q92", e);
+    e = def;
+    e.jpeg_quality = 75;
+    e.png_level = 5;
+    e.png_filter = 1;
+    check_profile("q10/thumb", e);
+    e = def;
+    e.jpeg_quality = 1;
+    check_profile("q50/q1", e);
+    
+    // Croma, filtros, codificador e formato
+    e = def;
+    e.jpeg_subsample = 0;
+    check_profile("444", e);
+    check_profile("444/420", def);
+    static const char *const filters[] = { "none", "sub", "up", "avg", "paeth" };
+    for (int i = 0; i < 5; i++) {
+        e = def;
+        e.png_filter = (signed char)i;
+        check_profile(filters[i], e);
+    }
+    check_profile("paeth/adaptive", def);
+    e = def;
+    e.png_fast = 1;
+    e.png_level = 2;
+    check_profile("fast/z2", e);
+    check_profile("fast/stb", def);
+    static const char *const formats[] = { "jpg", "png", "qoi", "ppm", "pam" };
+    for (int i = 0; i < 5; i++) {
+        e = def;
+        e.format = (signed char)(i + 1);
+        check_profile(formats[i], e);
+        CHECK(parse_output_format(formats[i]) == i);
+    }
+    
+    // '/' sobrando é só um separador vazio
+    e = def;
+    e.jpeg_quality = 70;
+    check_profile("q70/", e);
+    check_profile("/q70", e);
+    
+    // Inválidos: *profile não muda
+    static const char *const bad[] = {
+        "q0", "q101", "q", "qx", "q50x", "z0", "z10", "z", "422", "zip", "Default", "thumb,q70",
+        "q70/x", "gif", "jpeg"
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        encode_profile_t p = { .jpeg_quality = 33 };
+        int rc = parse_encode_profile(bad[i], &p);
+        if (rc == 0) fprintf(stderr, "  aceitou \"%s\"\n", bad[i]);
+        CHECK(rc != 0);
+        CHECK(p.jpeg_quality == 33);
+    }
+    
+    // Nome maior que o buffer interno
+    char longer[200];
+    memset(longer, 'q', sizeof(longer) - 1);
+    longer[sizeof(longer) - 1] = '\0';
+    CHECK(parse_encode_profile(longer, &e) != 0);
+}
+
+static void test_encode_profiles(void) {
+    const encode_profile_t def = ENCODE_PROFILE_DEFAULT;
+    encode_profile_t profiles[NUM_THREADS], thumb, qoi;
+    CHECK(parse_encode_profile("thumb", &thumb) == 0);
+    CHECK(parse_encode_profile("qoi", &qoi) == 0);
+    
+    // Sem filtro: todos; FILTRO=PERFIL só aquele; repetível, o último vence
+    for (int i = 0; i < NUM_THREADS; i++) profiles[i] = def;
+    CHECK(parse_encode_profiles("thumb", profiles) == 0);
+    for (int i = 0; i < NUM_THREADS; i++) CHECK(same_profile(&profiles[i], &thumb));
+    
+    for (int i = 0; i < NUM_THREADS; i++) profiles[i] = def;
+    CHECK(parse_encode_profiles("resize=thumb,blur=qoi", profiles) == 0);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        const encode_profile_t *want = i == FILTER_RESIZE ? &thumb : i == FILTER_BLUR ? &qoi : &def;
+        CHECK(same_profile(&profiles[i], want));
+    }
+    CHECK(parse_encode_profiles("thumb,resize=qoi", profiles) == 0);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        CHECK(same_profile(&profiles[i], i == FILTER_RESIZE ? &qoi : &thumb));
+    }
+    
+    // Um item inválido descarta a lista inteira
+    for (int i = 0; i < NUM_THREADS; i++) profiles[i] = def;
+    CHECK(parse_encode_profiles("resize=thumb,sepia=qoi", profiles) != 0);
+    CHECK(parse_encode_profiles("resize=thumb,blur=q0", profiles) != 0);
+    CHECK(parse_encode_profiles("=thumb", profiles) != 0);
+    for (int i = 0; i < NUM_THREADS; i++) CHECK(same_profile(&profiles[i], &def));
+}
+
+// ============================================================
+// TAMANHOS DE MEMÓRIA
+// ============================================================
+
+static void test_mem_size(void) {
+    CHECK(parse_mem_size("1") == 1);
+    CHECK(parse_mem_size("1048576") == 1048576);
+    CHECK(parse_mem_size("1k") == 1024);
+    CHECK(parse_mem_size("64K") == 64 * 1024);
+    CHECK(parse_mem_size("512M") == 512ull << 20);
+    CHECK(parse_mem_size("512MB") == 512ull << 20);
+    CHECK(parse_mem_size("2G") == 2ull << 30);
+    CHECK(parse_mem_size("2gb") == 2ull << 30);
+    CHECK(parse_mem_size("1.5G") == 3ull << 29);
+    CHECK(parse_mem_size("0.5k") == 512);
+    CHECK(parse_mem_size("100B") == 100);
+    CHECK(parse_mem_size("16000000000G") == 16000000000ull << 30);
+    CHECK(parse_mem_size("1e19") == 10000000000000000000ull);
+    
+    // 0 = inválido
+    static const char *const bad[] = {
+        "", "0", "0M", "-1", "-2G", "0.5", "abc", "M", "12X", "12MX", "1 G", "1e30",
+        "20000000000G", "nan", "inf", "-inf"
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        uint64_t v = parse_mem_size(bad[i]);
+        if (v != 0) fprintf(stderr, "  aceitou \"%s\" = %llu\n", bad[i], (unsigned long long)v);
+        CHECK(v == 0);
+    }
+}
+
+int main(void) {
+    test_encode_profile();
+    test_encode_profiles();
+    test_mem_size();
+    return test_summary("parse");
+}
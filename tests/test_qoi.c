@@ -0,0 +1,194 @@
+// Testes do QOI (qoi.c): ida e volta e entradas truncadas ou com
+// cabeçalho inválido
+
+#include "test.h"
+#include "qoi.h"
+
+#define QOI_END_SIZE    8
+
+static unsigned char* pattern(int width, int height, int channels, int kind) {
+    unsigned char *d = (unsigned char*)malloc((size_t)width * height * channels);
+    uint32_t seed = 11;
+    for (int i = 0; i < width * height; i++) {
+        for (int c = 0; c < channels; c++) {
+            seed = seed * 1103515245u + 12345u;
+            unsigned char v;
+            if (kind == 0) v = (unsigned char)(seed >> 24);                     // ruído: RGB/RGBA
+            else if (kind == 1) v = (unsigned char)((i / 97) * 13 + c * 40);    // faixas lisas: RUN
+            else v = (unsigned char)(i + c + ((seed >> 30) & 1));               // passos pequenos: DIFF/LUMA
+            d[(size_t)i * channels + c] = v;
+        }
+    }
+    return d;
+}
+
+// Pixel esperado na volta: cinza vira RGB, cinza + alfa vira RGBA
+static int same_pixels(const unsigned char *src, int channels, const unsigned char *out, int out_ch,
+                       int pixels) {
+    for (int i = 0; i < pixels; i++) {
+        const unsigned char *s = src + (size_t)i * channels, *o = out + (size_t)i * out_ch;
+        int gray = channels <= 2;
+        for (int c = 0; c < 3; c++) {
+            if (o[c] != (gray ? s[0] : s[c])) return 0;
+        }
+        int alpha = channels == 2 || channels == 4;
+        if (alpha && o[3] != s[channels - 1]) return 0;
+    }
+    return 1;
+}
+
+static void test_roundtrip(void) {
+    const int width = 67, height = 29;
+    for (int channels = 1; channels <= 4; channels++) {
+        for (int kind = 0; kind < 3; kind++) {
+            unsigned char *src = pattern(width, height, channels, kind);
+            size_t len = 0;
+            unsigned char *qoi = qoi_encode(src, width, height, channels, &len);
+            CHECK(qoi != NULL && len > QOI_HEADER_SIZE + QOI_END_SIZE);
+            if (!qoi) {
+                free(src);
+                continue;
+            }
+            
+            int w, h, ch;
+            CHECK(qoi_info(qoi, len, &w, &h, &ch) == 0);
+            CHECK(w == width && h == height && ch == (channels == 2 || channels == 4 ? 4 : 3));
+            
+            unsigned char *out = qoi_decode(qoi, len, &w, &h, &ch);
+            CHECK(out != NULL);
+            if (out) CHECK(same_pixels(src, channels, out, ch, width * height));
+            free(out);
+            free(qoi);
+            free(src);
+        }
+    }
+    
+    // Imagem de um pixel e uma longa só de repetições
+    unsigned char one[3] = { 1, 2, 3 };
+    size_t len = 0;
+    unsigned char *qoi = qoi_encode(one, 1, 1, 3, &len);
+    int w, h, ch;
+    unsigned char *out = qoi ? qoi_decode(qoi, len, &w, &h, &ch) : NULL;
+    CHECK(out && w == 1 && h == 1 && memcmp(out, one, 3) == 0);
+    free(out);
+    free(qoi);
+    
+    unsigned char *flat = (unsigned char*)calloc(1000 * 100, 3);
+    qoi = qoi_encode(flat, 1000, 100, 3, &len);
+    CHECK(qoi && len < 2000 + QOI_HEADER_SIZE + QOI_END_SIZE);
+    out = qoi ? qoi_decode(qoi, len, &w, &h, &ch) : NULL;
+    CHECK(out && memcmp(out, flat, 1000 * 100 * 3) == 0);
+    free(out);
+    free(qoi);
+    free(flat);
+}
+
+// Todo prefixo do fluxo: NULL ou, se só o marcador final foi cortado, a
+// imagem certa. Sem uma operação inteira, nunca há imagem
+static void test_truncated(void) {
+    const int width = 23, height = 19;
+    for (int kind = 0; kind < 3; kind++) {
+        unsigned char *src = pattern(width, height, 4, kind);
+        size_t len = 0;
+        unsigned char *qoi = qoi_encode(src, width, height, 4, &len);
+        CHECK(qoi != NULL);
+        if (!qoi) {
+            free(src);
+            continue;
+        }
+        
+        for (size_t cut = 0; cut < len; cut++) {
+            // Cópia exata: leituras além do fim aparecem no valgrind/ASan
+            unsigned char *part = (unsigned char*)malloc(cut ? cut : 1);
+            memcpy(part, qoi, cut);
+            int w, h, ch;
+            unsigned char *out = qoi_decode(part, cut, &w, &h, &ch);
+            if (len - cut > 4) {
+                // A última operação (até 5 bytes) termina antes do marcador
+                if (out) fprintf(stderr, "  prefixo de %zu de %zu bytes decodificado\n", cut, len);
+                CHECK(out == NULL);
+            } else if (out) {
+                CHECK(same_pixels(src, 4, out, ch, width * height));
+            }
+            free(out);
+            free(part);
+        }
+        free(qoi);
+        free(src);
+    }
+}
+
+static void put32be(unsigned char *p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+// Cabeçalho seguido de dados curtos e do marcador final
+static size_t make_header(unsigned char *buf, size_t data_len, uint32_t w, uint32_t h, int ch, int cs) {
+    memcpy(buf, "qoif", 4);
+    put32be(buf + 4, w);
+    put32be(buf + 8, h);
+    buf[12] = (unsigned char)ch;
+    buf[13] = (unsigned char)cs;
+    memset(buf + QOI_HEADER_SIZE, 0xc0 | 61, data_len);    // RUN de 62
+    memset(buf + QOI_HEADER_SIZE + data_len, 0, QOI_END_SIZE);
+    buf[QOI_HEADER_SIZE + data_len + QOI_END_SIZE - 1] = 1;
+    return QOI_HEADER_SIZE + data_len + QOI_END_SIZE;
+}
+
+static void test_bad_headers(void) {
+    unsigned char buf[256];
+    int w, h, ch;
+    
+    // Válido: 62 × 2 pixels em duas operações RUN (a primeira cor é o preto)
+    size_t len = make_header(buf, 2, 62, 2, 3, 0);
+    unsigned char *out = qoi_decode(buf, len, &w, &h, &ch);
+    CHECK(out != NULL && w == 62 && h == 2 && ch == 3);
+    free(out);
+    
+    // Campos inválidos: qoi_info e qoi_decode recusam
+    const struct { uint32_t w, h; int ch, cs; } bad[] = {
+        { 0, 10, 3, 0 },
+        { 10, 0, 3, 0 },
+        { 10, 10, 2, 0 },
+        { 10, 10, 5, 0 },
+        { 10, 10, 3, 2 },
+        { 0x80000000u, 1, 3, 0 },           // Maior que INT_MAX
+        { 1, 0x80000000u, 3, 0 },
+        { 20001, 20000, 4, 0 },             // Acima de 400 milhões de pixels
+        { 0xffffffffu, 0xffffffffu, 4, 0 },
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        len = make_header(buf, 2, bad[i].w, bad[i].h, bad[i].ch, bad[i].cs);
+        CHECK(qoi_info(buf, len, &w, &h, &ch) != 0);
+        CHECK(qoi_decode(buf, len, &w, &h, &ch) == NULL);
+    }
+    
+    // Assinatura errada e cabeçalho incompleto
+    len = make_header(buf, 2, 62, 2, 3, 0);
+    buf[0] = 'Q';
+    CHECK(qoi_info(buf, len, &w, &h, &ch) != 0);
+    buf[0] = 'q';
+    for (size_t cut = 0; cut < QOI_HEADER_SIZE; cut++) {
+        CHECK(qoi_info(buf, cut, &w, &h, &ch) != 0);
+    }
+    
+    // Cabeçalho grande (dentro do limite) com poucos dados: recusado antes
+    // de reservar a imagem
+    len = make_header(buf, 16, 20000, 20000, 4, 0);
+    CHECK(qoi_info(buf, len, &w, &h, &ch) == 0);
+    CHECK(qoi_decode(buf, len, &w, &h, &ch) == NULL);
+    
+    // 62 × 3 pixels com dados para só dois RUN: truncado
+    len = make_header(buf, 2, 62, 3, 3, 0);
+    CHECK(qoi_decode(buf, len, &w, &h, &ch) == NULL);
+}
+
+int main(void) {
+    test_roundtrip();
+    test_truncated();
+    test_bad_headers();
+    return test_summary("qoi");
+}